@@ -0,0 +1,83 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <compress.h>
+#include <zlib.h>
+
+namespace modelarts {
+
+// window bits 15 with +16 selects the gzip wrapper instead of raw zlib
+constexpr int GZIP_WINDOW_BITS = 15 + 16;
+constexpr int GZIP_MEM_LEVEL = 8;
+constexpr size_t GZIP_CHUNK_SIZE = 16 * 1024;
+
+modelbox::Status GzipCompress(const std::string &input, std::string &output) {
+  z_stream stream{};
+  auto ret = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                          GZIP_WINDOW_BITS, GZIP_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+  if (ret != Z_OK) {
+    return {modelbox::STATUS_FAULT,
+            "deflate init failed, ret: " + std::to_string(ret)};
+  }
+
+  output.clear();
+  output.resize(deflateBound(&stream, input.size()));
+  stream.next_in = (Bytef *)input.data();
+  stream.avail_in = input.size();
+  stream.next_out = (Bytef *)&output[0];
+  stream.avail_out = output.size();
+  ret = deflate(&stream, Z_FINISH);
+  deflateEnd(&stream);
+  if (ret != Z_STREAM_END) {
+    output.clear();
+    return {modelbox::STATUS_FAULT,
+            "deflate failed, ret: " + std::to_string(ret)};
+  }
+
+  output.resize(stream.total_out);
+  return modelbox::STATUS_SUCCESS;
+}
+
+modelbox::Status GzipDecompress(const std::string &input, std::string &output) {
+  z_stream stream{};
+  auto ret = inflateInit2(&stream, GZIP_WINDOW_BITS);
+  if (ret != Z_OK) {
+    return {modelbox::STATUS_FAULT,
+            "inflate init failed, ret: " + std::to_string(ret)};
+  }
+
+  output.clear();
+  stream.next_in = (Bytef *)input.data();
+  stream.avail_in = input.size();
+  char buffer[GZIP_CHUNK_SIZE];
+  do {
+    stream.next_out = (Bytef *)buffer;
+    stream.avail_out = sizeof(buffer);
+    ret = inflate(&stream, Z_NO_FLUSH);
+    if (ret != Z_OK && ret != Z_STREAM_END) {
+      inflateEnd(&stream);
+      output.clear();
+      return {modelbox::STATUS_FAULT,
+              "inflate failed, ret: " + std::to_string(ret)};
+    }
+    output.append(buffer, sizeof(buffer) - stream.avail_out);
+  } while (ret != Z_STREAM_END);
+
+  inflateEnd(&stream);
+  return modelbox::STATUS_SUCCESS;
+}
+
+}  // namespace modelarts
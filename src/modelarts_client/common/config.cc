@@ -23,8 +23,48 @@ Config::Config()
                   CONFIG_ALG_TYPE,
                   CONFIG_MAX_INPUT_COUNT,
                   CONFIG_NOTIFY_URL,
+                  CONFIG_NOTIFY_COMPRESS_THRESHOLD,
                   CONFIG_TASK_URI,
                   CONFIG_TASK_PORT,
+                  CONFIG_READY_URI,
+                  CONFIG_DRAIN_URI,
+                  CONFIG_METRICS_URI,
+                  CONFIG_DRAIN_TIMEOUT,
+                  CONFIG_DRAIN_FLUSH_TIMEOUT,
+                  CONFIG_JOURNAL_PATH,
+                  CONFIG_JOURNAL_COMPACT_RECORDS,
+                  CONFIG_HANDOVER_SOCKET,
+                  CONFIG_HANDOVER_TIMEOUT,
+                  CONFIG_WORKER_NUM,
+                  CONFIG_WORKER_HEALTH_INTERVAL,
+                  CONFIG_AFFINITY_CONTROL_CPUS,
+                  CONFIG_AFFINITY_TASK_CPUS,
+                  CONFIG_AFFINITY_GROUP_SIZE,
+                  CONFIG_AFFINITY_NUMA,
+                  CONFIG_TASK_STOP_TIMEOUT,
+                  CONFIG_TASK_DELETE_ALL_PARALLEL,
+                  CONFIG_TASK_DELETE_ALL_TIMEOUT,
+                  CONFIG_TASK_RETAIN_NUM,
+                  CONFIG_TASK_RETAIN_TTL,
+                  CONFIG_TASK_PROGRESS_INTERVAL,
+                  CONFIG_OBS_BATCH_CONCURRENCY,
+                  CONFIG_OBS_BATCH_OBJECTS,
+                  CONFIG_OBS_LIST_BUFFER,
+                  CONFIG_OBS_PREFETCH_DIR,
+                  CONFIG_OBS_PREFETCH_MAX_MB,
+                  CONFIG_OBS_PREFETCH_DEPTH,
+                  CONFIG_OBS_CHECKPOINT_DIR,
+                  CONFIG_OBS_CHECKPOINT_INTERVAL,
+                  CONFIG_EXECUTOR_WORKERS,
+                  CONFIG_EXECUTOR_TICK_MS,
+                  CONFIG_EXECUTOR_TASK_WORKERS,
+                  CONFIG_HEARTBEAT_INTERVAL,
+                  CONFIG_HEARTBEAT_MAX_INTERVAL,
+                  CONFIG_HEARTBEAT_RETRY_INTERVAL,
+                  CONFIG_HEARTBEAT_DEBOUNCE_MS,
+                  CONFIG_HEARTBEAT_JITTER_PERCENT,
+                  CONFIG_OVERLOAD_CPU_PERCENT,
+                  CONFIG_OVERLOAD_MEM_PERCENT,
                   CONFIG_DEVELOPER_PROJECTID,
                   CONFIG_DEVELOPER_DOMAIN_NAME,
                   CONFIG_DEVELOPER_DOAMIN_ID,
@@ -86,10 +126,50 @@ modelbox::Status Config::LoadEnvConfig(const std::string &env) {
       {CONFIG_ENDPOINT_VIS, "/cloud_endpoint/vis_endpoint"},
       {CONFIG_REGION, "/cloud_endpoint/region"},
       {CONFIG_NOTIFY_URL, "/notification_url"},
+      {CONFIG_NOTIFY_COMPRESS_THRESHOLD, "/notification_compress_threshold"},
       {CONFIG_INSTANCE_ID, "/instance_id"},
       {CONFIG_TASK_URI, "/service/task_uri"},
       {CONFIG_TASK_PORT, "/service/port"},
       {CONFIG_MAX_INPUT_COUNT, "/input_count_max"},
+      {CONFIG_READY_URI, "/service/ready_uri"},
+      {CONFIG_DRAIN_URI, "/service/drain_uri"},
+      {CONFIG_METRICS_URI, "/service/metrics_uri"},
+      {CONFIG_DRAIN_TIMEOUT, "/drain/timeout"},
+      {CONFIG_DRAIN_FLUSH_TIMEOUT, "/drain/flush_timeout"},
+      {CONFIG_JOURNAL_PATH, "/journal/path"},
+      {CONFIG_JOURNAL_COMPACT_RECORDS, "/journal/compact_records"},
+      {CONFIG_HANDOVER_SOCKET, "/handover/socket"},
+      {CONFIG_HANDOVER_TIMEOUT, "/handover/timeout"},
+      {CONFIG_WORKER_NUM, "/worker/num"},
+      {CONFIG_WORKER_HEALTH_INTERVAL, "/worker/health_interval"},
+      {CONFIG_AFFINITY_CONTROL_CPUS, "/affinity/control_cpus"},
+      {CONFIG_AFFINITY_TASK_CPUS, "/affinity/task_cpus"},
+      {CONFIG_AFFINITY_GROUP_SIZE, "/affinity/group_size"},
+      {CONFIG_AFFINITY_NUMA, "/affinity/numa"},
+      {CONFIG_TASK_STOP_TIMEOUT, "/service/stop_timeout"},
+      {CONFIG_TASK_DELETE_ALL_PARALLEL, "/service/delete_all_parallel"},
+      {CONFIG_TASK_DELETE_ALL_TIMEOUT, "/service/delete_all_timeout"},
+      {CONFIG_TASK_RETAIN_NUM, "/service/retain_num"},
+      {CONFIG_TASK_RETAIN_TTL, "/service/retain_ttl"},
+      {CONFIG_TASK_PROGRESS_INTERVAL, "/service/progress_interval"},
+      {CONFIG_OBS_BATCH_CONCURRENCY, "/obs/batch_concurrency"},
+      {CONFIG_OBS_BATCH_OBJECTS, "/obs/batch_objects"},
+      {CONFIG_OBS_LIST_BUFFER, "/obs/list_buffer"},
+      {CONFIG_OBS_PREFETCH_DIR, "/obs/prefetch_dir"},
+      {CONFIG_OBS_PREFETCH_MAX_MB, "/obs/prefetch_max_mb"},
+      {CONFIG_OBS_PREFETCH_DEPTH, "/obs/prefetch_depth"},
+      {CONFIG_OBS_CHECKPOINT_DIR, "/obs/checkpoint_dir"},
+      {CONFIG_OBS_CHECKPOINT_INTERVAL, "/obs/checkpoint_interval"},
+      {CONFIG_EXECUTOR_WORKERS, "/executor/workers"},
+      {CONFIG_EXECUTOR_TICK_MS, "/executor/tick_ms"},
+      {CONFIG_EXECUTOR_TASK_WORKERS, "/executor/task_workers"},
+      {CONFIG_HEARTBEAT_INTERVAL, "/heartbeat/interval"},
+      {CONFIG_HEARTBEAT_MAX_INTERVAL, "/heartbeat/max_interval"},
+      {CONFIG_HEARTBEAT_RETRY_INTERVAL, "/heartbeat/retry_interval"},
+      {CONFIG_HEARTBEAT_DEBOUNCE_MS, "/heartbeat/debounce_ms"},
+      {CONFIG_HEARTBEAT_JITTER_PERCENT, "/heartbeat/jitter_percent"},
+      {CONFIG_OVERLOAD_CPU_PERCENT, "/overload/cpu_percent"},
+      {CONFIG_OVERLOAD_MEM_PERCENT, "/overload/mem_percent"},
       {CONFIG_ALG_TYPE, "/algorithm/alg_type"},
       {CONFIG_DEVELOPER_PROJECTID, "/isv/project_id"},
       {CONFIG_DEVELOPER_DOAMIN_ID, "/isv/domain_id"},
@@ -127,6 +207,10 @@ modelbox::Status Config::LoadJsonConfig(
       } else if (value.is_number()) {
         configuration_->SetProperty(item.first, value.get<int>());
         MBLOG_DEBUG << item.first << ":" << value.get<int>();
+      } else if (value.is_boolean()) {
+        std::string flag = value.get<bool>() ? "true" : "false";
+        configuration_->SetProperty(item.first, flag);
+        MBLOG_DEBUG << item.first << ":" << flag;
       } else {
         MBLOG_WARN << point.to_string() << " unknow type";
       }
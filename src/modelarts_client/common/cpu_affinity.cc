@@ -0,0 +1,286 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cpu_affinity.h>
+#include <dirent.h>
+#include <log.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <sstream>
+
+namespace modelarts {
+
+constexpr const char *PROC_TASK_PATH = "/proc/self/task";
+constexpr const char *NODE_PATH = "/sys/devices/system/node";
+constexpr const char *ROLE_CONTROL = "control";
+constexpr const char *ROLE_PIPELINE = "pipeline";
+
+static thread_local bool g_control_bound = false;
+
+modelbox::Status ParseCpuList(const std::string &str, std::vector<int> &cpus) {
+  cpus.clear();
+  std::istringstream stream(str);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    item.erase(std::remove_if(item.begin(), item.end(), ::isspace),
+               item.end());
+    if (item.empty()) {
+      continue;
+    }
+
+    int first = 0;
+    int last = 0;
+    try {
+      auto pos = item.find('-');
+      first = std::stoi(item.substr(0, pos));
+      last = pos == std::string::npos ? first : std::stoi(item.substr(pos + 1));
+    } catch (const std::exception &e) {
+      return {modelbox::STATUS_INVALID, "invalid cpu list: " + str};
+    }
+
+    if (first < 0 || last < first || last >= CPU_SETSIZE) {
+      return {modelbox::STATUS_INVALID, "invalid cpu range: " + item};
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return modelbox::STATUS_SUCCESS;
+}
+
+static bool SetThreadAffinity(pid_t tid, const std::vector<int> &cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  return sched_setaffinity(tid, sizeof(set), &set) == 0;
+}
+
+static std::vector<pid_t> ListThreads() {
+  std::vector<pid_t> threads;
+  auto *dir = opendir(PROC_TASK_PATH);
+  if (dir == nullptr) {
+    return threads;
+  }
+
+  struct dirent *entry = nullptr;
+  while ((entry = readdir(dir)) != nullptr) {
+    if (entry->d_name[0] != '.') {
+      threads.push_back((pid_t)atoi(entry->d_name));
+    }
+  }
+  closedir(dir);
+  return threads;
+}
+
+static bool ReadThreadStat(pid_t tid, std::string &name, uint64_t &ticks) {
+  std::ifstream file(std::string(PROC_TASK_PATH) + "/" +
+                     std::to_string(tid) + "/stat");
+  std::string line;
+  if (file.fail() || !std::getline(file, line)) {
+    return false;
+  }
+
+  // comm may hold spaces, the fields after it are fixed
+  auto begin = line.find('(');
+  auto end = line.rfind(')');
+  if (begin == std::string::npos || end == std::string::npos) {
+    return false;
+  }
+  name = line.substr(begin + 1, end - begin - 1);
+
+  std::istringstream stream(line.substr(end + 1));
+  std::string field;
+  uint64_t utime = 0;
+  uint64_t stime = 0;
+  for (int i = 0; i < 11; ++i) {
+    stream >> field;
+  }
+  stream >> utime >> stime;
+  if (stream.fail()) {
+    return false;
+  }
+  ticks = utime + stime;
+  return true;
+}
+
+static std::vector<std::vector<int>> ReadNodeCpus() {
+  std::vector<std::vector<int>> nodes;
+  auto *dir = opendir(NODE_PATH);
+  if (dir == nullptr) {
+    return nodes;
+  }
+
+  struct dirent *entry = nullptr;
+  while ((entry = readdir(dir)) != nullptr) {
+    std::string node = entry->d_name;
+    if (node.compare(0, 4, "node") != 0 || node.size() == 4 ||
+        !isdigit(node[4])) {
+      continue;
+    }
+
+    std::ifstream file(std::string(NODE_PATH) + "/" + node + "/cpulist");
+    std::string cpulist;
+    std::vector<int> cpus;
+    if (std::getline(file, cpulist) && ParseCpuList(cpulist, cpus) &&
+        !cpus.empty()) {
+      nodes.push_back(cpus);
+    }
+  }
+  closedir(dir);
+  return nodes;
+}
+
+modelbox::Status CpuAffinity::Init(const std::shared_ptr<Config> &config) {
+  std::vector<int> control_cpus;
+  auto status = ParseCpuList(
+      config->GetString(CONFIG_AFFINITY_CONTROL_CPUS, ""), control_cpus);
+  if (!status) {
+    return status;
+  }
+
+  std::vector<int> task_cpus;
+  status =
+      ParseCpuList(config->GetString(CONFIG_AFFINITY_TASK_CPUS, ""), task_cpus);
+  if (!status) {
+    return status;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  control_cpus_ = control_cpus;
+  task_cpus_ = task_cpus;
+  BuildTaskGroups(std::max(config->GetInt(CONFIG_AFFINITY_GROUP_SIZE, 0), 0),
+                  config->GetBool(CONFIG_AFFINITY_NUMA, false));
+  MBLOG_INFO << "cpu affinity, control cpus: " << control_cpus_.size()
+             << " task cpus: " << task_cpus_.size()
+             << " task groups: " << task_groups_.size();
+  return modelbox::STATUS_SUCCESS;
+}
+
+void CpuAffinity::BuildTaskGroups(size_t group_size, bool numa) {
+  task_groups_.clear();
+  if (task_cpus_.empty()) {
+    return;
+  }
+
+  std::vector<std::vector<int>> domains;
+  if (numa) {
+    for (auto &node : ReadNodeCpus()) {
+      std::vector<int> cpus;
+      std::set_intersection(node.begin(), node.end(), task_cpus_.begin(),
+                            task_cpus_.end(), std::back_inserter(cpus));
+      if (!cpus.empty()) {
+        domains.push_back(cpus);
+      }
+    }
+  }
+  if (domains.empty()) {
+    domains.push_back(task_cpus_);
+  }
+
+  for (auto &domain : domains) {
+    auto size = group_size == 0 ? domain.size() : group_size;
+    for (size_t i = 0; i < domain.size(); i += size) {
+      auto end = std::min(i + size, domain.size());
+      task_groups_.emplace_back(domain.begin() + i, domain.begin() + end);
+    }
+  }
+}
+
+void CpuAffinity::BindPipeline(int group) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (task_cpus_.empty()) {
+    return;
+  }
+
+  const auto &cpus =
+      group < 0 ? task_cpus_ : task_groups_[group % task_groups_.size()];
+  for (auto tid : ListThreads()) {
+    if (control_threads_.find(tid) != control_threads_.end()) {
+      continue;
+    }
+    if (!SetThreadAffinity(tid, cpus)) {
+      MBLOG_WARN << "set pipeline thread affinity failed, tid: " << tid;
+    }
+  }
+  MBLOG_INFO << "pin pipeline threads to " << cpus.size()
+             << " cpus, group: " << group;
+}
+
+void CpuAffinity::BindControlThread(const std::string &name) {
+  if (g_control_bound) {
+    return;
+  }
+  g_control_bound = true;
+
+  auto tid = (pid_t)syscall(SYS_gettid);
+  std::lock_guard<std::mutex> lock(mutex_);
+  control_threads_[tid] = name;
+  if (!control_cpus_.empty() && !SetThreadAffinity(tid, control_cpus_)) {
+    MBLOG_WARN << "set control thread affinity failed, thread: " << name;
+  }
+}
+
+nlohmann::json CpuAffinity::SampleThreadUsage() {
+  nlohmann::json threads = nlohmann::json::array();
+  static const double clock_ticks = sysconf(_SC_CLK_TCK);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::set<pid_t> alive;
+  for (auto tid : ListThreads()) {
+    std::string name;
+    uint64_t thread_ticks = 0;
+    if (!ReadThreadStat(tid, name, thread_ticks)) {
+      continue;
+    }
+    alive.insert(tid);
+
+    double cpu_ms = 0;
+    if (clock_ticks > 0) {
+      cpu_ms = 1000.0 * thread_ticks / clock_ticks;
+    }
+    auto control = control_threads_.find(tid);
+    bool is_control = control != control_threads_.end();
+    threads.push_back({{"tid", tid},
+                       {"name", is_control ? control->second : name},
+                       {"role", is_control ? ROLE_CONTROL : ROLE_PIPELINE},
+                       {"cpu_ms", cpu_ms}});
+  }
+
+  // forget threads that have exited
+  for (auto it = control_threads_.begin(); it != control_threads_.end();) {
+    if (alive.find(it->first) == alive.end()) {
+      it = control_threads_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return threads;
+}
+
+}  // namespace modelarts
@@ -0,0 +1,344 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cpu_affinity.h>
+#include <executor.h>
+#include <log.h>
+
+#include <algorithm>
+
+namespace modelarts {
+
+constexpr size_t WHEEL_LEVELS = 4;
+constexpr size_t WHEEL_SLOT_BITS = 6;
+constexpr size_t WHEEL_SLOTS = 1 << WHEEL_SLOT_BITS;
+constexpr uint64_t WHEEL_SLOT_MASK = WHEEL_SLOTS - 1;
+constexpr uint64_t WHEEL_MAX_TICKS = (uint64_t)1
+                                     << (WHEEL_SLOT_BITS * WHEEL_LEVELS);
+
+static thread_local Executor *g_current_executor = nullptr;
+static thread_local size_t g_current_worker = 0;
+
+Executor::Executor(int worker_num, int tick_ms)
+    : worker_num_(std::max(worker_num, 1)), tick_ms_(std::max(tick_ms, 1)) {
+  wheel_.resize(WHEEL_LEVELS);
+  for (auto &level : wheel_) {
+    level.resize(WHEEL_SLOTS);
+  }
+}
+
+Executor::~Executor() { Stop(); }
+
+modelbox::Status Executor::Start() {
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    if (running_) {
+      return modelbox::STATUS_SUCCESS;
+    }
+
+    start_time_ = std::chrono::steady_clock::now();
+    current_tick_ = 0;
+    for (int i = 0; i < worker_num_; ++i) {
+      workers_.emplace_back(new Worker());
+    }
+    running_ = true;
+  }
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i]->thread = std::thread(&Executor::WorkerLoop, this, i);
+  }
+  timer_thread_ = std::thread(&Executor::TimerLoop, this);
+
+  MBLOG_INFO << "executor start, workers: " << worker_num_
+             << " tick: " << tick_ms_ << "ms";
+  return modelbox::STATUS_SUCCESS;
+}
+
+void Executor::Stop() {
+  {
+    // Submit checks running_ under this lock, workers_ is not used after
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+    idle_cond_.notify_all();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+    timer_cond_.notify_all();
+  }
+  if (timer_thread_.joinable()) {
+    timer_thread_.join();
+  }
+
+  for (auto &worker : workers_) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+  workers_.clear();
+
+  std::lock_guard<std::mutex> lock(timer_mutex_);
+  if (!timers_.empty()) {
+    MBLOG_INFO << "executor stop, drop pending timers: " << timers_.size();
+  }
+  timers_.clear();
+  for (auto &level : wheel_) {
+    for (auto &slot : level) {
+      slot.clear();
+    }
+  }
+  MBLOG_INFO << "executor stop.";
+}
+
+bool Executor::Submit(const ExecutorFunc &func) {
+  if (func == nullptr) {
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    if (!running_) {
+      MBLOG_WARN << "executor is not running, drop work.";
+      return false;
+    }
+
+    size_t index = 0;
+    if (g_current_executor == this) {
+      index = g_current_worker;
+    } else {
+      index = next_worker_++ % workers_.size();
+    }
+    {
+      std::lock_guard<std::mutex> worker_lock(workers_[index]->mutex);
+      workers_[index]->queue.push_back(
+          {func, std::chrono::steady_clock::now()});
+    }
+    ++pending_work_;
+  }
+  idle_cond_.notify_one();
+  return true;
+}
+
+TimerId Executor::Schedule(int delay_ms, const ExecutorFunc &func) {
+  if (func == nullptr) {
+    return INVALID_TIMER_ID;
+  }
+
+  auto timer = std::make_shared<Timer>();
+  timer->func = func;
+  std::lock_guard<std::mutex> lock(timer_mutex_);
+  if (!running_) {
+    return INVALID_TIMER_ID;
+  }
+  uint64_t ticks = (std::max(delay_ms, 0) + tick_ms_ - 1) / tick_ms_;
+  timer->expire_tick = current_tick_ + std::max<uint64_t>(ticks, 1);
+  timer->id = ++next_timer_id_;
+  timers_[timer->id] = timer;
+  AddTimer(timer);
+  return timer->id;
+}
+
+bool Executor::Cancel(TimerId timer_id) {
+  if (timer_id == INVALID_TIMER_ID) {
+    return false;
+  }
+
+  // the timer stays in its slot and is skipped once it expires
+  std::lock_guard<std::mutex> lock(timer_mutex_);
+  auto it = timers_.find(timer_id);
+  if (it == timers_.end()) {
+    return false;
+  }
+  it->second->func = nullptr;
+  timers_.erase(it);
+  return true;
+}
+
+ExecutorMetrics Executor::GetMetrics() {
+  ExecutorMetrics metrics;
+  metrics.workers = worker_num_;
+  metrics.queue_depth = pending_work_;
+  {
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+    metrics.pending_timers = timers_.size();
+  }
+
+  std::lock_guard<std::mutex> lock(metrics_mutex_);
+  metrics.executed = executed_;
+  metrics.stolen = stolen_;
+  if (latency_count_ != 0) {
+    metrics.avg_latency_ms = latency_sum_ms_ / latency_count_;
+  }
+  metrics.max_latency_ms = latency_max_ms_;
+  return metrics;
+}
+
+void Executor::WorkerLoop(size_t index) {
+  CpuAffinity::GetInstance()->BindControlThread("executor");
+  g_current_executor = this;
+  g_current_worker = index;
+  Work work;
+  while (true) {
+    if (PopWork(index, work)) {
+      RunWork(work);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    if (!running_ && pending_work_ == 0) {
+      break;
+    }
+    idle_cond_.wait(lock, [&]() { return pending_work_ > 0 || !running_; });
+  }
+  g_current_executor = nullptr;
+}
+
+bool Executor::PopWork(size_t index, Work &work) {
+  {
+    auto &own = workers_[index];
+    std::lock_guard<std::mutex> lock(own->mutex);
+    if (!own->queue.empty()) {
+      work = std::move(own->queue.back());
+      own->queue.pop_back();
+      --pending_work_;
+      return true;
+    }
+  }
+
+  for (size_t i = 1; i < workers_.size(); ++i) {
+    auto &victim = workers_[(index + i) % workers_.size()];
+    std::lock_guard<std::mutex> lock(victim->mutex);
+    if (victim->queue.empty()) {
+      continue;
+    }
+    work = std::move(victim->queue.front());
+    victim->queue.pop_front();
+    --pending_work_;
+    std::lock_guard<std::mutex> metrics_lock(metrics_mutex_);
+    ++stolen_;
+    return true;
+  }
+  return false;
+}
+
+void Executor::RunWork(Work &work) {
+  auto latency = std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - work.submit_time)
+                     .count();
+  {
+    std::lock_guard<std::mutex> lock(metrics_mutex_);
+    ++executed_;
+    ++latency_count_;
+    latency_sum_ms_ += latency;
+    latency_max_ms_ = std::max(latency_max_ms_, latency);
+  }
+
+  try {
+    work.func();
+  } catch (const std::exception &e) {
+    MBLOG_ERROR << "executor work throw exception: " << e.what();
+  }
+  work.func = nullptr;
+}
+
+uint64_t Executor::CurrentTick() const {
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start_time_)
+                     .count();
+  return elapsed / tick_ms_;
+}
+
+void Executor::TimerLoop() {
+  CpuAffinity::GetInstance()->BindControlThread("timer");
+  std::vector<ExecutorFunc> expired;
+  while (running_) {
+    {
+      std::unique_lock<std::mutex> lock(timer_mutex_);
+      auto next = start_time_ + std::chrono::milliseconds(
+                                    (current_tick_ + 1) * (uint64_t)tick_ms_);
+      timer_cond_.wait_until(lock, next, [&]() { return !running_; });
+      if (!running_) {
+        break;
+      }
+
+      auto now_tick = CurrentTick();
+      while (current_tick_ < now_tick) {
+        AdvanceTick(expired);
+      }
+    }
+
+    for (auto &func : expired) {
+      Submit(func);
+    }
+    expired.clear();
+  }
+}
+
+void Executor::AddTimer(const std::shared_ptr<Timer> &timer) {
+  if (timer->expire_tick < current_tick_) {
+    timer->expire_tick = current_tick_;
+  }
+  auto delta = timer->expire_tick - current_tick_;
+  if (delta >= WHEEL_MAX_TICKS) {
+    timer->expire_tick = current_tick_ + WHEEL_MAX_TICKS - 1;
+    delta = WHEEL_MAX_TICKS - 1;
+  }
+
+  size_t level = 0;
+  while (level + 1 < WHEEL_LEVELS &&
+         delta >= ((uint64_t)1 << (WHEEL_SLOT_BITS * (level + 1)))) {
+    ++level;
+  }
+  auto slot =
+      (timer->expire_tick >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK;
+  wheel_[level][slot].push_back(timer);
+}
+
+void Executor::Cascade(size_t level) {
+  auto slot = (current_tick_ >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK;
+  if (slot == 0 && level + 1 < WHEEL_LEVELS) {
+    Cascade(level + 1);
+  }
+
+  std::list<std::shared_ptr<Timer>> timers;
+  timers.swap(wheel_[level][slot]);
+  for (auto &timer : timers) {
+    if (timer->func != nullptr) {
+      AddTimer(timer);
+    }
+  }
+}
+
+void Executor::AdvanceTick(std::vector<ExecutorFunc> &expired) {
+  ++current_tick_;
+  auto slot = current_tick_ & WHEEL_SLOT_MASK;
+  if (slot == 0) {
+    Cascade(1);
+  }
+
+  for (auto &timer : wheel_[0][slot]) {
+    if (timer->func == nullptr) {
+      continue;
+    }
+    timers_.erase(timer->id);
+    expired.push_back(std::move(timer->func));
+  }
+  wheel_[0][slot].clear();
+}
+
+}  // namespace modelarts
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <latency_histogram.h>
+
+#include <algorithm>
+
+namespace modelarts {
+
+static const std::vector<double> g_bucket_bounds_ms = {
+    1, 5, 10, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000, 60000};
+
+LatencyHistogram::LatencyHistogram()
+    : buckets_(g_bucket_bounds_ms.size() + 1, 0) {}
+
+void LatencyHistogram::Observe(double latency_ms) {
+  latency_ms = std::max(latency_ms, 0.0);
+  auto bucket = std::lower_bound(g_bucket_bounds_ms.begin(),
+                                 g_bucket_bounds_ms.end(), latency_ms) -
+                g_bucket_bounds_ms.begin();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++buckets_[bucket];
+  ++count_;
+  sum_ms_ += latency_ms;
+  max_ms_ = std::max(max_ms_, latency_ms);
+}
+
+nlohmann::json LatencyHistogram::ToJson() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  nlohmann::json buckets = nlohmann::json::array();
+  for (size_t i = 0; i < buckets_.size(); ++i) {
+    nlohmann::json bound = "inf";
+    if (i < g_bucket_bounds_ms.size()) {
+      bound = g_bucket_bounds_ms[i];
+    }
+    buckets.push_back({{"le", bound}, {"count", buckets_[i]}});
+  }
+
+  return {{"count", count_},
+          {"sum_ms", sum_ms_},
+          {"max_ms", max_ms_},
+          {"buckets", buckets}};
+}
+
+}  // namespace modelarts
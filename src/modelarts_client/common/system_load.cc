@@ -0,0 +1,93 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <log.h>
+#include <system_load.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace modelarts {
+
+constexpr const char *PROC_STAT_PATH = "/proc/stat";
+constexpr const char *PROC_MEMINFO_PATH = "/proc/meminfo";
+
+modelbox::Status SystemLoadSampler::SampleCpuUsage(double &usage) {
+  std::ifstream file(PROC_STAT_PATH);
+  if (file.fail()) {
+    return {modelbox::STATUS_FAULT, "open /proc/stat failed."};
+  }
+
+  std::string line;
+  std::getline(file, line);
+  std::istringstream line_stream(line);
+  std::string cpu;
+  uint64_t user = 0, nice = 0, system = 0, idle = 0, iowait = 0, irq = 0,
+           softirq = 0, steal = 0;
+  line_stream >> cpu >> user >> nice >> system >> idle >> iowait >> irq >>
+      softirq >> steal;
+  if (line_stream.fail() || cpu != "cpu") {
+    return {modelbox::STATUS_FAULT, "parse /proc/stat failed."};
+  }
+
+  auto idle_all = idle + iowait;
+  auto total = user + nice + system + irq + softirq + steal + idle_all;
+
+  std::lock_guard<std::mutex> lock(sample_mutex_);
+  if (last_total_ != 0 && total > last_total_) {
+    auto total_delta = total - last_total_;
+    auto idle_delta = idle_all - last_idle_;
+    last_usage_ = 100.0 * (total_delta - idle_delta) / total_delta;
+  }
+  last_total_ = total;
+  last_idle_ = idle_all;
+  usage = last_usage_;
+  return modelbox::STATUS_SUCCESS;
+}
+
+modelbox::Status SystemLoadSampler::SampleMemoryUsage(double &usage) {
+  std::ifstream file(PROC_MEMINFO_PATH);
+  if (file.fail()) {
+    return {modelbox::STATUS_FAULT, "open /proc/meminfo failed."};
+  }
+
+  uint64_t mem_total = 0;
+  uint64_t mem_available = 0;
+  std::string key;
+  uint64_t value = 0;
+  std::string unit;
+  while (file >> key >> value >> unit) {
+    if (key == "MemTotal:") {
+      mem_total = value;
+    } else if (key == "MemAvailable:") {
+      mem_available = value;
+    }
+
+    if (mem_total != 0 && mem_available != 0) {
+      break;
+    }
+  }
+
+  if (mem_total == 0) {
+    return {modelbox::STATUS_FAULT, "parse /proc/meminfo failed."};
+  }
+
+  usage = 100.0 * (mem_total - mem_available) / mem_total;
+  return modelbox::STATUS_SUCCESS;
+}
+
+}  // namespace modelarts
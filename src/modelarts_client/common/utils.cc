@@ -15,6 +15,7 @@
  */
 
 #include <log.h>
+#include <openssl/evp.h>
 #include <utils.h>
 
 #include <chrono>
@@ -92,4 +93,21 @@ bool IsExpire(const std::string &expire) {
   return false;
 }
 
+std::string Sha256Hex(const std::string &data) {
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int digest_len = 0;
+  if (EVP_Digest(data.data(), data.size(), digest, &digest_len, EVP_sha256(),
+                 nullptr) != 1) {
+    MBLOG_WARN << "sha256 digest failed.";
+    return "";
+  }
+
+  std::stringstream hex;
+  hex << std::hex << std::setfill('0');
+  for (unsigned int i = 0; i < digest_len; ++i) {
+    hex << std::setw(2) << static_cast<int>(digest[i]);
+  }
+  return hex.str();
+}
+
 }  // namespace modelarts
\ No newline at end of file
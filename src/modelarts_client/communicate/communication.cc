@@ -49,4 +49,39 @@ Communication::MsgPostHandler Communication::FindMsgPostHandle(
   return callback->second;
 }
 
+void Communication::SetExecutor(const std::shared_ptr<Executor> &executor) {
+  executor_ = executor;
+}
+
+modelbox::Status Communication::Flush(int timeout_ms) {
+  return modelbox::STATUS_SUCCESS;
+}
+
+modelbox::Status Communication::StopListen() {
+  return modelbox::STATUS_SUCCESS;
+}
+
+modelbox::Status Communication::TakeOverListen() {
+  return modelbox::STATUS_SUCCESS;
+}
+
+void Communication::SendMsgAsync(const std::string &order_key,
+                                 const std::string &msg,
+                                 const SendCallback &callback) {
+  if (executor_ == nullptr) {
+    auto status = SendMsg(msg);
+    if (callback) {
+      callback(status);
+    }
+    return;
+  }
+
+  executor_->Submit([this, msg, callback]() {
+    auto status = this->SendMsg(msg);
+    if (callback) {
+      callback(status);
+    }
+  });
+}
+
 }  // namespace modelarts
\ No newline at end of file
@@ -0,0 +1,213 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "handover_channel.h"
+
+#include <cpu_affinity.h>
+#include <log.h>
+#include <poll.h>
+#include <securec.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace modelarts {
+
+constexpr const char *HANDOVER_REQUEST = "HANDOVER";
+constexpr const char *HANDOVER_REPLY_OK = "OK";
+constexpr int HANDOVER_POLL_MS = 200;
+constexpr int HANDOVER_READ_TIMEOUT_MS = 1000;
+constexpr size_t HANDOVER_MAX_LINE = 256;
+
+static bool MakeAddress(const std::string &path, struct sockaddr_un &addr) {
+  (void)memset_s(&addr, sizeof(addr), 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    return false;
+  }
+  return strncpy_s(addr.sun_path, sizeof(addr.sun_path), path.c_str(),
+                   path.size()) == EOK;
+}
+
+static void SetRecvTimeout(int fd, int timeout_ms) {
+  struct timeval tv;
+  tv.tv_sec = timeout_ms / 1000;
+  tv.tv_usec = (timeout_ms % 1000) * 1000;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+static bool ReadLine(int fd, std::string &line) {
+  line.clear();
+  char c = 0;
+  while (line.size() < HANDOVER_MAX_LINE) {
+    auto len = read(fd, &c, 1);
+    if (len < 0 && errno == EINTR) {
+      continue;
+    }
+    if (len <= 0) {
+      return false;
+    }
+    if (c == '\n') {
+      return true;
+    }
+    line.push_back(c);
+  }
+  return false;
+}
+
+static bool WriteLine(int fd, const std::string &line) {
+  auto data = line + "\n";
+  return send(fd, data.data(), data.size(), MSG_NOSIGNAL) ==
+         (ssize_t)data.size();
+}
+
+HandoverChannel::HandoverChannel(const std::string &path) : path_(path) {}
+
+HandoverChannel::~HandoverChannel() { Stop(); }
+
+modelbox::Status HandoverChannel::Request(int timeout_ms) {
+  struct sockaddr_un addr;
+  if (!MakeAddress(path_, addr)) {
+    return {modelbox::STATUS_INVALID, "handover path is too long: " + path_};
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return {modelbox::STATUS_FAULT, strerror(errno)};
+  }
+
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    auto err = errno;
+    close(fd);
+    if (err == ENOENT || err == ECONNREFUSED) {
+      return modelbox::STATUS_NOTFOUND;
+    }
+    return {modelbox::STATUS_FAULT, strerror(err)};
+  }
+
+  MBLOG_INFO << "handover: request takeover from running process.";
+  SetRecvTimeout(fd, timeout_ms);
+  std::string reply;
+  if (!WriteLine(fd, HANDOVER_REQUEST) || !ReadLine(fd, reply)) {
+    close(fd);
+    return {modelbox::STATUS_TIMEDOUT, "no reply from running process"};
+  }
+  close(fd);
+
+  if (reply != HANDOVER_REPLY_OK) {
+    return {modelbox::STATUS_FAULT, "handover refused: " + reply};
+  }
+  MBLOG_INFO << "handover: running process released its tasks.";
+  return modelbox::STATUS_SUCCESS;
+}
+
+modelbox::Status HandoverChannel::Serve(const HandoverFunc &func) {
+  struct sockaddr_un addr;
+  if (!MakeAddress(path_, addr)) {
+    return {modelbox::STATUS_INVALID, "handover path is too long: " + path_};
+  }
+
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd_ < 0) {
+    return {modelbox::STATUS_FAULT, strerror(errno)};
+  }
+
+  // a stale socket is left behind by a process that did not exit cleanly
+  unlink(path_.c_str());
+  if (bind(listen_fd_, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      chmod(path_.c_str(), S_IRUSR | S_IWUSR) != 0 ||
+      listen(listen_fd_, 1) != 0) {
+    auto err = std::string(strerror(errno));
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return {modelbox::STATUS_FAULT, "serve " + path_ + " failed, " + err};
+  }
+
+  struct stat path_stat;
+  if (stat(path_.c_str(), &path_stat) == 0) {
+    listen_inode_ = path_stat.st_ino;
+  }
+
+  func_ = func;
+  running_ = true;
+  serve_thread_ = std::thread(&HandoverChannel::ServeLoop, this);
+  MBLOG_INFO << "handover: serve on " << path_;
+  return modelbox::STATUS_SUCCESS;
+}
+
+void HandoverChannel::Stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+
+  if (serve_thread_.joinable()) {
+    serve_thread_.join();
+  }
+
+  // the path belongs to the new process once a handover has happened
+  struct stat path_stat;
+  if (stat(path_.c_str(), &path_stat) == 0 &&
+      path_stat.st_ino == listen_inode_) {
+    unlink(path_.c_str());
+  }
+  close(listen_fd_);
+  listen_fd_ = -1;
+}
+
+void HandoverChannel::ServeLoop() {
+  CpuAffinity::GetInstance()->BindControlThread("handover");
+  struct pollfd pfd;
+  pfd.fd = listen_fd_;
+  pfd.events = POLLIN;
+  while (running_) {
+    pfd.revents = 0;
+    auto ret = poll(&pfd, 1, HANDOVER_POLL_MS);
+    if (ret <= 0) {
+      continue;
+    }
+
+    int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      continue;
+    }
+    HandleRequest(fd);
+    close(fd);
+  }
+}
+
+void HandoverChannel::HandleRequest(int fd) {
+  SetRecvTimeout(fd, HANDOVER_READ_TIMEOUT_MS);
+  std::string request;
+  if (!ReadLine(fd, request) || request != HANDOVER_REQUEST) {
+    MBLOG_WARN << "handover: ignore invalid request.";
+    return;
+  }
+
+  MBLOG_INFO << "handover: new process takes over, release tasks.";
+  auto status = func_();
+  if (!status) {
+    MBLOG_ERROR << "handover: release tasks failed, " << status.WrapErrormsgs();
+    WriteLine(fd, status.Errormsg());
+    return;
+  }
+  WriteLine(fd, HANDOVER_REPLY_OK);
+}
+
+}  // namespace modelarts
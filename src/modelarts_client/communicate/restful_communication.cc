@@ -16,13 +16,30 @@
 
 #include "restful_communication.h"
 
+#include <linux/filter.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
 #include "communication_factory.h"
+#include "compress.h"
+#include "cpu_affinity.h"
 #include "signer.h"
 #include "utils.h"
 
 namespace modelarts {
 
 constexpr const char *MA_TASK_IP = "0.0.0.0";
+constexpr const char *DEFAULT_READY_URI = "/health/ready";
+constexpr const char *DEFAULT_DRAIN_URI = "/admin/drain";
+constexpr const char *DEFAULT_METRICS_URI = "/metrics";
+constexpr int SEND_RETRY_COUNT = 10;
+constexpr int SEND_RETRY_INTERVAL_MS = 5000;
+constexpr int SERVER_TIMEOUT_SEC = 10;
+constexpr int SERVER_START_TIMEOUT_MS = 5000;
+constexpr int ACCEPT_DRAIN_TIMEOUT_MS = 2000;
+constexpr int ACCEPT_DRAIN_POLL_MS = 10;
 
 REGISTER_COMMUNICATE("cloud", RestfulCommunication);
 RestfulCommunication::RestfulCommunication(
@@ -53,73 +70,105 @@ modelbox::Status RestfulCommunication::GetAkSk(std::string &ak,
   return modelbox::STATUS_SUCCESS;
 }
 
-modelbox::Status SendWithRetry(
+static modelbox::Status SendOnce(
     const std::string &url,
     const std::shared_ptr<RequestParams> &request_self) {
-  int retry_count = 10;
-  do {
-    httplib::Headers headers;
-    for (auto header : *(request_self->getHeaders())) {
-      headers.insert({header.getKey(), header.getValue()});
-      MBLOG_DEBUG << header.getKey() << ", " << header.getValue();
-    }
+  httplib::Headers headers;
+  for (auto header : *(request_self->getHeaders())) {
+    headers.insert({header.getKey(), header.getValue()});
+    MBLOG_DEBUG << header.getKey() << ", " << header.getValue();
+  }
 
-    modelbox::HttpRequest request(modelbox::HttpMethods::POST, url);
-    request.SetHeaders(headers);
-    request.SetBody(request_self->getPayload());
-    auto ret = SendHttpRequest(request);
-    if (!ret) {
-      --retry_count;
-      MBLOG_WARN << "Send request failed, retry count: " << retry_count
-                 << ", error: " << ret.WrapErrormsgs();
-      continue;
-    }
+  modelbox::HttpRequest request(modelbox::HttpMethods::POST, url);
+  request.SetHeaders(headers);
+  request.SetBody(request_self->getPayload());
+  auto ret = SendHttpRequest(request);
+  if (!ret) {
+    return {ret, "send request failed."};
+  }
+
+  auto response = request.GetResponse();
+  if (response.status / 100 != 2) {
+    auto msg = std::string("HttpRequest failed, status code:") +
+               std::to_string(response.status) + std::string(" respbody: ") +
+               response.body;
+    return {modelbox::STATUS_FAULT, msg};
+  }
+  return modelbox::STATUS_SUCCESS;
+}
 
-    auto response = request.GetResponse();
-    if (response.status / 100 == 2) {
+modelbox::Status SendWithRetry(
+    const std::string &url,
+    const std::shared_ptr<RequestParams> &request_self) {
+  int retry_count = SEND_RETRY_COUNT;
+  do {
+    auto ret = SendOnce(url, request_self);
+    if (ret) {
       MBLOG_INFO << "SendMsg success.";
       return modelbox::STATUS_SUCCESS;
     }
     --retry_count;
-    auto msg = std::string("HttpRequest failed, status code:") +
-               std::to_string(response.status) + std::string(" respbody: ") +
-               response.body;
     MBLOG_ERROR << "SendMsg failed. retry count:" << retry_count
-                << " msg:" << msg;
-    std::this_thread::sleep_for(std::chrono::seconds(5));
-
+                << " msg:" << ret.WrapErrormsgs();
+    if (retry_count != 0) {
+      std::this_thread::sleep_for(
+          std::chrono::milliseconds(SEND_RETRY_INTERVAL_MS));
+    }
   } while (retry_count != 0);
 
   MBLOG_ERROR << "SendMsg failed.";
   return modelbox::STATUS_FAULT;
 }
 
+modelbox::Status RestfulCommunication::BuildRequest(
+    const std::string &msg, std::string &url,
+    std::shared_ptr<RequestParams> &request_self) {
+  std::string ak;
+  std::string sk;
+  auto ret = GetAkSk(ak, sk);
+  if (!ret) {
+    return ret;
+  }
+  std::string host;
+  std::string uri;
+  ret = GetSignerUrlInfo(host, uri);
+  if (!ret) {
+    return ret;
+  }
+
+  std::string payload;
+  bool compressed = false;
+  ret = CompressPayload(msg, payload, compressed);
+  if (!ret) {
+    MBLOG_WARN << "compress msg failed, send it uncompressed, error:"
+               << ret.WrapErrormsgs();
+  }
+
+  request_self = std::make_shared<RequestParams>("POST", host, "/" + uri + "/",
+                                                 "", payload);
+  request_self->addHeader("content-type", "application/json");
+  if (compressed) {
+    request_self->addHeader("content-encoding", CONTENT_ENCODING_GZIP);
+  }
+  Signer signer(ak, sk);
+  signer.createSignature(request_self.get());
+  url = config_->GetString(CONFIG_NOTIFY_URL);
+  MBLOG_INFO << "send msg to modelarts, url: " << url
+             << " , payload: " << DataMasking(msg) << " , size: " << msg.size()
+             << "/" << payload.size();
+  return modelbox::STATUS_SUCCESS;
+}
+
 modelbox::Status RestfulCommunication::SendMsg(const std::string &msg) {
   MBLOG_INFO << "start send message: " << DataMasking(msg);
   try {
-    std::string ak;
-    std::string sk;
-    auto ret = GetAkSk(ak, sk);
-    if (!ret) {
-      MBLOG_ERROR << "SendMsg failed, error:" << ret.WrapErrormsgs();
-      return modelbox::STATUS_FAULT;
-    }
-    std::string host;
-    std::string uri;
-    ret = GetSignerUrlInfo(host, uri);
+    std::string url;
+    std::shared_ptr<RequestParams> request_self;
+    auto ret = BuildRequest(msg, url, request_self);
     if (!ret) {
       MBLOG_ERROR << "SendMsg failed, error:" << ret.WrapErrormsgs();
       return modelbox::STATUS_FAULT;
     }
-
-    std::shared_ptr<RequestParams> request_self =
-        std::make_shared<RequestParams>("POST", host, "/" + uri + "/", "", msg);
-    request_self->addHeader("content-type", "application/json");
-    Signer signer(ak, sk);
-    signer.createSignature(request_self.get());
-    std::string url = config_->GetString(CONFIG_NOTIFY_URL);
-    MBLOG_INFO << "send msg to modelarts, url: " << url
-               << " , payload: " << DataMasking(msg);
     ret = SendWithRetry(url, request_self);
     if (!ret) {
       MBLOG_ERROR << "SendMsg failed, error:" << ret.WrapErrormsgs();
@@ -133,6 +182,136 @@ modelbox::Status RestfulCommunication::SendMsg(const std::string &msg) {
   return modelbox::STATUS_SUCCESS;
 }
 
+void RestfulCommunication::SendMsgAsync(const std::string &order_key,
+                                        const std::string &msg,
+                                        const SendCallback &callback) {
+  if (executor_ == nullptr) {
+    Communication::SendMsgAsync(order_key, msg, callback);
+    return;
+  }
+
+  MBLOG_INFO << "start send message async: " << DataMasking(msg);
+  auto pending = std::make_shared<PendingMsg>();
+  modelbox::Status ret = modelbox::STATUS_SUCCESS;
+  try {
+    ret = BuildRequest(msg, pending->url, pending->request);
+  } catch (std::exception &e) {
+    ret = {modelbox::STATUS_FAULT, std::string("exception: ") + e.what()};
+  }
+  if (!ret) {
+    MBLOG_ERROR << "SendMsgAsync failed, error:" << ret.WrapErrormsgs();
+    if (callback) {
+      callback(ret);
+    }
+    return;
+  }
+
+  pending->retry_count = SEND_RETRY_COUNT;
+  pending->callback = callback;
+  {
+    std::lock_guard<std::mutex> lock(send_queue_mutex_);
+    auto &queue = send_queues_[order_key];
+    queue.push_back(pending);
+    ++unsent_num_;
+    // the head of a non empty queue is already being sent or retried
+    if (queue.size() > 1) {
+      return;
+    }
+  }
+  executor_->Submit([this, order_key]() { this->SendNextMsg(order_key); });
+}
+
+void RestfulCommunication::SendNextMsg(const std::string &order_key) {
+  std::shared_ptr<PendingMsg> pending;
+  {
+    std::lock_guard<std::mutex> lock(send_queue_mutex_);
+    auto queue = send_queues_.find(order_key);
+    if (queue == send_queues_.end() || queue->second.empty()) {
+      return;
+    }
+    pending = queue->second.front();
+  }
+
+  auto ret = SendOnce(pending->url, pending->request);
+  if (!ret && --pending->retry_count > 0) {
+    MBLOG_WARN << "SendMsg failed. retry count:" << pending->retry_count
+               << " key: " << order_key << " msg:" << ret.WrapErrormsgs();
+    auto timer_id = executor_->Schedule(
+        SEND_RETRY_INTERVAL_MS,
+        [this, order_key]() { this->SendNextMsg(order_key); });
+    if (timer_id != INVALID_TIMER_ID) {
+      return;
+    }
+  }
+
+  if (ret) {
+    MBLOG_INFO << "SendMsg success.";
+  } else {
+    MBLOG_ERROR << "SendMsg failed. " << ret.WrapErrormsgs();
+  }
+
+  bool has_next = false;
+  {
+    std::lock_guard<std::mutex> lock(send_queue_mutex_);
+    auto queue = send_queues_.find(order_key);
+    if (queue != send_queues_.end() && !queue->second.empty() &&
+        queue->second.front() == pending) {
+      queue->second.pop_front();
+      --unsent_num_;
+      has_next = !queue->second.empty();
+      if (!has_next) {
+        send_queues_.erase(queue);
+      }
+    }
+    if (unsent_num_ == 0) {
+      send_queue_cond_.notify_all();
+    }
+  }
+  if (pending->callback) {
+    pending->callback(ret);
+  }
+  if (has_next) {
+    executor_->Submit([this, order_key]() { this->SendNextMsg(order_key); });
+  }
+}
+
+modelbox::Status RestfulCommunication::Flush(int timeout_ms) {
+  std::unique_lock<std::mutex> lock(send_queue_mutex_);
+  auto flushed = send_queue_cond_.wait_for(
+      lock, std::chrono::milliseconds(timeout_ms),
+      [this]() { return unsent_num_ == 0; });
+  if (!flushed) {
+    return {modelbox::STATUS_TIMEDOUT,
+            "flush timeout, unsent messages: " + std::to_string(unsent_num_)};
+  }
+  return modelbox::STATUS_SUCCESS;
+}
+
+modelbox::Status RestfulCommunication::CompressPayload(const std::string &msg,
+                                                       std::string &payload,
+                                                       bool &compressed) {
+  payload = msg;
+  compressed = false;
+  auto threshold = config_->GetInt(CONFIG_NOTIFY_COMPRESS_THRESHOLD, 0);
+  if (threshold <= 0 || msg.size() < (size_t)threshold) {
+    return modelbox::STATUS_SUCCESS;
+  }
+
+  std::string gzip_msg;
+  auto ret = GzipCompress(msg, gzip_msg);
+  if (!ret) {
+    return ret;
+  }
+
+  if (gzip_msg.size() >= msg.size()) {
+    return modelbox::STATUS_SUCCESS;
+  }
+
+  payload = std::move(gzip_msg);
+  compressed = true;
+  return modelbox::STATUS_SUCCESS;
+}
+
 modelbox::Status RestfulCommunication::SetupSSLServerConfig(
     const std::string &cert, const std::string &key,
     modelbox::HttpServerConfig &server_config) {
@@ -172,44 +351,162 @@ modelbox::Status RestfulCommunication::SetupSSLServerConfig(
 }
 
 modelbox::Status RestfulCommunication::Start() {
-  server_->Start();
+  auto port = config_->GetInt(CONFIG_TASK_PORT, 0);
+  if (!server_->bind_to_port(MA_TASK_IP, port)) {
+    return {modelbox::STATUS_FAULT,
+            "bind task port " + std::to_string(port) + " failed"};
+  }
+
+  // a restart binds the port while this process still listens on it
+  int reuse_port = 0;
+  socklen_t len = sizeof(reuse_port);
+  if (getsockopt(listen_fd_, SOL_SOCKET, SO_REUSEPORT, &reuse_port, &len) !=
+          0 ||
+      reuse_port == 0) {
+    MBLOG_WARN << "SO_REUSEPORT is not set on the task port, a restarting "
+                  "process cannot take it over";
+  }
+
+  auto server = server_;
+  listen_thread_ = std::thread([server]() { server->listen_after_bind(); });
+  // stop() is a no-op until the accept loop runs
+  for (int waited = 0; !server_->is_running(); ++waited) {
+    if (waited >= SERVER_START_TIMEOUT_MS) {
+      server_->stop();
+      listen_thread_.detach();
+      return {modelbox::STATUS_FAULT, "task server start timeout"};
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  listening_ = true;
   MBLOG_INFO << "restful communication start.";
   return modelbox::STATUS_SUCCESS;
 }
 
+void RestfulCommunication::SetListenSocketOptions(int sock) {
+  int yes = 1;
+  if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) != 0 ||
+      setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) != 0) {
+    MBLOG_WARN << "set listen socket options failed, errno: " << errno;
+  }
+  listen_fd_ = sock;
+}
+
+modelbox::Status RestfulCommunication::TakeOverListen() {
+  if (!listening_) {
+    return {modelbox::STATUS_FAULT, "not listening"};
+  }
+
+  // the kernel numbers the sockets of a reuseport group in listen order, the
+  // running process is the first one and this process the second; once the
+  // first one closes the index is out of range and the kernel hashes again
+  struct sock_filter code[] = {{BPF_RET | BPF_K, 0, 0, 1}};
+  struct sock_fprog prog = {1, code};
+  if (setsockopt(listen_fd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog,
+                 sizeof(prog)) != 0) {
+    return {modelbox::STATUS_FAULT,
+            "steer connections failed, errno: " + std::to_string(errno)};
+  }
+
+  MBLOG_INFO << "restful communication takes over new connections.";
+  return modelbox::STATUS_SUCCESS;
+}
+
+void RestfulCommunication::WaitAcceptQueueEmpty(int timeout_ms) {
+  // tcpi_unacked of a listening socket is the length of its accept queue,
+  // it is checked twice so handshakes completing meanwhile are served too
+  int empty_count = 0;
+  for (int waited = 0; waited < timeout_ms && empty_count < 2;
+       waited += ACCEPT_DRAIN_POLL_MS) {
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    if (getsockopt(listen_fd_, IPPROTO_TCP, TCP_INFO, &info, &len) != 0) {
+      return;
+    }
+    empty_count = info.tcpi_unacked == 0 ? empty_count + 1 : 0;
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(ACCEPT_DRAIN_POLL_MS));
+  }
+  if (empty_count < 2) {
+    MBLOG_WARN << "accept queue not empty, queued connections are dropped";
+  }
+}
+
+modelbox::Status RestfulCommunication::StopListen() {
+  if (listening_.exchange(false)) {
+    // closing the listener resets the connections queued on it
+    WaitAcceptQueueEmpty(ACCEPT_DRAIN_TIMEOUT_MS);
+    server_->stop();
+    if (listen_thread_.joinable()) {
+      listen_thread_.join();
+    }
+    MBLOG_INFO << "restful communication stop listen.";
+  }
+  return modelbox::STATUS_SUCCESS;
+}
+
 modelbox::Status RestfulCommunication::Stop() {
-  server_->Stop();
+  StopListen();
+  {
+    std::lock_guard<std::mutex> lock(send_queue_mutex_);
+    if (unsent_num_ != 0) {
+      MBLOG_WARN << "drop unsent messages: " << unsent_num_;
+    }
+    send_queues_.clear();
+    unsent_num_ = 0;
+    send_queue_cond_.notify_all();
+  }
   MBLOG_INFO << "restful communication stop.";
   return modelbox::STATUS_SUCCESS;
 }
 
 modelbox::Status RestfulCommunication::Init() {
-  std::string ip = MA_TASK_IP;
-  std::string task_port = config_->GetString(CONFIG_TASK_PORT);
+  auto port = config_->GetInt(CONFIG_TASK_PORT, 0);
+  if (port <= 0 || port > UINT16_MAX) {
+    MBLOG_ERROR << "Init server failed, invalid task port: "
+                << config_->GetString(CONFIG_TASK_PORT);
+    return modelbox::STATUS_FAULT;
+  }
   std::string task_uri = config_->GetString(CONFIG_TASK_URI);
 
-  modelbox::HttpServerConfig server_config;
-  server_config.SetTimeout(std::chrono::seconds(10));
-  std::string endpoint = "http://" + ip + ":" + task_port;
+  server_ = std::make_shared<httplib::Server>();
+  server_->set_read_timeout(SERVER_TIMEOUT_SEC);
+  server_->set_write_timeout(SERVER_TIMEOUT_SEC);
+  server_->set_socket_options([this](httplib::socket_t sock) {
+    this->SetListenSocketOptions(sock);
+  });
 
-  server_ = std::make_shared<modelbox::HttpServer>(endpoint, server_config);
   auto task_func = std::bind(&RestfulCommunication::MsgProcess, this,
                              std::placeholders::_1, std::placeholders::_2);
-  server_->Register(task_uri, modelbox::HttpMethods::POST, task_func);
-  server_->Register(task_uri, modelbox::HttpMethods::DELETE, task_func);
-  server_->Register(task_uri, modelbox::HttpMethods::GET, task_func);
+  auto task_pattern = task_uri + ".*";
+  server_->Post(task_pattern, task_func);
+  server_->Delete(task_pattern, task_func);
+  server_->Get(task_pattern, task_func);
+
+  auto ready_uri = config_->GetString(CONFIG_READY_URI, DEFAULT_READY_URI);
+  server_->Get(ready_uri, [this](const httplib::Request &request,
+                                 httplib::Response &response) {
+    this->ControlMsgProcess(MA_READY_TYPE, request, response);
+  });
+  auto drain_uri = config_->GetString(CONFIG_DRAIN_URI, DEFAULT_DRAIN_URI);
+  server_->Post(drain_uri, [this](const httplib::Request &request,
+                                  httplib::Response &response) {
+    this->ControlMsgProcess(MA_DRAIN_TYPE, request, response);
+  });
+  auto metrics_uri =
+      config_->GetString(CONFIG_METRICS_URI, DEFAULT_METRICS_URI);
+  server_->Get(metrics_uri, [this](const httplib::Request &request,
+                                   httplib::Response &response) {
+    this->ControlMsgProcess(MA_METRICS_TYPE, request, response);
+  });
 
-  auto ret = server_->GetStatus();
-  if (!ret) {
-    MBLOG_ERROR << "Init server failed, err. " << ret;
-    return modelbox::STATUS_FAULT;
-  }
   MBLOG_INFO << "restful communication init success. ";
   return modelbox::STATUS_SUCCESS;
 }
 
 void RestfulCommunication::MsgProcess(const httplib::Request &request,
                                       httplib::Response &response) {
+  CpuAffinity::GetInstance()->BindControlThread("http");
   try {
     MBLOG_INFO << "MsgProcess: Receive message method: " << request.method;
 
@@ -217,7 +514,7 @@ void RestfulCommunication::MsgProcess(const httplib::Request &request,
       MBLOG_INFO << "CheckUrlVaild failed. ";
       return;
     }
-    auto msg_type = GetMsgType(request.method);
+    auto msg_type = GetMsgType(request);
     auto callback = FindMsgHandle(msg_type);
     if (callback == nullptr) {
       MBLOG_ERROR << "MsgProcess: FindMsgHandle failed, msg_type: " << msg_type;
@@ -255,6 +552,30 @@ void RestfulCommunication::MsgProcess(const httplib::Request &request,
   }
 }
 
+void RestfulCommunication::ControlMsgProcess(const std::string &msg_type,
+                                             const httplib::Request &request,
+                                             httplib::Response &response) {
+  CpuAffinity::GetInstance()->BindControlThread("http");
+  auto callback = FindMsgHandle(msg_type);
+  if (callback == nullptr) {
+    MBLOG_ERROR << "ControlMsgProcess: FindMsgHandle failed, msg_type: "
+                << msg_type;
+    response.status = modelbox::HttpStatusCodes::NOT_FOUND;
+    return;
+  }
+
+  std::string resp = "{}";
+  std::shared_ptr<void> ptr;
+  auto status = callback(request.body, resp, ptr);
+  response.status = StatusToHttpStatus(status);
+  response.set_content(resp, modelbox::JSON);
+
+  auto post_callback = FindMsgPostHandle(msg_type);
+  if (post_callback != nullptr) {
+    post_callback(request.body, resp, ptr);
+  }
+}
+
 bool RestfulCommunication::CheckUrlVaild(const std::string &request_url,
                                          httplib::Response &response) {
   std::string task_uri = config_->GetString(CONFIG_TASK_URI);
@@ -289,12 +610,14 @@ modelbox::HttpStatusCode RestfulCommunication::StatusToHttpStatus(
   return iter->second;
 }
 
-std::string RestfulCommunication::GetMsgType(const std::string &method) {
+std::string RestfulCommunication::GetMsgType(const httplib::Request &request) {
+  auto &method = request.method;
   if (method == modelbox::HttpMethods::POST) {
     return MA_CREATE_TYPE;
   }
   if (method == modelbox::HttpMethods::DELETE) {
-    return MA_DELETE_TYPE;
+    return ParseTaskId(request.path).empty() ? MA_DELETE_ALL_TYPE
+                                             : MA_DELETE_TYPE;
   }
   if (method == modelbox::HttpMethods::GET) {
     return MA_QUERY_TYPE;
@@ -19,6 +19,7 @@
 
 #include <cipher.h>
 #include <config.h>
+#include <executor.h>
 #include <status.h>
 
 #include <nlohmann/json.hpp>
@@ -29,6 +30,9 @@ constexpr const char *MA_CREATE_TYPE = "MA_CREATE_TYPE";
 constexpr const char *MA_DELETE_TYPE = "MA_DELETE_TYPE";
 constexpr const char *MA_QUERY_TYPE = "MA_QUERY_TYPE";
 constexpr const char *MA_DELETE_ALL_TYPE = "MA_DELETE_ALL_TYPE";
+constexpr const char *MA_READY_TYPE = "MA_READY_TYPE";
+constexpr const char *MA_DRAIN_TYPE = "MA_DRAIN_TYPE";
+constexpr const char *MA_METRICS_TYPE = "MA_METRICS_TYPE";
 constexpr const char *MA_ERROR_CODE = "error_code";
 constexpr const char *MA_ERROR_MSG = "error_msg";
 
@@ -43,22 +47,37 @@ class Communication {
   using MsgPostHandler =
       std::function<void(const std::string &msg, const std::string &resp,
                          std::shared_ptr<void> &ptr)>;
+  using SendCallback = std::function<void(const modelbox::Status &status)>;
 
   virtual modelbox::Status Init() = 0;
   virtual modelbox::Status Start() = 0;
   virtual modelbox::Status Stop() = 0;
   virtual modelbox::Status SendMsg(const std::string &msg) = 0;
+  /* messages with the same order key are sent in order, a failing one
+   * only holds back the messages of its own key */
+  virtual void SendMsgAsync(const std::string &order_key,
+                            const std::string &msg,
+                            const SendCallback &callback);
+  /* wait until queued async messages are sent or given up */
+  virtual modelbox::Status Flush(int timeout_ms);
+  /* stop taking inbound requests, outbound messages keep working */
+  virtual modelbox::Status StopListen();
+  /* route new inbound connections to this process, a process still
+   * listening on the same endpoint only serves what it already accepted */
+  virtual modelbox::Status TakeOverListen();
   virtual modelbox::Status RegisterMsgHandle(const std::string &msgtype,
                                              MsgHandler callback,
                                              MsgPostHandler post_callback);
   virtual MsgHandler FindMsgHandle(const std::string &msgtype);
   virtual MsgPostHandler FindMsgPostHandle(const std::string &msgtype);
+  void SetExecutor(const std::shared_ptr<Executor> &executor);
 
  public:
   std::shared_ptr<Config> config_;
   std::shared_ptr<Cipher> cipher_;
 
  protected:
+  std::shared_ptr<Executor> executor_;
   std::unordered_map<std::string, MsgHandler> register_msgrecive_process_;
   std::unordered_map<std::string, MsgPostHandler>
       register_msgrecive_post_process_;
@@ -0,0 +1,34 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MODELARTS_COMPRESS_H_
+#define MODELARTS_COMPRESS_H_
+
+#include <status.h>
+
+#include <string>
+
+namespace modelarts {
+
+constexpr const char *CONTENT_ENCODING_GZIP = "gzip";
+
+modelbox::Status GzipCompress(const std::string &input, std::string &output);
+
+modelbox::Status GzipDecompress(const std::string &input, std::string &output);
+
+}  // namespace modelarts
+
+#endif  // MODELARTS_COMPRESS_H_
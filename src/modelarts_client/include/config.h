@@ -35,6 +35,60 @@ constexpr const char *CONFIG_MAX_INPUT_COUNT = "alg.maxInputCount";
 constexpr const char *CONFIG_TASK_URI = "alg.task.uri";
 constexpr const char *CONFIG_TASK_PORT = "alg.task.port";
 constexpr const char *CONFIG_NOTIFY_URL = "alg.notify.url";
+constexpr const char *CONFIG_NOTIFY_COMPRESS_THRESHOLD =
+    "alg.notify.compress_threshold";
+constexpr const char *CONFIG_READY_URI = "alg.ready.uri";
+constexpr const char *CONFIG_DRAIN_URI = "alg.drain.uri";
+constexpr const char *CONFIG_METRICS_URI = "alg.metrics.uri";
+constexpr const char *CONFIG_DRAIN_TIMEOUT = "alg.drain.timeout";
+constexpr const char *CONFIG_DRAIN_FLUSH_TIMEOUT = "alg.drain.flush_timeout";
+constexpr const char *CONFIG_JOURNAL_PATH = "alg.journal.path";
+constexpr const char *CONFIG_JOURNAL_COMPACT_RECORDS =
+    "alg.journal.compact_records";
+constexpr const char *CONFIG_HANDOVER_SOCKET = "alg.handover.socket";
+constexpr const char *CONFIG_HANDOVER_TIMEOUT = "alg.handover.timeout";
+constexpr const char *CONFIG_WORKER_NUM = "alg.worker.num";
+constexpr const char *CONFIG_WORKER_HEALTH_INTERVAL =
+    "alg.worker.health_interval";
+constexpr const char *CONFIG_AFFINITY_CONTROL_CPUS =
+    "alg.affinity.control_cpus";
+constexpr const char *CONFIG_AFFINITY_TASK_CPUS = "alg.affinity.task_cpus";
+constexpr const char *CONFIG_AFFINITY_GROUP_SIZE = "alg.affinity.group_size";
+constexpr const char *CONFIG_AFFINITY_NUMA = "alg.affinity.numa";
+constexpr const char *CONFIG_TASK_STOP_TIMEOUT = "alg.task.stop_timeout";
+constexpr const char *CONFIG_TASK_DELETE_ALL_PARALLEL =
+    "alg.task.delete_all_parallel";
+constexpr const char *CONFIG_TASK_DELETE_ALL_TIMEOUT =
+    "alg.task.delete_all_timeout";
+constexpr const char *CONFIG_TASK_RETAIN_NUM = "alg.task.retain_num";
+constexpr const char *CONFIG_TASK_RETAIN_TTL = "alg.task.retain_ttl";
+constexpr const char *CONFIG_TASK_PROGRESS_INTERVAL =
+    "alg.task.progress_interval";
+constexpr const char *CONFIG_OBS_BATCH_CONCURRENCY =
+    "alg.obs.batch_concurrency";
+constexpr const char *CONFIG_OBS_BATCH_OBJECTS = "alg.obs.batch_objects";
+constexpr const char *CONFIG_OBS_LIST_BUFFER = "alg.obs.list_buffer";
+constexpr const char *CONFIG_OBS_PREFETCH_DIR = "alg.obs.prefetch_dir";
+constexpr const char *CONFIG_OBS_PREFETCH_MAX_MB = "alg.obs.prefetch_max_mb";
+constexpr const char *CONFIG_OBS_PREFETCH_DEPTH = "alg.obs.prefetch_depth";
+constexpr const char *CONFIG_OBS_CHECKPOINT_DIR = "alg.obs.checkpoint_dir";
+constexpr const char *CONFIG_OBS_CHECKPOINT_INTERVAL =
+    "alg.obs.checkpoint_interval";
+constexpr const char *CONFIG_EXECUTOR_WORKERS = "alg.executor.workers";
+constexpr const char *CONFIG_EXECUTOR_TICK_MS = "alg.executor.tick_ms";
+constexpr const char *CONFIG_EXECUTOR_TASK_WORKERS =
+    "alg.executor.task_workers";
+constexpr const char *CONFIG_HEARTBEAT_INTERVAL = "alg.heartbeat.interval";
+constexpr const char *CONFIG_HEARTBEAT_MAX_INTERVAL =
+    "alg.heartbeat.max_interval";
+constexpr const char *CONFIG_HEARTBEAT_RETRY_INTERVAL =
+    "alg.heartbeat.retry_interval";
+constexpr const char *CONFIG_HEARTBEAT_DEBOUNCE_MS =
+    "alg.heartbeat.debounce_ms";
+constexpr const char *CONFIG_HEARTBEAT_JITTER_PERCENT =
+    "alg.heartbeat.jitter_percent";
+constexpr const char *CONFIG_OVERLOAD_CPU_PERCENT = "alg.overload.cpu_percent";
+constexpr const char *CONFIG_OVERLOAD_MEM_PERCENT = "alg.overload.mem_percent";
 constexpr const char *CONFIG_DEVELOPER_PROJECTID = "developer.projectid";
 constexpr const char *CONFIG_DEVELOPER_DOMAIN_NAME = "developer.domain_name";
 constexpr const char *CONFIG_DEVELOPER_DOAMIN_ID = "developer.domain_id";
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MODELARTS_CPU_AFFINITY_H_
+#define MODELARTS_CPU_AFFINITY_H_
+
+#include <config.h>
+#include <status.h>
+#include <sys/types.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+namespace modelarts {
+
+/* parse a cpu list such as "0-3,8,10-11" */
+modelbox::Status ParseCpuList(const std::string &str, std::vector<int> &cpus);
+
+/*
+ * Affinity policy of the process. Control plane threads (executor, http
+ * handlers, handover) run on the control cpus, everything else on the task
+ * cpus. Task cpus are split into groups, never across a NUMA node when numa
+ * is set, and a pipeline worker process is pinned to one group. An empty
+ * cpu list leaves the threads where they are.
+ */
+class CpuAffinity {
+ public:
+  CpuAffinity() = default;
+  virtual ~CpuAffinity() = default;
+
+  static std::shared_ptr<CpuAffinity> &GetInstance() {
+    static auto affinity = std::make_shared<CpuAffinity>();
+    return affinity;
+  };
+
+  modelbox::Status Init(const std::shared_ptr<Config> &config);
+  /* pin all threads but the control ones to the task cpus, or one group */
+  void BindPipeline(int group = -1);
+  /* pin the calling thread to the control cpus, once per thread */
+  void BindControlThread(const std::string &name);
+  /* cpu time of each thread since it started, in ms */
+  nlohmann::json SampleThreadUsage();
+
+ private:
+  void BuildTaskGroups(size_t group_size, bool numa);
+
+ private:
+  std::mutex mutex_;
+  std::vector<int> control_cpus_;
+  std::vector<int> task_cpus_;
+  std::vector<std::vector<int>> task_groups_;
+  std::map<pid_t, std::string> control_threads_;
+};
+
+}  // namespace modelarts
+
+#endif  // MODELARTS_CPU_AFFINITY_H_
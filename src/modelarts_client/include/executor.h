@@ -0,0 +1,130 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MODELARTS_EXECUTOR_H_
+#define MODELARTS_EXECUTOR_H_
+
+#include <status.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace modelarts {
+
+using ExecutorFunc = std::function<void()>;
+using TimerId = uint64_t;
+
+constexpr TimerId INVALID_TIMER_ID = 0;
+
+struct ExecutorMetrics {
+  int workers{0};
+  uint64_t queue_depth{0};
+  uint64_t pending_timers{0};
+  uint64_t executed{0};
+  uint64_t stolen{0};
+  double avg_latency_ms{0};
+  double max_latency_ms{0};
+};
+
+/*
+ * Work stealing pool plus hierarchical timer wheel shared by the control
+ * plane. Each worker owns a deque, pops its own work LIFO and steals FIFO
+ * from the others when idle. Timers fire by submitting their function.
+ */
+class Executor : public std::enable_shared_from_this<Executor> {
+ public:
+  Executor(int worker_num, int tick_ms);
+  virtual ~Executor();
+
+  modelbox::Status Start();
+  void Stop();
+
+  /* false once the executor is stopped, the work is dropped */
+  bool Submit(const ExecutorFunc &func);
+  TimerId Schedule(int delay_ms, const ExecutorFunc &func);
+  bool Cancel(TimerId timer_id);
+
+  /* latency is measured from submit to start of run, since start */
+  ExecutorMetrics GetMetrics();
+
+ private:
+  struct Work {
+    ExecutorFunc func;
+    std::chrono::steady_clock::time_point submit_time;
+  };
+
+  struct Timer {
+    TimerId id;
+    uint64_t expire_tick;
+    ExecutorFunc func;
+  };
+
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Work> queue;
+    std::thread thread;
+  };
+
+  void WorkerLoop(size_t index);
+  bool PopWork(size_t index, Work &work);
+  void RunWork(Work &work);
+  void TimerLoop();
+  void AddTimer(const std::shared_ptr<Timer> &timer);
+  void AdvanceTick(std::vector<ExecutorFunc> &expired);
+  void Cascade(size_t level);
+  uint64_t CurrentTick() const;
+
+ private:
+  int worker_num_;
+  int tick_ms_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<size_t> next_worker_{0};
+  std::atomic<uint64_t> pending_work_{0};
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cond_;
+  std::atomic<bool> running_{false};
+
+  std::mutex timer_mutex_;
+  std::condition_variable timer_cond_;
+  std::thread timer_thread_;
+  std::vector<std::vector<std::list<std::shared_ptr<Timer>>>> wheel_;
+  std::unordered_map<TimerId, std::shared_ptr<Timer>> timers_;
+  uint64_t current_tick_{0};
+  TimerId next_timer_id_{INVALID_TIMER_ID};
+  std::chrono::steady_clock::time_point start_time_;
+
+  std::mutex metrics_mutex_;
+  uint64_t executed_{0};
+  uint64_t stolen_{0};
+  uint64_t latency_count_{0};
+  double latency_sum_ms_{0};
+  double latency_max_ms_{0};
+};
+
+}  // namespace modelarts
+
+#endif  // MODELARTS_EXECUTOR_H_
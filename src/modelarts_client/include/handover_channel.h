@@ -0,0 +1,65 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MODELARTS_HANDOVER_CHANNEL_H_
+#define MODELARTS_HANDOVER_CHANNEL_H_
+
+#include <modelbox/base/status.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace modelarts {
+
+using HandoverFunc = std::function<modelbox::Status()>;
+
+/*
+ * Unix socket used by a restarting process to take over from the running
+ * one. The new process binds the task port with SO_REUSEPORT and steers new
+ * connections to itself, then asks the old process to serve what it already
+ * queued, stop listening and hand its tasks over through the task journal.
+ */
+class HandoverChannel {
+ public:
+  explicit HandoverChannel(const std::string &path);
+  virtual ~HandoverChannel();
+
+  /* returns STATUS_NOTFOUND when no process serves the channel */
+  modelbox::Status Request(int timeout_ms);
+
+  /* serve requests in the background, func runs for each request */
+  modelbox::Status Serve(const HandoverFunc &func);
+  void Stop();
+
+ private:
+  void ServeLoop();
+  void HandleRequest(int fd);
+
+ private:
+  std::string path_;
+  int listen_fd_{-1};
+  ino_t listen_inode_{0};
+  std::atomic<bool> running_{false};
+  std::thread serve_thread_;
+  HandoverFunc func_;
+};
+
+}  // namespace modelarts
+
+#endif  // MODELARTS_HANDOVER_CHANNEL_H_
@@ -0,0 +1,49 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MODELARTS_LATENCY_HISTOGRAM_H_
+#define MODELARTS_LATENCY_HISTOGRAM_H_
+
+#include <cstdint>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <vector>
+
+namespace modelarts {
+
+/*
+ * Cumulative latency histogram with fixed millisecond buckets, exported
+ * with the upper bound of each bucket and an overflow bucket.
+ */
+class LatencyHistogram {
+ public:
+  LatencyHistogram();
+  virtual ~LatencyHistogram() = default;
+
+  void Observe(double latency_ms);
+  nlohmann::json ToJson();
+
+ private:
+  std::mutex mutex_;
+  std::vector<uint64_t> buckets_;
+  uint64_t count_{0};
+  double sum_ms_{0};
+  double max_ms_{0};
+};
+
+}  // namespace modelarts
+
+#endif  // MODELARTS_LATENCY_HISTOGRAM_H_
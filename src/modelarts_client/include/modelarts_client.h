@@ -20,32 +20,64 @@
 #include <cipher.h>
 #include <communication_factory.h>
 #include <config.h>
+#include <cpu_affinity.h>
+#include <executor.h>
+#include <handover_channel.h>
 #include <log.h>
 #include <task_manager.h>
+#include <task_registry.h>
 
 #include <string>
 
 namespace modelarts {
 
+using ShutdownFunc = std::function<void()>;
+
 class ModelArtsClient {
  public:
   ModelArtsClient() = default;
   ~ModelArtsClient() = default;
 
   modelbox::Status Init();
+  /* config, cipher, executor and registry only, for pipeline workers */
+  modelbox::Status InitWorker(size_t index);
   modelbox::Status Start();
   modelbox::Status Stop();
+  /* stop accepting tasks, wait for running ones and flush notifications,
+   * without waiting when no task runs and no drain was requested */
+  modelbox::Status Drain();
+  /* release the tasks to a new process taking over the task port */
+  modelbox::Status HandOver();
   void RegisterTaskMsgCallBack(const CreateTaskMsgFunc &create_func,
                                const DeleteTaskMsgFunc &delete_func);
+  void RegisterThroughputCallBack(const ThroughputFunc &throughput_func);
+  void RegisterMetricsCallBack(const MetricsFunc &metrics_func);
+  /* ends the process once its tasks are handed over */
+  void RegisterShutdownCallBack(const ShutdownFunc &shutdown_func);
   modelbox::Status UpdateTaskStatus(const std::string &task_id,
-                                    const TaskStatusCode &status);
+                                    const TaskStatusCode &status,
+                                    const std::string &reason = "");
+  /* the pipeline of the task produced its first output */
+  void ReportFirstFrame(const std::string &task_id);
+  void UpdateTaskProgress(const std::string &task_id,
+                          const TaskProgress &progress);
   TaskStatusCode GetTaskStatus(const std::string &task_id);
 
  public:
   std::shared_ptr<Config> config_;
   std::shared_ptr<Cipher> cipher_;
+  std::shared_ptr<Executor> executor_;
+  /* blocking pipeline create and stop, kept off the control executor */
+  std::shared_ptr<Executor> task_executor_;
   std::shared_ptr<Communication> communication_;
   std::shared_ptr<TaskManager> task_manager_;
+  std::shared_ptr<TaskRegistry> task_registry_;
+  std::shared_ptr<HandoverChannel> handover_;
+
+ private:
+  modelbox::Status InitCore(int pipeline_group);
+
+  ShutdownFunc shutdown_func_;
 };
 }  // namespace modelarts
 
@@ -17,11 +17,16 @@
 #ifndef MODELARTS_RESTFUL_COMMUNICATION_H_
 #define MODELARTS_RESTFUL_COMMUNICATION_H_
 
+#include <condition_variable>
+#include <deque>
 #include <map>
+#include <thread>
 
 #include "communication.h"
 #include "modelbox/server/http_helper.h"
 
+class RequestParams;
+
 namespace modelarts {
 
 const std::map<MAHttpStatusCode, modelbox::HttpStatusCode> http_status_map_ = {
@@ -31,7 +36,9 @@ const std::map<MAHttpStatusCode, modelbox::HttpStatusCode> http_status_map_ = {
     {STATUS_HTTP_NO_CONTENT, modelbox::HttpStatusCodes::NO_CONTENT},
     {STATUS_HTTP_BAD_REQUEST, modelbox::HttpStatusCodes::BAD_REQUEST},
     {STATUS_HTTP_NOT_FOUND, modelbox::HttpStatusCodes::NOT_FOUND},
-    {STATUS_HTTP_INTERNAL_ERROR, modelbox::HttpStatusCodes::INTERNAL_ERROR}};
+    {STATUS_HTTP_INTERNAL_ERROR, modelbox::HttpStatusCodes::INTERNAL_ERROR},
+    {STATUS_HTTP_SERVICE_UNAVAILABLE,
+     modelbox::HttpStatusCodes::SERVICE_UNAVAILABLE}};
 
 class RestfulCommunication : public Communication {
  public:
@@ -43,12 +50,27 @@ class RestfulCommunication : public Communication {
   modelbox::Status Start() override;
   modelbox::Status Stop() override;
   modelbox::Status SendMsg(const std::string &msg) override;
+  void SendMsgAsync(const std::string &order_key, const std::string &msg,
+                    const SendCallback &callback) override;
+  modelbox::Status Flush(int timeout_ms) override;
+  modelbox::Status StopListen() override;
+  modelbox::Status TakeOverListen() override;
 
  private:
+  struct PendingMsg {
+    std::string url;
+    std::shared_ptr<RequestParams> request;
+    int retry_count{0};
+    SendCallback callback;
+  };
+
   modelbox::Status SetupSSLServerConfig(
       const std::string &cert, const std::string &key,
       modelbox::HttpServerConfig &server_config);
   void MsgProcess(const httplib::Request &request, httplib::Response &response);
+  void ControlMsgProcess(const std::string &msg_type,
+                         const httplib::Request &request,
+                         httplib::Response &response);
 
   bool CheckUrlVaild(const std::string &request_url,
                      httplib::Response &response);
@@ -57,7 +79,7 @@ class RestfulCommunication : public Communication {
 
   modelbox::HttpStatusCode StatusToHttpStatus(MAHttpStatusCode status) const;
 
-  std::string GetMsgType(const std::string &method);
+  std::string GetMsgType(const httplib::Request &request);
   std::string GetMsgRequestInfo(const httplib::Request &request);
 
   modelbox::Status GetStringByPath(const std::string &path,
@@ -67,10 +89,26 @@ class RestfulCommunication : public Communication {
 
   modelbox::Status GetAkSk(std::string &ak, std::string &sk);
   std::string FilterHttpPrefix(const std::string &url);
+  modelbox::Status CompressPayload(const std::string &msg, std::string &payload,
+                                   bool &compressed);
+  modelbox::Status BuildRequest(const std::string &msg, std::string &url,
+                                std::shared_ptr<RequestParams> &request_self);
+  void SendNextMsg(const std::string &order_key);
+  void SetListenSocketOptions(int sock);
+  void WaitAcceptQueueEmpty(int timeout_ms);
 
  private:
-  std::shared_ptr<modelbox::HttpServer> server_;
+  /* cpp-httplib directly, the task port needs its socket options */
+  std::shared_ptr<httplib::Server> server_;
+  std::thread listen_thread_;
+  int listen_fd_{-1};
+  std::atomic<bool> listening_{false};
   std::mutex msg_concurrency_mutex_;
+  std::mutex send_queue_mutex_;
+  std::condition_variable send_queue_cond_;
+  /* one fifo per order key, dropped once empty */
+  std::map<std::string, std::deque<std::shared_ptr<PendingMsg>>> send_queues_;
+  size_t unsent_num_{0};
 };
 
 }  // namespace modelarts
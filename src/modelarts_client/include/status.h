@@ -27,7 +27,8 @@ enum MAHttpStatusCode {
   STATUS_HTTP_NO_CONTENT = 204,
   STATUS_HTTP_BAD_REQUEST = 400,
   STATUS_HTTP_NOT_FOUND = 404,
-  STATUS_HTTP_INTERNAL_ERROR = 500
+  STATUS_HTTP_INTERNAL_ERROR = 500,
+  STATUS_HTTP_SERVICE_UNAVAILABLE = 503
 };
 
 }
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MODELARTS_SYSTEM_LOAD_H_
+#define MODELARTS_SYSTEM_LOAD_H_
+
+#include <status.h>
+
+#include <cstdint>
+#include <mutex>
+
+namespace modelarts {
+
+class SystemLoadSampler {
+ public:
+  SystemLoadSampler() = default;
+  virtual ~SystemLoadSampler() = default;
+
+  /* cpu usage in percent since the previous call, node wide */
+  modelbox::Status SampleCpuUsage(double &usage);
+  /* memory usage in percent, MemAvailable against MemTotal */
+  modelbox::Status SampleMemoryUsage(double &usage);
+
+ private:
+  std::mutex sample_mutex_;
+  uint64_t last_total_{0};
+  uint64_t last_idle_{0};
+  double last_usage_{0};
+};
+
+}  // namespace modelarts
+
+#endif  // MODELARTS_SYSTEM_LOAD_H_
@@ -47,6 +47,19 @@ class TaskIO {
   std::string type_;
 };
 
+/* which objects of an obs prefix are inputs, empty fields match all */
+struct ObsFilter {
+  std::vector<std::string> suffixes;
+  /* glob on the key below the prefix */
+  std::string pattern;
+  uint64_t min_size{0};
+  uint64_t max_size{0};
+
+  bool HasSizeLimit() const { return min_size > 0 || max_size > 0; }
+  bool MatchKey(const std::string &relative_key) const;
+  bool MatchSize(uint64_t size) const;
+};
+
 class ObsIO : public TaskIO {
  public:
   ObsIO() = default;
@@ -55,10 +68,21 @@ class ObsIO : public TaskIO {
   std::string ToString() const override;
   std::string GetBucket() const { return bucket_; }
   std::string GetPath() const { return path_; }
+  const ObsFilter &GetFilter() const { return filter_; }
 
- private:
+ protected:
   std::string bucket_;
   std::string path_;
+  ObsFilter filter_;
+};
+
+/* obs objects named by a manifest object, path is the manifest key */
+class ObsManifestIO : public ObsIO {
+ public:
+  ObsManifestIO() = default;
+  ~ObsManifestIO() = default;
+  modelbox::Status Parse(const std::string &data) override;
+  std::string ToString() const override;
 };
 
 class VisIO : public TaskIO {
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MODELARTS_TASK_JOURNAL_H_
+#define MODELARTS_TASK_JOURNAL_H_
+
+#include <modelbox/base/status.h>
+
+#include <map>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+namespace modelarts {
+
+struct JournalTask {
+  std::string task_id;
+  /* the create request body as accepted */
+  std::string spec;
+  int status{0};
+  bool cancelled{false};
+  /* stopped by a drain deadline, restarted on recovery */
+  bool drained{false};
+};
+
+/*
+ * Append-only log of accepted task specs and their state changes, one json
+ * record per line. Finished tasks are dropped when the log is compacted, so
+ * replaying it yields the tasks that were still alive.
+ */
+class TaskJournal {
+ public:
+  TaskJournal(const std::string &path, size_t compact_records);
+  virtual ~TaskJournal();
+
+  /* replay the journal into tasks, compact it and open it for append */
+  modelbox::Status Open(std::vector<JournalTask> &tasks);
+  void Close();
+
+  void AppendSpec(const std::string &task_id, const std::string &spec);
+  void AppendState(const std::string &task_id, int status);
+  void AppendCancel(const std::string &task_id);
+  void AppendDrain(const std::string &task_id);
+  void AppendRemove(const std::string &task_id);
+
+ private:
+  modelbox::Status Replay();
+  void Apply(const nlohmann::json &record);
+  void Append(const nlohmann::json &record);
+  modelbox::Status Compact();
+
+ private:
+  std::string path_;
+  size_t compact_records_;
+  std::mutex mutex_;
+  int fd_{-1};
+  size_t appended_{0};
+  std::map<std::string, JournalTask> live_;
+};
+
+}  // namespace modelarts
+
+#endif  // MODELARTS_TASK_JOURNAL_H_
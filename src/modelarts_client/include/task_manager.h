@@ -19,18 +19,26 @@
 
 #include <communication.h>
 #include <config.h>
+#include <executor.h>
+#include <latency_histogram.h>
 #include <securec.h>
 #include <status.h>
+#include <system_load.h>
 #include <task_io.h>
+#include <task_journal.h>
+#include <task_registry.h>
+#include <task_retention.h>
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <random>
+#include <set>
 #include <string>
-#include <thread>
 #include <tuple>
 #include <vector>
 
@@ -44,6 +52,19 @@ enum TaskStatusCode {
   TASK_STATUS_BUTT
 };
 
+/* lifecycle points of a task, each recorded once */
+enum TaskStage {
+  TASK_STAGE_ACCEPTED,
+  TASK_STAGE_ADMITTED,
+  TASK_STAGE_PIPELINE_STARTED,
+  TASK_STAGE_FIRST_FRAME,
+  TASK_STAGE_TERMINAL,
+  TASK_STAGE_BUTT
+};
+
+constexpr const char *INSTANCE_STATE_RUNNING = "RUNNING";
+constexpr const char *INSTANCE_STATE_DRAINING = "DRAINING";
+constexpr const char *INSTANCE_STATE_OVERLOADED = "OVERLOADED";
 
 enum TaskErrorCode {
   TASK_ERROR_PARAMETER_INCORRECT,
@@ -53,6 +74,7 @@ enum TaskErrorCode {
   TASK_ERROR_TASK_IS_NOT_EXIST,
   TASK_ERROR_TASK_DELETE_FAILED,
   TASK_ERROR_TASK_QUERY_FAILED,
+  TASK_ERROR_INSTANCE_DRAINING,
   TASK_ERROR_BUTT
 };
 
@@ -63,7 +85,26 @@ static std::unordered_map<TaskErrorCode, std::string> g_errode_map = {
     {TASK_ERROR_TASK_CREATE_FAILED, "The task create failed!"},
     {TASK_ERROR_TASK_IS_NOT_EXIST, "The task is not exist!"},
     {TASK_ERROR_TASK_DELETE_FAILED, "The task delete failed!"},
-    {TASK_ERROR_TASK_QUERY_FAILED, "The task query failed!"}};
+    {TASK_ERROR_TASK_QUERY_FAILED, "The task query failed!"},
+    {TASK_ERROR_INSTANCE_DRAINING, "The instance is draining!"}};
+
+/* progress of a batch task, filled by the pipeline running it */
+struct TaskProgress {
+  uint64_t objects_total{0};
+  /* processed, or skipped by the checkpoint */
+  uint64_t objects_done{0};
+  uint64_t objects_failed{0};
+  uint64_t bytes_processed{0};
+  /* object sizes are looked up, bytes_processed is left out otherwise */
+  bool bytes_known{false};
+  /* objects_total is final once the listing is done */
+  bool listing_done{false};
+  /* estimated completion in unix ms, 0 while unknown */
+  int64_t eta{0};
+};
+
+void to_json(nlohmann::json &j, const TaskProgress &progress);
+void from_json(const nlohmann::json &j, TaskProgress &progress);
 
 class TaskInfo {
  public:
@@ -74,8 +115,11 @@ class TaskInfo {
   std::string GetConfig() const { return config_; };
   std::shared_ptr<TaskIO> GetInput() const { return input_; };
   std::vector<std::shared_ptr<TaskIO>> GetOutputs() const { return outputs_; };
+  /* the request body the task was parsed from */
+  std::string GetRawData() const { return raw_data_; };
 
  private:
+  std::string raw_data_;
   std::string taskid_;
   std::string config_;
   std::shared_ptr<TaskIO> input_;
@@ -88,20 +132,46 @@ class TaskGroup : public std::enable_shared_from_this<TaskGroup> {
             const std::string &instance_id)
       : task_info_(task_info),
         instance_id_(instance_id),
-        task_status_(TASK_STATUS_PENDING){};
+        task_status_(TASK_STATUS_PENDING) {
+    MarkStage(TASK_STAGE_ACCEPTED);
+  };
   virtual ~TaskGroup() = default;
 
   std::string GetTaskId() const { return task_info_->GetTaskId(); };
   TaskStatusCode GetTaskStatus() const { return task_status_; };
   void SetTaskStatus(const TaskStatusCode &status) { task_status_ = status; };
+  /* PENDING -> RUNNING -> SUCCEEDED | FAILED, false for any other move */
+  bool Transition(TaskStatusCode status, const std::string &reason);
+  std::string GetFailureReason();
+  /* false when the stage was already recorded */
+  bool MarkStage(TaskStage stage);
+  bool GetStageLatency(TaskStage from, TaskStage to, double &latency_ms);
   std::shared_ptr<TaskInfo> GetTaskInfo() const { return task_info_; };
+  bool SetCancelled() { return !cancelled_.exchange(true); };
+  bool IsCancelled() const { return cancelled_; };
+  void SetDrained() { drained_ = true; };
+  bool IsDrained() const { return drained_; };
+  /* true for the one caller that should stop a cancelled running task */
+  bool ClaimStop();
+  /* true when the progress is due to be sent, once per interval at most */
+  bool SetProgress(const TaskProgress &progress, int interval_ms);
   std::string GetTaskDetailToString();
 
  private:
   std::shared_ptr<TaskInfo> task_info_;
   std::string instance_id_;
   std::atomic<TaskStatusCode> task_status_;
-  std::string error_code_{TASK_ERROR_BUTT};
+  std::atomic<bool> cancelled_{false};
+  std::atomic<bool> drained_{false};
+  bool stop_claimed_{false};
+  std::mutex stage_mutex_;
+  std::chrono::steady_clock::time_point stage_time_[TASK_STAGE_BUTT];
+  bool stage_set_[TASK_STAGE_BUTT] = {};
+  std::string failure_reason_;
+  TaskProgress progress_;
+  bool has_progress_{false};
+  bool progress_sent_{false};
+  std::chrono::steady_clock::time_point last_progress_sent_;
 };
 
 using CreateTaskMsgFunc =
@@ -109,10 +179,17 @@ using CreateTaskMsgFunc =
 
 using DeleteTaskMsgFunc = std::function<bool(const std::string &task_id)>;
 
+using ThroughputFunc = std::function<double()>;
+
+using MetricsFunc = std::function<nlohmann::json()>;
+
 class TaskManager : public std::enable_shared_from_this<TaskManager> {
  public:
   TaskManager(const std::shared_ptr<Communication> &communication,
-              const std::shared_ptr<Config> &config);
+              const std::shared_ptr<Config> &config,
+              const std::shared_ptr<Executor> &executor,
+              const std::shared_ptr<Executor> &task_executor,
+              const std::shared_ptr<TaskRegistry> &registry);
   virtual ~TaskManager();
   modelbox::Status Init();
   modelbox::Status Start();
@@ -132,41 +209,132 @@ class TaskManager : public std::enable_shared_from_this<TaskManager> {
                              std::shared_ptr<void> &ptr);
   void DeleteTaskPostProcess(const std::string &msg, const std::string &resp,
                              std::shared_ptr<void> &ptr);
+  void DeleteAllTaskPostProcess(const std::string &msg,
+                                const std::string &resp,
+                                std::shared_ptr<void> &ptr);
   void QueryTaskPostProcess(const std::string &msg, const std::string &resp,
                             std::shared_ptr<void> &ptr);
+  MAHttpStatusCode ReadyProcess(const std::string &msg, std::string &resp,
+                                std::shared_ptr<void> &ptr);
+  MAHttpStatusCode DrainProcess(const std::string &msg, std::string &resp,
+                                std::shared_ptr<void> &ptr);
+  /* diagnostics kept out of the heartbeat, served on request */
+  MAHttpStatusCode MetricsProcess(const std::string &msg, std::string &resp,
+                                  std::shared_ptr<void> &ptr);
 
   void SendInstanceInfoToMA();
   void SendTaskInfoToMA(std::shared_ptr<TaskGroup> task_group);
   void SetCreateMsgFunc(CreateTaskMsgFunc func);
   void SetDeleteMsgFunc(DeleteTaskMsgFunc func);
+  void SetThroughputFunc(ThroughputFunc func);
+  void SetMetricsFunc(MetricsFunc func);
+  void SetDraining(bool draining);
+  bool IsDraining() const { return draining_; };
+  /* reject new tasks and stop the remaining ones after the drain timeout */
+  void StartDrain();
+  modelbox::Status WaitDrained(int timeout_ms);
+  int GetDrainTimeout() const { return drain_timeout_; };
+  /* stop tasks for a handover, keeping them in the journal */
+  void Suspend();
   modelbox::Status UpdateTaskStatus(const std::string &task_id,
-                                    const TaskStatusCode &status);
+                                    const TaskStatusCode &status,
+                                    const std::string &reason = "");
   TaskStatusCode GetTaskStatus(const std::string &task_id);
+  void RecordFirstFrame(const std::string &task_id);
+  void UpdateTaskProgress(const std::string &task_id,
+                          const TaskProgress &progress);
 
  private:
+  struct DeleteAllBatch {
+    std::vector<std::shared_ptr<TaskGroup>> tasks;
+    std::set<std::string> remaining;
+    std::atomic<size_t> next{0};
+    TimerId deadline_timer{INVALID_TIMER_ID};
+    std::chrono::steady_clock::time_point start_time;
+  };
+
   std::shared_ptr<TaskGroup> FindTask(const std::string &task_id);
   int GetWorkTaskCount();
   void RegisterMsgHandles();
-  std::string GetInstanceInfo();
-  void StartInstanceHeartBeatThread();
+  std::string GetInstanceInfo(std::string &state_digest);
+  std::string GetInstanceState(int running_task, double cpu_usage,
+                               double mem_usage);
+  void HeartBeat();
+  void ScheduleNextHeartBeat(const std::string &state_digest,
+                             bool send_success);
+  void LoadHeartBeatConfig();
+  int NextHeartBeatInterval(const std::string &state_digest,
+                            bool send_success);
+  int ApplyHeartBeatJitter(int interval_s);
   int GetRunningTaskCount();
+  int GetQueuedTaskCount();
   std::shared_ptr<TaskGroup> CreateTaskGroup(const std::string &msg,
                                              MAHttpStatusCode &code,
                                              std::string &resp);
+  void StartTask(const std::shared_ptr<TaskGroup> &task_group);
+  void StopTask(const std::shared_ptr<TaskGroup> &task_group);
+  /* drained tasks stay in the journal so a restart resumes them */
+  MAHttpStatusCode StopAllTasks(bool drained, std::string &resp);
+  void RunDeleteAllLane(const std::shared_ptr<DeleteAllBatch> &batch);
+  void OnTaskTerminated(const std::string &task_id);
+  void FinishDeleteAll(const std::shared_ptr<DeleteAllBatch> &batch,
+                       bool timeout);
+  void RecoverTasks();
+  void WaitStarted();
+  void JournalStatus(const std::string &task_id, TaskStatusCode status);
+  void MarkTaskStage(const std::shared_ptr<TaskGroup> &task_group,
+                     TaskStage stage);
+  nlohmann::json GetStageLatencyMetrics();
 
  private:
   std::string instance_id_;
   int max_task_num_{0};
-  std::mutex task_group_map_mutex_;
-  std::unordered_map<std::string, std::shared_ptr<TaskGroup>> task_group_map_;
+  int overload_cpu_percent_{90};
+  int overload_mem_percent_{90};
+  int delete_all_parallel_{8};
+  int delete_all_timeout_{60};
+  int drain_timeout_{60};
+  std::mutex drain_mutex_;
+  TimerId drain_timer_{INVALID_TIMER_ID};
+  /* notified when a task leaves the registry */
+  std::mutex terminated_mutex_;
+  std::condition_variable terminated_cond_;
+  std::atomic<bool> draining_{false};
+  SystemLoadSampler load_sampler_;
+  ThroughputFunc throughput_func_;
+  MetricsFunc metrics_func_;
+  std::map<std::string, std::shared_ptr<LatencyHistogram>> stage_latency_;
+  std::shared_ptr<TaskRegistry> registry_;
+  std::shared_ptr<TaskJournal> journal_;
+  std::shared_ptr<TaskRetention> retention_;
+  std::mutex recovery_mutex_;
+  std::mutex started_mutex_;
+  std::condition_variable started_cond_;
+  bool started_{false};
+  int start_wait_ms_{30000};
+  int progress_interval_ms_{5000};
+  std::atomic<bool> suspended_{false};
+  nlohmann::json recovery_report_;
   std::shared_ptr<Communication> communication_;
   std::shared_ptr<Config> config_;
-  std::shared_ptr<std::thread> heatbeat_thread_;
-  std::condition_variable upload_cond_;
+  std::shared_ptr<Executor> executor_;
+  std::shared_ptr<Executor> task_executor_;
+  std::mutex delete_all_mutex_;
+  std::shared_ptr<DeleteAllBatch> delete_all_batch_;
+  std::atomic<int> instance_update_hold_{0};
   std::mutex upload_mutex_;
-  bool stop_{false};
+  TimerId heartbeat_timer_{INVALID_TIMER_ID};
+  bool heartbeat_running_{false};
+  bool stop_{true};
   bool update_{false};
+  int heartbeat_interval_{60};
+  int heartbeat_max_interval_{180};
+  int heartbeat_retry_interval_{5};
+  int heartbeat_debounce_ms_{500};
+  int heartbeat_jitter_percent_{10};
   int wait_time_{5};
+  std::string last_instance_info_;
+  std::mt19937 jitter_engine_{std::random_device{}()};
   CreateTaskMsgFunc create_func;
   DeleteTaskMsgFunc delete_func;
 };
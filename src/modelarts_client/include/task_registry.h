@@ -0,0 +1,92 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MODELARTS_TASK_REGISTRY_H_
+#define MODELARTS_TASK_REGISTRY_H_
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace modelarts {
+
+class TaskGroup;
+
+struct TaskRecord {
+  std::shared_ptr<TaskGroup> task_group;
+  /* owner data attached by the task creator, e.g. the plugin task */
+  std::shared_ptr<void> context;
+  /* modelbox sessions running for the task, several in obs batch mode */
+  std::set<std::string> modelbox_task_ids;
+};
+
+/*
+ * Tasks indexed by modelarts task id, with a secondary index on the ids of
+ * the modelbox tasks currently running for it. Both indexes are sharded.
+ */
+class TaskRegistry {
+ public:
+  explicit TaskRegistry(size_t shard_num = 16);
+  virtual ~TaskRegistry() = default;
+
+  bool Insert(const std::string &task_id,
+              const std::shared_ptr<TaskGroup> &task_group);
+  bool Erase(const std::string &task_id);
+
+  std::shared_ptr<TaskGroup> Find(const std::string &task_id);
+  bool Get(const std::string &task_id, TaskRecord &record);
+  bool GetByModelboxTaskId(const std::string &modelbox_task_id,
+                           TaskRecord &record);
+
+  bool SetContext(const std::string &task_id,
+                  const std::shared_ptr<void> &context);
+  bool AddModelboxTask(const std::string &task_id,
+                       const std::string &modelbox_task_id);
+  bool RemoveModelboxTask(const std::string &task_id,
+                          const std::string &modelbox_task_id);
+
+  void ForEach(const std::function<void(const TaskRecord &)> &func);
+  std::vector<std::string> ListTaskIds();
+  size_t Size();
+
+ private:
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<TaskRecord>> records;
+  };
+
+  struct IndexShard {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::string> task_ids;
+  };
+
+  Shard &GetShard(const std::string &task_id);
+  IndexShard &GetIndexShard(const std::string &modelbox_task_id);
+  void RemoveIndex(const std::string &modelbox_task_id,
+                   const std::string &task_id);
+
+ private:
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::vector<std::unique_ptr<IndexShard>> index_shards_;
+};
+
+}  // namespace modelarts
+
+#endif  // MODELARTS_TASK_REGISTRY_H_
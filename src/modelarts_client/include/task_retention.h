@@ -0,0 +1,63 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MODELARTS_TASK_RETENTION_H_
+#define MODELARTS_TASK_RETENTION_H_
+
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace modelarts {
+
+/*
+ * Final details of finished tasks, kept apart from the live task registry
+ * so queries shortly after completion still succeed. Bounded by entry
+ * count, least recently used first, and each entry expires after the ttl.
+ */
+class TaskRetention {
+ public:
+  TaskRetention(size_t capacity, int ttl_ms);
+  virtual ~TaskRetention() = default;
+
+  void Put(const std::string &task_id, const std::string &detail);
+  bool Get(const std::string &task_id, std::string &detail);
+  void Remove(const std::string &task_id);
+  size_t Size();
+
+ private:
+  struct Entry {
+    std::string task_id;
+    std::string detail;
+    std::chrono::steady_clock::time_point expire_time;
+  };
+
+  void EraseExpired(std::chrono::steady_clock::time_point now);
+
+ private:
+  size_t capacity_;
+  std::chrono::milliseconds ttl_;
+  std::mutex mutex_;
+  /* most recently used first */
+  std::list<Entry> entries_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
+
+}  // namespace modelarts
+
+#endif  // MODELARTS_TASK_RETENTION_H_
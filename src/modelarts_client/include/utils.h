@@ -30,6 +30,9 @@ std::string DataMasking(const std::string &data);
 
 bool IsExpire(const std::string &expire);
 
+/* lowercase hex sha256 of data, empty on failure */
+std::string Sha256Hex(const std::string &data);
+
 }  // namespace modelarts
 
 #endif  // MODELARTS_UTILS_H_
\ No newline at end of file
@@ -16,9 +16,16 @@
 
 #include "modelarts_client.h"
 
+#include <unistd.h>
+
+#include <algorithm>
+
 namespace modelarts {
 
-modelbox::Status ModelArtsClient::Init() {
+constexpr int DRAIN_WAIT_MARGIN_MS = 5000;
+constexpr int HANDOVER_EXIT_DELAY_MS = 100;
+
+modelbox::Status ModelArtsClient::InitCore(int pipeline_group) {
   config_ = Config::GetInstance();
   if (config_ == nullptr) {
     MBLOG_ERROR << "get modelarts config failed";
@@ -38,12 +45,61 @@ modelbox::Status ModelArtsClient::Init() {
     return modelbox::STATUS_FAULT;
   }
 
+  auto affinity = CpuAffinity::GetInstance();
+  status = affinity->Init(config_);
+  if (!status) {
+    MBLOG_ERROR << "cpu affinity init failed, error:" << status.WrapErrormsgs();
+    return modelbox::STATUS_FAULT;
+  }
+  // before the executor starts, its threads pin themselves to control cpus
+  affinity->BindPipeline(pipeline_group);
+
+  executor_ =
+      std::make_shared<Executor>(config_->GetInt(CONFIG_EXECUTOR_WORKERS, 4),
+                                 config_->GetInt(CONFIG_EXECUTOR_TICK_MS, 10));
+  status = executor_->Start();
+  if (!status) {
+    MBLOG_ERROR << "executor start failed, error:" << status.WrapErrormsgs();
+    return modelbox::STATUS_FAULT;
+  }
+
+  task_executor_ = std::make_shared<Executor>(
+      std::max(config_->GetInt(CONFIG_EXECUTOR_TASK_WORKERS, 4), 1),
+      config_->GetInt(CONFIG_EXECUTOR_TICK_MS, 10));
+  status = task_executor_->Start();
+  if (!status) {
+    MBLOG_ERROR << "task executor start failed, error:"
+                << status.WrapErrormsgs();
+    return modelbox::STATUS_FAULT;
+  }
+
+  task_registry_ = std::make_shared<TaskRegistry>();
+  return modelbox::STATUS_SUCCESS;
+}
+
+modelbox::Status ModelArtsClient::InitWorker(size_t index) {
+  auto status = InitCore((int)index);
+  if (!status) {
+    return status;
+  }
+
+  MBLOG_INFO << "modelarts worker client init success.";
+  return modelbox::STATUS_SUCCESS;
+}
+
+modelbox::Status ModelArtsClient::Init() {
+  auto status = InitCore(-1);
+  if (!status) {
+    return status;
+  }
+
   auto alg_type = config_->GetString(CONFIG_ALG_TYPE);
   communication_ = CommunicationFactory::Create(alg_type, config_, cipher_);
   if (communication_ == nullptr) {
     MBLOG_ERROR << "communication Create failed , alg_type:" << alg_type;
     return modelbox::STATUS_FAULT;
   }
+  communication_->SetExecutor(executor_);
 
   status = communication_->Init();
   if (!status) {
@@ -52,7 +108,8 @@ modelbox::Status ModelArtsClient::Init() {
     return modelbox::STATUS_FAULT;
   }
 
-  task_manager_ = std::make_shared<TaskManager>(communication_, config_);
+  task_manager_ = std::make_shared<TaskManager>(
+      communication_, config_, executor_, task_executor_, task_registry_);
   status = task_manager_->Init();
   if (!status) {
     MBLOG_ERROR << "take manager init failed , alg_type:"
@@ -60,6 +117,11 @@ modelbox::Status ModelArtsClient::Init() {
     return modelbox::STATUS_FAULT;
   }
 
+  auto handover_socket = config_->GetString(CONFIG_HANDOVER_SOCKET, "");
+  if (!handover_socket.empty()) {
+    handover_ = std::make_shared<HandoverChannel>(handover_socket);
+  }
+
   MBLOG_INFO << "modelarts client init success.";
   return modelbox::STATUS_SUCCESS;
 }
@@ -71,6 +133,23 @@ modelbox::Status ModelArtsClient::Start() {
                 << status.WrapErrormsgs();
     return modelbox::STATUS_FAULT;
   }
+
+  // listen first, then take the tasks of a process still running
+  if (handover_ != nullptr) {
+    status = communication_->TakeOverListen();
+    if (!status) {
+      MBLOG_WARN << "take over listen failed, queued requests of a running "
+                    "process may be dropped. "
+                 << status.WrapErrormsgs();
+    }
+    auto timeout = config_->GetInt(CONFIG_HANDOVER_TIMEOUT, 30);
+    status = handover_->Request(timeout * 1000);
+    if (!status && status != modelbox::STATUS_NOTFOUND) {
+      MBLOG_WARN << "handover failed, start anyway. "
+                 << status.WrapErrormsgs();
+    }
+  }
+
   status = task_manager_->Start();
   if (!status) {
     MBLOG_ERROR << "task manager  start failed, error. "
@@ -78,13 +157,88 @@ modelbox::Status ModelArtsClient::Start() {
     return modelbox::STATUS_FAULT;
   }
 
+  if (handover_ != nullptr) {
+    status = handover_->Serve([this]() { return this->HandOver(); });
+    if (!status) {
+      MBLOG_WARN << "serve handover failed. " << status.WrapErrormsgs();
+    }
+  }
+
   MBLOG_INFO << "modelarts client start success.";
   return modelbox::STATUS_SUCCESS;
 }
 
+modelbox::Status ModelArtsClient::Drain() {
+  if (task_manager_ == nullptr) {
+    return modelbox::STATUS_SUCCESS;
+  }
+
+  // a plain stop with no task left and no drain asked for has nothing to
+  // wait for, suspended tasks of a handover are still in the registry
+  modelbox::Status status = modelbox::STATUS_SUCCESS;
+  if (task_manager_->IsDraining() || task_registry_->Size() != 0) {
+    task_manager_->StartDrain();
+
+    // the drain timer stops what is left, allow those stops to complete too
+    auto stop_timeout = config_->GetInt(CONFIG_TASK_STOP_TIMEOUT, 30);
+    auto wait_ms = (task_manager_->GetDrainTimeout() + stop_timeout) * 1000 +
+                   DRAIN_WAIT_MARGIN_MS;
+    status = task_manager_->WaitDrained(wait_ms);
+    if (!status) {
+      MBLOG_WARN << "drain tasks failed, " << status.WrapErrormsgs();
+    }
+  }
+
+  auto flush_timeout = config_->GetInt(CONFIG_DRAIN_FLUSH_TIMEOUT, 10);
+  auto flush_status = communication_->Flush(flush_timeout * 1000);
+  if (!flush_status) {
+    MBLOG_WARN << "flush notifications failed, "
+               << flush_status.WrapErrormsgs();
+  }
+
+  MBLOG_INFO << "modelarts client drain finished.";
+  return status;
+}
+
+modelbox::Status ModelArtsClient::HandOver() {
+  communication_->StopListen();
+  task_manager_->Suspend();
+
+  auto flush_timeout = config_->GetInt(CONFIG_DRAIN_FLUSH_TIMEOUT, 10);
+  auto status = communication_->Flush(flush_timeout * 1000);
+  if (!status) {
+    MBLOG_WARN << "flush notifications failed, " << status.WrapErrormsgs();
+  }
+
+  if (shutdown_func_ == nullptr) {
+    MBLOG_WARN << "no shutdown callback, handed over process keeps running";
+    return modelbox::STATUS_SUCCESS;
+  }
+
+  // once the reply is sent
+  auto shutdown_func = shutdown_func_;
+  executor_->Schedule(HANDOVER_EXIT_DELAY_MS,
+                      [shutdown_func]() { shutdown_func(); });
+  MBLOG_INFO << "modelarts client handed over, exit.";
+  return modelbox::STATUS_SUCCESS;
+}
+
 modelbox::Status ModelArtsClient::Stop() {
-  task_manager_->Stop();
-  communication_->Stop();
+  if (handover_ != nullptr) {
+    handover_->Stop();
+  }
+  if (task_manager_ != nullptr) {
+    task_manager_->Stop();
+  }
+  if (communication_ != nullptr) {
+    communication_->Stop();
+  }
+  if (task_executor_ != nullptr) {
+    task_executor_->Stop();
+  }
+  if (executor_ != nullptr) {
+    executor_->Stop();
+  }
 
   MBLOG_INFO << "modelarts client stop success.";
   return modelbox::STATUS_SUCCESS;
@@ -96,9 +250,35 @@ void ModelArtsClient::RegisterTaskMsgCallBack(
   task_manager_->SetCreateMsgFunc(create_func);
   task_manager_->SetDeleteMsgFunc(delete_func);
 }
+
+void ModelArtsClient::RegisterThroughputCallBack(
+    const ThroughputFunc &throughput_func) {
+  task_manager_->SetThroughputFunc(throughput_func);
+}
+
+void ModelArtsClient::RegisterMetricsCallBack(
+    const MetricsFunc &metrics_func) {
+  task_manager_->SetMetricsFunc(metrics_func);
+}
+
+void ModelArtsClient::RegisterShutdownCallBack(
+    const ShutdownFunc &shutdown_func) {
+  shutdown_func_ = shutdown_func;
+}
+
 modelbox::Status ModelArtsClient::UpdateTaskStatus(
-    const std::string &task_id, const TaskStatusCode &status) {
-  return task_manager_->UpdateTaskStatus(task_id, status);
+    const std::string &task_id, const TaskStatusCode &status,
+    const std::string &reason) {
+  return task_manager_->UpdateTaskStatus(task_id, status, reason);
+}
+
+void ModelArtsClient::ReportFirstFrame(const std::string &task_id) {
+  task_manager_->RecordFirstFrame(task_id);
+}
+
+void ModelArtsClient::UpdateTaskProgress(const std::string &task_id,
+                                         const TaskProgress &progress) {
+  task_manager_->UpdateTaskProgress(task_id, progress);
 }
 
 TaskStatusCode ModelArtsClient::GetTaskStatus(const std::string &task_id) {
@@ -16,6 +16,9 @@
 
 #include "task_io.h"
 
+#include <fnmatch.h>
+#include <strings.h>
+
 #include <algorithm>
 #include <nlohmann/json.hpp>
 
@@ -42,6 +45,42 @@ modelbox::Status TaskIO::Parse(const std::string &data) {
 REGISTER_TASK_IO("obs", true, ObsIO);
 REGISTER_TASK_IO("obs", false, ObsIO);
 
+bool ObsFilter::MatchKey(const std::string &relative_key) const {
+  if (!suffixes.empty()) {
+    auto matched = std::any_of(
+        suffixes.begin(), suffixes.end(), [&](const std::string &suffix) {
+          return relative_key.size() >= suffix.size() &&
+                 strcasecmp(relative_key.c_str() + relative_key.size() -
+                                suffix.size(),
+                            suffix.c_str()) == 0;
+        });
+    if (!matched) {
+      return false;
+    }
+  }
+
+  return pattern.empty() ||
+         fnmatch(pattern.c_str(), relative_key.c_str(), 0) == 0;
+}
+
+bool ObsFilter::MatchSize(uint64_t size) const {
+  return size >= min_size && (max_size == 0 || size <= max_size);
+}
+
+static void ParseObsFilter(const nlohmann::json &j, ObsFilter &filter) {
+  if (j.contains("suffix")) {
+    auto &suffix = j["suffix"];
+    if (suffix.is_array()) {
+      filter.suffixes = suffix.get<std::vector<std::string>>();
+    } else {
+      filter.suffixes.push_back(suffix.get<std::string>());
+    }
+  }
+  filter.pattern = j.value("pattern", "");
+  filter.min_size = j.value("min_size", static_cast<uint64_t>(0));
+  filter.max_size = j.value("max_size", static_cast<uint64_t>(0));
+}
+
 modelbox::Status ObsIO::Parse(const std::string &data) {
   auto status = TaskIO::Parse(data);
   if (!status) {
@@ -55,6 +94,11 @@ modelbox::Status ObsIO::Parse(const std::string &data) {
 
     point = nlohmann::json::json_pointer("/data/path");
     path_ = j[point].get<std::string>();
+
+    point = nlohmann::json::json_pointer("/data/filter");
+    if (j.contains(point)) {
+      ParseObsFilter(j[point], filter_);
+    }
   } catch (std::exception &e) {
     MBLOG_WARN << DataMasking(data);
     auto msg = std::string("parse obs failed. ") + e.what();
@@ -69,6 +113,13 @@ std::string ObsIO::ToString() const {
   try {
     nlohmann::json json_data;
     json_data["data"] = {{"bucket", bucket_}, {"path", path_}};
+    if (!filter_.suffixes.empty() || !filter_.pattern.empty() ||
+        filter_.HasSizeLimit()) {
+      json_data["data"]["filter"] = {{"suffix", filter_.suffixes},
+                                     {"pattern", filter_.pattern},
+                                     {"min_size", filter_.min_size},
+                                     {"max_size", filter_.max_size}};
+    }
     json_data["type"] = "obs";
     return json_data.dump();
   } catch (std::exception &e) {
@@ -78,6 +129,44 @@ std::string ObsIO::ToString() const {
   return "";
 }
 
+REGISTER_TASK_IO("obs_manifest", true, ObsManifestIO);
+
+modelbox::Status ObsManifestIO::Parse(const std::string &data) {
+  auto status = TaskIO::Parse(data);
+  if (!status) {
+    return {status, "parse obs manifest failed. "};
+  }
+
+  try {
+    auto j = nlohmann::json::parse(data);
+    auto point = nlohmann::json::json_pointer("/data/bucket");
+    bucket_ = j[point].get<std::string>();
+
+    point = nlohmann::json::json_pointer("/data/manifest");
+    path_ = j[point].get<std::string>();
+  } catch (std::exception &e) {
+    MBLOG_WARN << DataMasking(data);
+    auto msg = std::string("parse obs manifest failed. ") + e.what();
+    MBLOG_WARN << msg;
+    return {modelbox::STATUS_FAULT, msg};
+  }
+  MBLOG_DEBUG << "parse obs manifest  success.";
+  return modelbox::STATUS_SUCCESS;
+}
+
+std::string ObsManifestIO::ToString() const {
+  try {
+    nlohmann::json json_data;
+    json_data["data"] = {{"bucket", bucket_}, {"manifest", path_}};
+    json_data["type"] = "obs_manifest";
+    return json_data.dump();
+  } catch (std::exception &e) {
+    auto msg = std::string("obs manifest tostring failed. ") + e.what();
+    MBLOG_WARN << msg;
+  }
+  return "";
+}
+
 REGISTER_TASK_IO("vis", true, VisIO);
 
 modelbox::Status VisIO::Parse(const std::string &data) {
@@ -0,0 +1,257 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "task_journal.h"
+
+#include <fcntl.h>
+#include <log.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+namespace modelarts {
+
+constexpr const char *JOURNAL_OP = "op";
+constexpr const char *JOURNAL_OP_SPEC = "spec";
+constexpr const char *JOURNAL_OP_STATE = "state";
+constexpr const char *JOURNAL_OP_CANCEL = "cancel";
+constexpr const char *JOURNAL_OP_REMOVE = "remove";
+constexpr const char *JOURNAL_OP_DRAIN = "drain";
+constexpr const char *JOURNAL_TMP_SUFFIX = ".tmp";
+constexpr mode_t JOURNAL_FILE_MODE = 0600;
+
+static modelbox::Status WriteAll(int fd, const std::string &data) {
+  size_t offset = 0;
+  while (offset < data.size()) {
+    auto len = write(fd, data.data() + offset, data.size() - offset);
+    if (len < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return {modelbox::STATUS_FAULT, strerror(errno)};
+    }
+    offset += len;
+  }
+  return modelbox::STATUS_SUCCESS;
+}
+
+TaskJournal::TaskJournal(const std::string &path, size_t compact_records)
+    : path_(path), compact_records_(std::max<size_t>(compact_records, 1)) {}
+
+TaskJournal::~TaskJournal() { Close(); }
+
+modelbox::Status TaskJournal::Open(std::vector<JournalTask> &tasks) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto status = Replay();
+  if (!status) {
+    return status;
+  }
+
+  status = Compact();
+  if (!status) {
+    return status;
+  }
+
+  tasks.clear();
+  for (auto &item : live_) {
+    tasks.push_back(item.second);
+  }
+  MBLOG_INFO << "task journal open, path: " << path_
+             << " live tasks: " << tasks.size();
+  return modelbox::STATUS_SUCCESS;
+}
+
+void TaskJournal::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+void TaskJournal::AppendSpec(const std::string &task_id,
+                             const std::string &spec) {
+  Append({{JOURNAL_OP, JOURNAL_OP_SPEC}, {"id", task_id}, {"spec", spec}});
+}
+
+void TaskJournal::AppendState(const std::string &task_id, int status) {
+  Append(
+      {{JOURNAL_OP, JOURNAL_OP_STATE}, {"id", task_id}, {"status", status}});
+}
+
+void TaskJournal::AppendCancel(const std::string &task_id) {
+  Append({{JOURNAL_OP, JOURNAL_OP_CANCEL}, {"id", task_id}});
+}
+
+void TaskJournal::AppendDrain(const std::string &task_id) {
+  Append({{JOURNAL_OP, JOURNAL_OP_DRAIN}, {"id", task_id}});
+}
+
+void TaskJournal::AppendRemove(const std::string &task_id) {
+  Append({{JOURNAL_OP, JOURNAL_OP_REMOVE}, {"id", task_id}});
+}
+
+modelbox::Status TaskJournal::Replay() {
+  live_.clear();
+  std::ifstream file(path_);
+  if (!file.is_open()) {
+    MBLOG_INFO << "task journal not exist, start empty. path: " << path_;
+    return modelbox::STATUS_SUCCESS;
+  }
+
+  std::string line;
+  size_t line_num = 0;
+  while (std::getline(file, line)) {
+    ++line_num;
+    if (line.empty()) {
+      continue;
+    }
+
+    // a crash can leave the last record half written
+    try {
+      Apply(nlohmann::json::parse(line));
+    } catch (const std::exception &e) {
+      MBLOG_WARN << "task journal skip bad record, line: " << line_num
+                 << " error: " << e.what();
+    }
+  }
+  return modelbox::STATUS_SUCCESS;
+}
+
+void TaskJournal::Apply(const nlohmann::json &record) {
+  auto op = record.at(JOURNAL_OP).get<std::string>();
+  auto task_id = record.at("id").get<std::string>();
+  if (op == JOURNAL_OP_SPEC) {
+    auto &task = live_[task_id];
+    task.task_id = task_id;
+    task.spec = record.at("spec").get<std::string>();
+    return;
+  }
+
+  auto it = live_.find(task_id);
+  if (it == live_.end()) {
+    return;
+  }
+
+  if (op == JOURNAL_OP_STATE) {
+    it->second.status = record.at("status").get<int>();
+    it->second.drained = false;
+  } else if (op == JOURNAL_OP_CANCEL) {
+    it->second.cancelled = true;
+  } else if (op == JOURNAL_OP_DRAIN) {
+    it->second.drained = true;
+  } else if (op == JOURNAL_OP_REMOVE) {
+    live_.erase(it);
+  }
+}
+
+void TaskJournal::Append(const nlohmann::json &record) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (fd_ < 0) {
+    return;
+  }
+
+  try {
+    Apply(record);
+  } catch (const std::exception &e) {
+    MBLOG_ERROR << "task journal bad record: " << e.what();
+    return;
+  }
+
+  auto status = WriteAll(fd_, record.dump() + "\n");
+  if (!status) {
+    MBLOG_ERROR << "task journal append failed, " << status.WrapErrormsgs();
+    return;
+  }
+  fdatasync(fd_);
+
+  if (++appended_ >= compact_records_) {
+    status = Compact();
+    if (!status) {
+      MBLOG_ERROR << "task journal compact failed, " << status.WrapErrormsgs();
+    }
+  }
+}
+
+modelbox::Status TaskJournal::Compact() {
+  auto tmp_path = path_ + JOURNAL_TMP_SUFFIX;
+  int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                JOURNAL_FILE_MODE);
+  if (fd < 0) {
+    return {modelbox::STATUS_FAULT,
+            "open " + tmp_path + " failed, " + strerror(errno)};
+  }
+
+  std::string data;
+  for (auto &item : live_) {
+    auto &task = item.second;
+    data += nlohmann::json({{JOURNAL_OP, JOURNAL_OP_SPEC},
+                            {"id", task.task_id},
+                            {"spec", task.spec}})
+                .dump() +
+            "\n";
+    data += nlohmann::json({{JOURNAL_OP, JOURNAL_OP_STATE},
+                            {"id", task.task_id},
+                            {"status", task.status}})
+                .dump() +
+            "\n";
+    if (task.cancelled) {
+      data += nlohmann::json({{JOURNAL_OP, JOURNAL_OP_CANCEL},
+                              {"id", task.task_id}})
+                  .dump() +
+              "\n";
+    }
+    if (task.drained) {
+      data += nlohmann::json({{JOURNAL_OP, JOURNAL_OP_DRAIN},
+                              {"id", task.task_id}})
+                  .dump() +
+              "\n";
+    }
+  }
+
+  auto status = WriteAll(fd, data);
+  if (status && fsync(fd) != 0) {
+    status = {modelbox::STATUS_FAULT, strerror(errno)};
+  }
+  close(fd);
+  if (!status) {
+    unlink(tmp_path.c_str());
+    return {status, "write " + tmp_path + " failed"};
+  }
+
+  if (rename(tmp_path.c_str(), path_.c_str()) != 0) {
+    auto err = std::string(strerror(errno));
+    unlink(tmp_path.c_str());
+    return {modelbox::STATUS_FAULT, "rename journal failed, " + err};
+  }
+
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+  fd_ = open(path_.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+  if (fd_ < 0) {
+    return {modelbox::STATUS_FAULT,
+            "open " + path_ + " failed, " + strerror(errno)};
+  }
+  appended_ = 0;
+  return modelbox::STATUS_SUCCESS;
+}
+
+}  // namespace modelarts
@@ -16,8 +16,10 @@
 
 #include "task_manager.h"
 
+#include <algorithm>
 #include <nlohmann/json.hpp>
 
+#include "cpu_affinity.h"
 #include "utils.h"
 
 namespace modelarts {
@@ -30,19 +32,48 @@ static std::unordered_map<TaskStatusCode, std::string> g_task_status_map = {
 
 };
 
+static std::unordered_map<int, std::string> g_task_stage_map = {
+    {TASK_STAGE_ACCEPTED, "accepted"},
+    {TASK_STAGE_ADMITTED, "admitted"},
+    {TASK_STAGE_PIPELINE_STARTED, "pipeline_started"},
+    {TASK_STAGE_FIRST_FRAME, "first_frame"},
+    {TASK_STAGE_TERMINAL, "terminal"}};
+
+struct StageLatency {
+  const char *name;
+  TaskStage from;
+  TaskStage to;
+};
+
+static const std::vector<StageLatency> g_stage_latencies = {
+    {"admit", TASK_STAGE_ACCEPTED, TASK_STAGE_ADMITTED},
+    {"pipeline_start", TASK_STAGE_ADMITTED, TASK_STAGE_PIPELINE_STARTED},
+    {"create_to_running", TASK_STAGE_ACCEPTED, TASK_STAGE_PIPELINE_STARTED},
+    {"first_frame", TASK_STAGE_PIPELINE_STARTED, TASK_STAGE_FIRST_FRAME},
+    {"lifetime", TASK_STAGE_ACCEPTED, TASK_STAGE_TERMINAL}};
+
 constexpr const char *ERROR_CODE_PREFIX = "ERROR.";
 
 TaskManager::TaskManager(const std::shared_ptr<Communication> &communication,
-                         const std::shared_ptr<Config> &config)
-    : communication_(communication), config_(config) {}
-
-TaskManager::~TaskManager() {
-  std::lock_guard<std::mutex> lock(task_group_map_mutex_);
-  task_group_map_.clear();
+                         const std::shared_ptr<Config> &config,
+                         const std::shared_ptr<Executor> &executor,
+                         const std::shared_ptr<Executor> &task_executor,
+                         const std::shared_ptr<TaskRegistry> &registry)
+    : registry_(registry),
+      communication_(communication),
+      config_(config),
+      executor_(executor),
+      task_executor_(task_executor) {
+  for (const auto &latency : g_stage_latencies) {
+    stage_latency_[latency.name] = std::make_shared<LatencyHistogram>();
+  }
 }
 
+TaskManager::~TaskManager() = default;
+
 modelbox::Status TaskInfo::Parse(const std::string &data) {
   MBLOG_INFO << "TaskInfo::Parse, " << DataMasking(data);
+  raw_data_ = data;
   try {
     auto j = nlohmann::json::parse(data);
 
@@ -148,8 +179,32 @@ void TaskManager::RegisterMsgHandles() {
       },
       [this](const std::string &msg, const std::string &resp,
              std::shared_ptr<void> &ptr) {
-        return this->CreateTaskPostProcess(msg, resp, ptr);
+        return this->DeleteAllTaskPostProcess(msg, resp, ptr);
       });
+
+  communication_->RegisterMsgHandle(
+      MA_READY_TYPE,
+      [this](const std::string &msg, std::string &resp,
+             std::shared_ptr<void> &ptr) -> MAHttpStatusCode {
+        return this->ReadyProcess(msg, resp, ptr);
+      },
+      nullptr);
+
+  communication_->RegisterMsgHandle(
+      MA_DRAIN_TYPE,
+      [this](const std::string &msg, std::string &resp,
+             std::shared_ptr<void> &ptr) -> MAHttpStatusCode {
+        return this->DrainProcess(msg, resp, ptr);
+      },
+      nullptr);
+
+  communication_->RegisterMsgHandle(
+      MA_METRICS_TYPE,
+      [this](const std::string &msg, std::string &resp,
+             std::shared_ptr<void> &ptr) -> MAHttpStatusCode {
+        return this->MetricsProcess(msg, resp, ptr);
+      },
+      nullptr);
 }
 
 modelbox::Status TaskManager::Init() {
@@ -165,30 +220,167 @@ modelbox::Status TaskManager::Init() {
     MBLOG_ERROR << "TaskManager init failed, max_task_num_ is 0. ";
     return modelbox::STATUS_FAULT;
   }
+
+  delete_all_parallel_ = std::max(
+      config_->GetInt(CONFIG_TASK_DELETE_ALL_PARALLEL, delete_all_parallel_),
+      1);
+  delete_all_timeout_ = std::max(
+      config_->GetInt(CONFIG_TASK_DELETE_ALL_TIMEOUT, delete_all_timeout_), 1);
+  drain_timeout_ =
+      std::max(config_->GetInt(CONFIG_DRAIN_TIMEOUT, drain_timeout_), 0);
+
+  overload_cpu_percent_ =
+      config_->GetInt(CONFIG_OVERLOAD_CPU_PERCENT, overload_cpu_percent_);
+  overload_mem_percent_ =
+      config_->GetInt(CONFIG_OVERLOAD_MEM_PERCENT, overload_mem_percent_);
+
+  auto journal_path = config_->GetString(CONFIG_JOURNAL_PATH, "");
+  if (!journal_path.empty()) {
+    auto compact_records =
+        config_->GetInt(CONFIG_JOURNAL_COMPACT_RECORDS, 1024);
+    journal_ = std::make_shared<TaskJournal>(journal_path, compact_records);
+  }
+
+  start_wait_ms_ =
+      std::max(config_->GetInt(CONFIG_HANDOVER_TIMEOUT, 30), 1) * 1000;
+  progress_interval_ms_ =
+      std::max(config_->GetInt(CONFIG_TASK_PROGRESS_INTERVAL, 5), 1) * 1000;
+
+  auto retain_num = std::max(config_->GetInt(CONFIG_TASK_RETAIN_NUM, 1024), 0);
+  auto retain_ttl = config_->GetInt(CONFIG_TASK_RETAIN_TTL, 300);
+  retention_ = std::make_shared<TaskRetention>(retain_num, retain_ttl * 1000);
+
+  LoadHeartBeatConfig();
   return modelbox::STATUS_SUCCESS;
 }
 
+void TaskManager::LoadHeartBeatConfig() {
+  heartbeat_interval_ =
+      config_->GetInt(CONFIG_HEARTBEAT_INTERVAL, heartbeat_interval_);
+  heartbeat_max_interval_ =
+      config_->GetInt(CONFIG_HEARTBEAT_MAX_INTERVAL, heartbeat_max_interval_);
+  heartbeat_retry_interval_ = config_->GetInt(CONFIG_HEARTBEAT_RETRY_INTERVAL,
+                                              heartbeat_retry_interval_);
+  heartbeat_debounce_ms_ =
+      config_->GetInt(CONFIG_HEARTBEAT_DEBOUNCE_MS, heartbeat_debounce_ms_);
+  heartbeat_jitter_percent_ = config_->GetInt(CONFIG_HEARTBEAT_JITTER_PERCENT,
+                                              heartbeat_jitter_percent_);
+
+  heartbeat_interval_ = std::max(heartbeat_interval_, 1);
+  heartbeat_retry_interval_ = std::max(heartbeat_retry_interval_, 1);
+  heartbeat_max_interval_ =
+      std::max(heartbeat_max_interval_, heartbeat_interval_);
+  heartbeat_debounce_ms_ = std::max(heartbeat_debounce_ms_, 0);
+  heartbeat_jitter_percent_ =
+      std::min(std::max(heartbeat_jitter_percent_, 0), 50);
+  wait_time_ = heartbeat_retry_interval_;
+
+  MBLOG_INFO << "HeartBeat: interval " << heartbeat_interval_ << "s, max "
+             << heartbeat_max_interval_ << "s, retry "
+             << heartbeat_retry_interval_ << "s, debounce "
+             << heartbeat_debounce_ms_ << "ms, jitter "
+             << heartbeat_jitter_percent_ << "%";
+}
+
 modelbox::Status TaskManager::Start() {
-  StartInstanceHeartBeatThread();
+  RecoverTasks();
+
+  std::lock_guard<std::mutex> lock(upload_mutex_);
+  stop_ = false;
+  heartbeat_timer_ = executor_->Schedule(0, [this]() { this->HeartBeat(); });
+  if (heartbeat_timer_ == INVALID_TIMER_ID) {
+    MBLOG_ERROR << "HeartBeat: schedule failed, executor is not running.";
+    return modelbox::STATUS_FAULT;
+  }
+
+  {
+    std::lock_guard<std::mutex> started_lock(started_mutex_);
+    started_ = true;
+  }
+  started_cond_.notify_all();
+
+  MBLOG_INFO << " HeartBeat start success . ";
   return modelbox::STATUS_SUCCESS;
 }
 
-std::string TaskManager::GetInstanceInfo() {
+void TaskManager::WaitStarted() {
+  // requests reach a taking-over process before it has recovered its tasks
+  std::unique_lock<std::mutex> lock(started_mutex_);
+  if (!started_cond_.wait_for(lock, std::chrono::milliseconds(start_wait_ms_),
+                              [this]() { return started_; })) {
+    MBLOG_WARN << "task manager is not started, handle request anyway.";
+  }
+}
+
+std::string TaskManager::GetInstanceState(int running_task, double cpu_usage,
+                                          double mem_usage) {
+  if (draining_) {
+    return INSTANCE_STATE_DRAINING;
+  }
+
+  if (running_task >= max_task_num_ || cpu_usage >= overload_cpu_percent_ ||
+      mem_usage >= overload_mem_percent_) {
+    return INSTANCE_STATE_OVERLOADED;
+  }
+
+  return INSTANCE_STATE_RUNNING;
+}
+
+std::string TaskManager::GetInstanceInfo(std::string &state_digest) {
   try {
     std::vector<nlohmann::json> tasks;
-    {
-      std::lock_guard<std::mutex> lock(task_group_map_mutex_);
+    registry_->ForEach([&tasks](const TaskRecord &record) {
+      std::string task_detail = record.task_group->GetTaskDetailToString();
+      tasks.emplace_back(nlohmann::json::parse(task_detail));
+    });
 
-      for (auto &item : task_group_map_) {
-        std::string task_detail = item.second->GetTaskDetailToString();
-        nlohmann::json task_json = nlohmann::json::parse(task_detail);
-        tasks.emplace_back(task_json);
-      }
+    double cpu_usage = 0;
+    auto status = load_sampler_.SampleCpuUsage(cpu_usage);
+    if (!status) {
+      MBLOG_WARN << " HeartBeat: sample cpu usage failed . "
+                 << status.WrapErrormsgs();
     }
-
+    double mem_usage = 0;
+    status = load_sampler_.SampleMemoryUsage(mem_usage);
+    if (!status) {
+      MBLOG_WARN << " HeartBeat: sample memory usage failed . "
+                 << status.WrapErrormsgs();
+    }
+    double throughput = throughput_func_ ? throughput_func_() : 0;
+
+    auto running_task = GetRunningTaskCount();
+    auto queued_task = GetQueuedTaskCount();
+    auto state = GetInstanceState(running_task, cpu_usage, mem_usage);
+    nlohmann::json capacity = {
+        {"max_task_num", max_task_num_},
+        {"running_task_num", running_task},
+        {"queued_task_num", queued_task},
+        {"free_slots", std::max(max_task_num_ - running_task, 0)},
+        {"retained_task_num", retention_->Size()}};
+    nlohmann::json load = {{"cpu_usage", (int)cpu_usage},
+                           {"mem_usage", (int)mem_usage},
+                           {"throughput", throughput}};
+
+    // progress moves on every beat, it must not keep the beats fast, it is
+    // pushed with the task messages instead
+    auto task_states = nlohmann::json(tasks);
+    for (auto &task : task_states) {
+      task.erase("progress");
+    }
+    state_digest = state + task_states.dump();
     nlohmann::json j = {{"business", "instance"},
                         {"instance_id", instance_id_},
-                        {"data", {{"state", "RUNNING"}, {"tasks", tasks}}}};
+                        {"data",
+                         {{"state", state},
+                          {"tasks", tasks},
+                          {"capacity", capacity},
+                          {"load", load}}}};
+    {
+      std::lock_guard<std::mutex> lock(recovery_mutex_);
+      if (!recovery_report_.is_null()) {
+        j["data"]["recovery"] = recovery_report_;
+      }
+    }
     return j.dump();
   } catch (const std::exception &e) {
     MBLOG_ERROR << " HeartBeat: get instance info failed . " << e.what();
@@ -196,48 +388,110 @@ std::string TaskManager::GetInstanceInfo() {
   }
 }
 
-void TaskManager::StartInstanceHeartBeatThread() {
-  std::unique_lock<std::mutex> lck(upload_mutex_);
-  stop_ = false;
-  heatbeat_thread_ = std::make_shared<std::thread>([&]() {
-    while (!stop_) {
-      if (communication_ != nullptr) {
-        auto msg = GetInstanceInfo();
-        auto status = communication_->SendMsg(msg);
+int TaskManager::NextHeartBeatInterval(const std::string &state_digest,
+                                       bool send_success) {
+  if (!send_success) {
+    return heartbeat_retry_interval_;
+  }
+
+  if (state_digest != last_instance_info_) {
+    last_instance_info_ = state_digest;
+    return heartbeat_interval_;
+  }
+
+  if (wait_time_ < heartbeat_interval_) {
+    return heartbeat_interval_;
+  }
+  return std::min(wait_time_ * 2, heartbeat_max_interval_);
+}
+
+int TaskManager::ApplyHeartBeatJitter(int interval_s) {
+  auto interval_ms = interval_s * 1000;
+  auto range = interval_ms * heartbeat_jitter_percent_ / 100;
+  if (range == 0) {
+    return interval_ms;
+  }
+
+  std::uniform_int_distribution<int> dist(-range, range);
+  return interval_ms + dist(jitter_engine_);
+}
+
+void TaskManager::HeartBeat() {
+  {
+    std::lock_guard<std::mutex> lock(upload_mutex_);
+    if (stop_) {
+      return;
+    }
+    heartbeat_running_ = true;
+    heartbeat_timer_ = INVALID_TIMER_ID;
+    update_ = false;
+  }
+
+  if (communication_ == nullptr) {
+    MBLOG_WARN << "communication is not ready.";
+    ScheduleNextHeartBeat("", false);
+    return;
+  }
+
+  auto state_digest = std::make_shared<std::string>();
+  auto msg = GetInstanceInfo(*state_digest);
+  communication_->SendMsgAsync(
+      "instance", msg, [this, state_digest](const modelbox::Status &status) {
         if (!status) {
           MBLOG_WARN << " HeartBeat: send instance msg failed . "
                      << status.WrapErrormsgs();
         } else {
-          wait_time_ = 60;
+          std::lock_guard<std::mutex> lock(recovery_mutex_);
+          recovery_report_ = nullptr;
         }
-      } else {
-        MBLOG_WARN << "communication is not ready.";
-      }
+        this->ScheduleNextHeartBeat(*state_digest, status);
+      });
+}
 
-      std::unique_lock<std::mutex> lck(upload_mutex_);
-      upload_cond_.wait_for(lck, std::chrono::seconds(wait_time_),
-                            [&]() { return stop_ || update_; });
-      if (stop_) {
-        MBLOG_INFO << " HeartBeat: thread stop . ";
-        return;
-      }
-      update_ = false;
-    }
-  });
+void TaskManager::ScheduleNextHeartBeat(const std::string &state_digest,
+                                        bool send_success) {
+  std::lock_guard<std::mutex> lock(upload_mutex_);
+  heartbeat_running_ = false;
+  wait_time_ = NextHeartBeatInterval(state_digest, send_success);
+  if (stop_) {
+    MBLOG_INFO << " HeartBeat: stop . ";
+    return;
+  }
 
-  MBLOG_INFO << " HeartBeat thread start success . ";
-  return;
+  // an update arrived while sending, report it after the debounce window
+  auto wait_ms =
+      update_ ? heartbeat_debounce_ms_ : ApplyHeartBeatJitter(wait_time_);
+  heartbeat_timer_ =
+      executor_->Schedule(wait_ms, [this]() { this->HeartBeat(); });
 }
 
 void TaskManager::SendInstanceInfoToMA() {
-  std::unique_lock<std::mutex> lck(upload_mutex_);
+  if (instance_update_hold_ > 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(upload_mutex_);
+  if (stop_ || update_) {
+    return;
+  }
+
   update_ = true;
-  upload_cond_.notify_one();
+  if (heartbeat_running_) {
+    return;
+  }
+
+  executor_->Cancel(heartbeat_timer_);
+  heartbeat_timer_ = executor_->Schedule(heartbeat_debounce_ms_,
+                                         [this]() { this->HeartBeat(); });
   MBLOG_INFO << "notify to update instance info. ";
-  return;
 }
 
 void TaskManager::SendTaskInfoToMA(std::shared_ptr<TaskGroup> task_group) {
+  if (suspended_) {
+    // the process taking over reports these tasks
+    return;
+  }
+
   if (communication_ == nullptr) {
     MBLOG_WARN << "communication is not ready.";
     return;
@@ -248,11 +502,14 @@ void TaskManager::SendTaskInfoToMA(std::shared_ptr<TaskGroup> task_group) {
     nlohmann::json j = {{"business", "task"},
                         {"instance_id", instance_id_},
                         {"data", nlohmann::json::parse(task_detail)}};
-    auto status = communication_->SendMsg(j.dump());
-    if (!status) {
-      MBLOG_ERROR << "send task in to MA  failed. error: "
-                  << status.WrapErrormsgs();
-    }
+    communication_->SendMsgAsync(
+        "task/" + task_group->GetTaskId(), j.dump(),
+        [](const modelbox::Status &status) {
+          if (!status) {
+            MBLOG_ERROR << "send task in to MA  failed. error: "
+                        << status.WrapErrormsgs();
+          }
+        });
   } catch (const std::exception &e) {
     MBLOG_ERROR << "send task in to MA  failed. error:" << e.what();
   }
@@ -261,12 +518,19 @@ void TaskManager::SendTaskInfoToMA(std::shared_ptr<TaskGroup> task_group) {
 
 modelbox::Status TaskManager::Stop() {
   {
-    std::unique_lock<std::mutex> lck(upload_mutex_);
+    std::lock_guard<std::mutex> lock(upload_mutex_);
     stop_ = true;
-    upload_cond_.notify_one();
+    executor_->Cancel(heartbeat_timer_);
+    heartbeat_timer_ = INVALID_TIMER_ID;
   }
-  if (heatbeat_thread_ != nullptr) {
-    heatbeat_thread_->join();
+  {
+    std::lock_guard<std::mutex> lock(drain_mutex_);
+    executor_->Cancel(drain_timer_);
+    drain_timer_ = INVALID_TIMER_ID;
+  }
+
+  if (journal_ != nullptr) {
+    journal_->Close();
   }
 
   MBLOG_INFO << "TaskManager stop.";
@@ -275,23 +539,27 @@ modelbox::Status TaskManager::Stop() {
 
 int TaskManager::GetRunningTaskCount() {
   int sum = 0;
-  std::lock_guard<std::mutex> lock(task_group_map_mutex_);
-  for (auto &it : task_group_map_) {
-    auto status = it.second->GetTaskStatus();
+  registry_->ForEach([&sum](const TaskRecord &record) {
+    auto status = record.task_group->GetTaskStatus();
     if (status != TASK_STATUS_SUCCEEDED && status != TASK_STATUS_FAILED) {
       sum += 1;
     }
-  }
+  });
+  return sum;
+}
+
+int TaskManager::GetQueuedTaskCount() {
+  int sum = 0;
+  registry_->ForEach([&sum](const TaskRecord &record) {
+    if (record.task_group->GetTaskStatus() == TASK_STATUS_PENDING) {
+      sum += 1;
+    }
+  });
   return sum;
 }
 
 std::shared_ptr<TaskGroup> TaskManager::FindTask(const std::string &task_id) {
-  std::lock_guard<std::mutex> lock(task_group_map_mutex_);
-  auto it = task_group_map_.find(task_id);
-  if (it == task_group_map_.end()) {
-    return nullptr;
-  }
-  return it->second;
+  return registry_->Find(task_id);
 }
 
 std::shared_ptr<TaskGroup> TaskManager::CreateTaskGroup(
@@ -323,6 +591,14 @@ std::shared_ptr<TaskGroup> TaskManager::CreateTaskGroup(
 MAHttpStatusCode TaskManager::CreateTaskProcess(const std::string &msg,
                                                 std::string &resp,
                                                 std::shared_ptr<void> &ptr) {
+  WaitStarted();
+  if (draining_) {
+    MBLOG_WARN << "instance is draining, reject new task.";
+    resp = GetHttpErrorMsg(TASK_ERROR_INSTANCE_DRAINING,
+                           STATUS_HTTP_SERVICE_UNAVAILABLE);
+    return STATUS_HTTP_SERVICE_UNAVAILABLE;
+  }
+
   MAHttpStatusCode http_code = MAHttpStatusCode::STATUS_HTTP_OK;
   auto task_group = CreateTaskGroup(msg, http_code, resp);
   if (task_group == nullptr) {
@@ -335,33 +611,67 @@ MAHttpStatusCode TaskManager::CreateTaskProcess(const std::string &msg,
                << " taskid: " << task_group->GetTaskId();
   }
 
-  auto ret = create_func(task_group->GetTaskInfo());
-  if (!ret) {
-    MBLOG_ERROR << "create task msg func return false. taskid: "
-                << task_group->GetTaskId();
-    resp = GetHttpErrorMsg(TASK_ERROR_TASK_CREATE_FAILED,
-                           STATUS_HTTP_INTERNAL_ERROR);
-    return STATUS_HTTP_INTERNAL_ERROR;
+  task_group->SetTaskStatus(TASK_STATUS_PENDING);
+  if (!registry_->Insert(task_group->GetTaskId(), task_group)) {
+    MBLOG_ERROR << "task is already exist, taskid: " << task_group->GetTaskId();
+    resp = GetHttpErrorMsg(TASK_ERROR_TASK_IS_EXIST, STATUS_HTTP_BAD_REQUEST);
+    return STATUS_HTTP_BAD_REQUEST;
   }
+  retention_->Remove(task_group->GetTaskId());
 
-  task_group->SetTaskStatus(TASK_STATUS_RUNNING);
-
-  {
-    std::lock_guard<std::mutex> lock(task_group_map_mutex_);
-    task_group_map_[task_group->GetTaskId()] = task_group;
+  if (journal_ != nullptr) {
+    journal_->AppendSpec(task_group->GetTaskId(), msg);
   }
+  task_executor_->Submit([this, task_group]() { this->StartTask(task_group); });
 
-  MBLOG_INFO << "create iva task success, taskid: " << task_group->GetTaskId();
+  MBLOG_INFO << "accept iva task success, taskid: " << task_group->GetTaskId();
   resp = "{}";
   ptr = task_group;
   return STATUS_HTTP_CREATED;
 }
 
+void TaskManager::StartTask(const std::shared_ptr<TaskGroup> &task_group) {
+  auto task_id = task_group->GetTaskId();
+  if (task_group->IsCancelled()) {
+    MBLOG_INFO << "task is deleted before start, taskid: " << task_id;
+    UpdateTaskStatus(task_id, TASK_STATUS_SUCCEEDED);
+    return;
+  }
+
+  MarkTaskStage(task_group, TASK_STAGE_ADMITTED);
+  auto ret = create_func(task_group->GetTaskInfo());
+  if (!ret) {
+    MBLOG_ERROR << "create task msg func return false. taskid: " << task_id;
+    UpdateTaskStatus(task_id, TASK_STATUS_FAILED, "create pipeline failed");
+    return;
+  }
+
+  MBLOG_INFO << "create iva task success, taskid: " << task_id;
+  UpdateTaskStatus(task_id, TASK_STATUS_RUNNING);
+
+  if (task_group->ClaimStop()) {
+    StopTask(task_group);
+  }
+}
+
+void TaskManager::StopTask(const std::shared_ptr<TaskGroup> &task_group) {
+  auto task_id = task_group->GetTaskId();
+  if (!delete_func(task_id)) {
+    MBLOG_ERROR << "delete task msg func return false. taskid: " << task_id;
+    UpdateTaskStatus(task_id, TASK_STATUS_FAILED, "stop pipeline failed");
+  }
+}
+
 MAHttpStatusCode TaskManager::QueryTaskProcess(const std::string &msg,
                                                std::string &resp,
                                                std::shared_ptr<void> &ptr) {
+  WaitStarted();
   auto task_id = msg;
   auto task_group = FindTask(task_id);
+  if (task_group == nullptr && retention_->Get(task_id, resp)) {
+    MBLOG_INFO << "query finished task, taskid: " << task_id;
+    return STATUS_HTTP_OK;
+  }
   if (task_group == nullptr) {
     MBLOG_ERROR << "query task failed, task is not exist, taskid:  " << task_id;
     resp = GetHttpErrorMsg(TASK_ERROR_TASK_IS_NOT_EXIST, STATUS_HTTP_NOT_FOUND);
@@ -383,6 +693,7 @@ MAHttpStatusCode TaskManager::QueryTaskProcess(const std::string &msg,
 MAHttpStatusCode TaskManager::DeleteTaskProcess(const std::string &task_id,
                                                 std::string &resp,
                                                 std::shared_ptr<void> &ptr) {
+  WaitStarted();
   auto task_group = FindTask(task_id);
   if (task_group == nullptr) {
     MBLOG_ERROR << "delete task failed, task is not exist, taskid:  "
@@ -391,18 +702,17 @@ MAHttpStatusCode TaskManager::DeleteTaskProcess(const std::string &task_id,
     return STATUS_HTTP_NOT_FOUND;
   }
 
-  auto task_status = task_group->GetTaskStatus();
-  if (task_status == TASK_STATUS_RUNNING) {
-    auto ret = delete_func(task_id);
-    if (!ret) {
-      MBLOG_ERROR << "delete task msg func return false. taskid: " << task_id;
-      resp = GetHttpErrorMsg(TASK_ERROR_TASK_DELETE_FAILED,
-                             STATUS_HTTP_INTERNAL_ERROR);
-      return STATUS_HTTP_INTERNAL_ERROR;
-    }
+  // whichever of this and StartTask claims the stop calls delete_func
+  auto first_delete = task_group->SetCancelled();
+  if ((first_delete || task_group->IsDrained()) && journal_ != nullptr) {
+    journal_->AppendCancel(task_id);
+  }
+  if (task_group->ClaimStop()) {
+    task_executor_->Submit(
+        [this, task_group]() { this->StopTask(task_group); });
   }
 
-  MBLOG_INFO << "delete iva task success, taskid: " << task_group->GetTaskId();
+  MBLOG_INFO << "accept delete iva task, taskid: " << task_group->GetTaskId();
   resp = "{}";
   ptr = task_group;
   return STATUS_HTTP_ACCEPTED;
@@ -411,25 +721,140 @@ MAHttpStatusCode TaskManager::DeleteTaskProcess(const std::string &task_id,
 MAHttpStatusCode TaskManager::DeleteAllTaskProcess(const std::string &msg,
                                                    std::string &resp,
                                                    std::shared_ptr<void> &ptr) {
-  std::vector<std::string> taskIds;
-  {
-    std::lock_guard<std::mutex> lock(task_group_map_mutex_);
-    for (auto &task : task_group_map_) {
-      taskIds.push_back(task.second->GetTaskId());
+  return StopAllTasks(false, resp);
+}
+
+MAHttpStatusCode TaskManager::StopAllTasks(bool drained, std::string &resp) {
+  nlohmann::json summary = nlohmann::json::array();
+  std::lock_guard<std::mutex> lock(delete_all_mutex_);
+  if (delete_all_batch_ != nullptr) {
+    MBLOG_WARN << "delete all task is already in progress.";
+    for (auto &task_id : delete_all_batch_->remaining) {
+      summary.push_back({{"id", task_id}, {"result", "STOPPING"}});
     }
+    resp = nlohmann::json({{"total", summary.size()}, {"tasks", summary}})
+               .dump();
+    return STATUS_HTTP_ACCEPTED;
   }
 
-  for (auto &taskid : taskIds) {
-    std::string tmp_resp;
-    if (DeleteAllTaskProcess(taskid, tmp_resp, ptr) != STATUS_HTTP_ACCEPTED) {
-      MBLOG_INFO << "failed to  DeleteAllTaskProcess, taskid: " << taskid
-                 << " resp" << tmp_resp;
+  auto batch = std::make_shared<DeleteAllBatch>();
+  batch->start_time = std::chrono::steady_clock::now();
+  for (auto &task_id : registry_->ListTaskIds()) {
+    auto task_group = FindTask(task_id);
+    if (task_group == nullptr) {
+      continue;
+    }
+
+    auto state = task_group->GetTaskStatus();
+    if (drained) {
+      task_group->SetDrained();
+    }
+    auto first_delete = task_group->SetCancelled();
+    if (first_delete && drained && journal_ != nullptr) {
+      journal_->AppendDrain(task_id);
+    } else if (first_delete && journal_ != nullptr) {
+      journal_->AppendCancel(task_id);
+    }
+    std::string result = "STOPPING";
+    if (state == TASK_STATUS_PENDING) {
+      result = "CANCELLED";
+    } else if (task_group->ClaimStop()) {
+      batch->tasks.push_back(task_group);
     }
+    batch->remaining.insert(task_id);
+    summary.push_back({{"id", task_id},
+                       {"state", g_task_status_map[state]},
+                       {"result", result}});
+  }
+  resp = nlohmann::json({{"total", summary.size()}, {"tasks", summary}}).dump();
+  if (batch->remaining.empty()) {
+    MBLOG_INFO << "delete all task, there is no task.";
+    return STATUS_HTTP_ACCEPTED;
+  }
+
+  instance_update_hold_++;
+  delete_all_batch_ = batch;
+  batch->deadline_timer =
+      executor_->Schedule(delete_all_timeout_ * 1000, [this, batch]() {
+        this->FinishDeleteAll(batch, true);
+      });
+  auto lanes = std::min<size_t>(delete_all_parallel_, batch->tasks.size());
+  for (size_t i = 0; i < lanes; ++i) {
+    task_executor_->Submit([this, batch]() { this->RunDeleteAllLane(batch); });
   }
 
+  MBLOG_INFO << "accept delete all task, task num: " << batch->remaining.size()
+             << " parallel: " << lanes;
   return STATUS_HTTP_ACCEPTED;
 }
 
+void TaskManager::RunDeleteAllLane(
+    const std::shared_ptr<DeleteAllBatch> &batch) {
+  while (true) {
+    auto index = batch->next++;
+    if (index >= batch->tasks.size()) {
+      return;
+    }
+    StopTask(batch->tasks[index]);
+  }
+}
+
+void TaskManager::OnTaskTerminated(const std::string &task_id) {
+  {
+    std::lock_guard<std::mutex> lock(terminated_mutex_);
+  }
+  terminated_cond_.notify_all();
+
+  std::shared_ptr<DeleteAllBatch> batch;
+  {
+    std::lock_guard<std::mutex> lock(delete_all_mutex_);
+    if (delete_all_batch_ == nullptr ||
+        delete_all_batch_->remaining.erase(task_id) == 0 ||
+        !delete_all_batch_->remaining.empty()) {
+      return;
+    }
+    batch = delete_all_batch_;
+  }
+
+  FinishDeleteAll(batch, false);
+}
+
+void TaskManager::FinishDeleteAll(const std::shared_ptr<DeleteAllBatch> &batch,
+                                  bool timeout) {
+  std::set<std::string> remaining;
+  {
+    std::lock_guard<std::mutex> lock(delete_all_mutex_);
+    if (delete_all_batch_ != batch) {
+      return;
+    }
+    delete_all_batch_ = nullptr;
+    remaining = batch->remaining;
+  }
+  executor_->Cancel(batch->deadline_timer);
+
+  auto cost = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - batch->start_time)
+                  .count();
+  if (timeout) {
+    std::string task_ids;
+    for (auto &task_id : remaining) {
+      task_ids += task_id + " ";
+    }
+    MBLOG_WARN << "delete all task timeout, cost: " << cost
+               << "ms, unfinished taskid: " << task_ids;
+    // the 202 promised these tasks end, a late stop report is rejected
+    for (auto &task_id : remaining) {
+      UpdateTaskStatus(task_id, TASK_STATUS_FAILED,
+                       "stop timeout, task not stopped by delete all");
+    }
+  } else {
+    MBLOG_INFO << "delete all task finish, cost: " << cost << "ms";
+  }
+
+  instance_update_hold_--;
+  SendInstanceInfoToMA();
+}
+
 void TaskManager::CreateTaskPostProcess(const std::string &msg,
                                         const std::string &resp,
                                         std::shared_ptr<void> &ptr) {
@@ -448,6 +873,13 @@ void TaskManager::DeleteTaskPostProcess(const std::string &msg,
   return;
 }
 
+void TaskManager::DeleteAllTaskPostProcess(const std::string &msg,
+                                           const std::string &resp,
+                                           std::shared_ptr<void> &ptr) {
+  // the instance info is sent once the whole batch has finished
+  return;
+}
+
 void TaskManager::QueryTaskPostProcess(const std::string &msg,
                                        const std::string &resp,
                                        std::shared_ptr<void> &ptr) {
@@ -466,8 +898,236 @@ void TaskManager::SetDeleteMsgFunc(DeleteTaskMsgFunc func) {
   }
 }
 
+void TaskManager::SetThroughputFunc(ThroughputFunc func) {
+  throughput_func_ = func;
+}
+
+void TaskManager::SetMetricsFunc(MetricsFunc func) { metrics_func_ = func; }
+
+void TaskManager::SetDraining(bool draining) {
+  if (draining_.exchange(draining) != draining) {
+    MBLOG_INFO << "instance draining state changed to " << draining;
+    SendInstanceInfoToMA();
+  }
+}
+
+void TaskManager::JournalStatus(const std::string &task_id,
+                                TaskStatusCode status) {
+  if (journal_ == nullptr) {
+    return;
+  }
+
+  if (status == TASK_STATUS_SUCCEEDED || status == TASK_STATUS_FAILED) {
+    journal_->AppendRemove(task_id);
+    return;
+  }
+  journal_->AppendState(task_id, status);
+}
+
+void TaskManager::RecoverTasks() {
+  if (journal_ == nullptr) {
+    return;
+  }
+
+  std::vector<JournalTask> tasks;
+  auto status = journal_->Open(tasks);
+  if (!status) {
+    MBLOG_ERROR << "open task journal failed, recovery is disabled. "
+                << status.WrapErrormsgs();
+    journal_ = nullptr;
+    return;
+  }
+
+  // tasks deleted before the restart are reported finished, not restarted
+  nlohmann::json recovered = nlohmann::json::array();
+  nlohmann::json finished = nlohmann::json::array();
+  for (auto &task : tasks) {
+    MAHttpStatusCode http_code = STATUS_HTTP_OK;
+    std::string resp;
+    auto task_group = CreateTaskGroup(task.spec, http_code, resp);
+    if (task_group == nullptr) {
+      MBLOG_WARN << "drop unrecoverable task, taskid: " << task.task_id;
+      journal_->AppendRemove(task.task_id);
+      continue;
+    }
+
+    if (task.cancelled) {
+      task_group->SetTaskStatus(TASK_STATUS_SUCCEEDED);
+      SendTaskInfoToMA(task_group);
+      journal_->AppendRemove(task.task_id);
+      finished.push_back(task.task_id);
+      continue;
+    }
+
+    if (task.drained) {
+      MBLOG_INFO << "resume task stopped by drain, taskid: " << task.task_id;
+    }
+    task_group->SetTaskStatus(TASK_STATUS_PENDING);
+    registry_->Insert(task.task_id, task_group);
+    JournalStatus(task.task_id, TASK_STATUS_PENDING);
+    task_executor_->Submit(
+        [this, task_group]() { this->StartTask(task_group); });
+    recovered.push_back(task.task_id);
+  }
+
+  MBLOG_INFO << "recover tasks from journal, recovered: " << recovered.size()
+             << " finished: " << finished.size();
+  std::lock_guard<std::mutex> lock(recovery_mutex_);
+  recovery_report_ = {{"recovered", recovered}, {"finished", finished}};
+}
+
+void TaskManager::Suspend() {
+  Stop();
+  suspended_ = true;
+  if (journal_ != nullptr) {
+    journal_->Close();
+  }
+
+  size_t count = 0;
+  for (auto &task_id : registry_->ListTaskIds()) {
+    auto task_group = FindTask(task_id);
+    if (task_group == nullptr || !task_group->SetCancelled()) {
+      continue;
+    }
+    ++count;
+    if (task_group->ClaimStop()) {
+      task_executor_->Submit(
+          [this, task_group]() { this->StopTask(task_group); });
+    }
+  }
+  MBLOG_INFO << "suspend tasks for handover: " << count;
+}
+
+void TaskManager::StartDrain() {
+  SetDraining(true);
+  std::lock_guard<std::mutex> lock(drain_mutex_);
+  if (drain_timer_ != INVALID_TIMER_ID) {
+    return;
+  }
+
+  MBLOG_INFO << "drain start, running tasks: " << registry_->Size()
+             << " timeout: " << drain_timeout_ << "s";
+  drain_timer_ = executor_->Schedule(drain_timeout_ * 1000, [this]() {
+    {
+      std::lock_guard<std::mutex> lock(drain_mutex_);
+      drain_timer_ = INVALID_TIMER_ID;
+    }
+    if (!draining_ || registry_->Size() == 0) {
+      return;
+    }
+
+    MBLOG_WARN << "drain timeout, stop remaining tasks: " << registry_->Size();
+    std::string resp;
+    StopAllTasks(true, resp);
+  });
+}
+
+modelbox::Status TaskManager::WaitDrained(int timeout_ms) {
+  std::unique_lock<std::mutex> lock(terminated_mutex_);
+  auto drained = terminated_cond_.wait_for(
+      lock, std::chrono::milliseconds(timeout_ms),
+      [this]() { return registry_->Size() == 0; });
+  if (!drained) {
+    return {modelbox::STATUS_TIMEDOUT,
+            "drain timeout, remaining tasks: " +
+                std::to_string(registry_->Size())};
+  }
+  return modelbox::STATUS_SUCCESS;
+}
+
+MAHttpStatusCode TaskManager::ReadyProcess(const std::string &msg,
+                                           std::string &resp,
+                                           std::shared_ptr<void> &ptr) {
+  bool stopped = false;
+  {
+    std::lock_guard<std::mutex> lock(upload_mutex_);
+    stopped = stop_;
+  }
+
+  std::string state = INSTANCE_STATE_RUNNING;
+  if (stopped) {
+    state = "STOPPED";
+  } else if (draining_) {
+    state = INSTANCE_STATE_DRAINING;
+  }
+
+  resp = nlohmann::json({{"state", state}}).dump();
+  if (state != INSTANCE_STATE_RUNNING) {
+    return STATUS_HTTP_SERVICE_UNAVAILABLE;
+  }
+  return STATUS_HTTP_OK;
+}
+
+static nlohmann::json ExecutorMetricsToJson(const ExecutorMetrics &metrics) {
+  return {{"workers", metrics.workers},
+          {"queue_depth", metrics.queue_depth},
+          {"pending_timers", metrics.pending_timers},
+          {"executed", metrics.executed},
+          {"stolen", metrics.stolen},
+          {"avg_latency_ms", metrics.avg_latency_ms},
+          {"max_latency_ms", metrics.max_latency_ms}};
+}
+
+MAHttpStatusCode TaskManager::MetricsProcess(const std::string &msg,
+                                             std::string &resp,
+                                             std::shared_ptr<void> &ptr) {
+  try {
+    nlohmann::json j = {
+        {"instance_id", instance_id_},
+        {"executor", ExecutorMetricsToJson(executor_->GetMetrics())},
+        {"task_executor", ExecutorMetricsToJson(task_executor_->GetMetrics())},
+        {"task_latency", GetStageLatencyMetrics()},
+        {"threads", CpuAffinity::GetInstance()->SampleThreadUsage()}};
+    if (metrics_func_) {
+      j["metrics"] = metrics_func_();
+    }
+    resp = j.dump();
+  } catch (const std::exception &e) {
+    MBLOG_ERROR << "get metrics failed, " << e.what();
+    resp = "{}";
+    return STATUS_HTTP_INTERNAL_ERROR;
+  }
+  return STATUS_HTTP_OK;
+}
+
+MAHttpStatusCode TaskManager::DrainProcess(const std::string &msg,
+                                           std::string &resp,
+                                           std::shared_ptr<void> &ptr) {
+  bool enable = true;
+  if (!msg.empty()) {
+    try {
+      auto body = nlohmann::json::parse(msg);
+      enable = body.value("enable", true);
+    } catch (const std::exception &e) {
+      MBLOG_ERROR << "parse drain request failed, " << e.what();
+      resp = GetHttpErrorMsg(TASK_ERROR_PARAMETER_INCORRECT,
+                             STATUS_HTTP_BAD_REQUEST);
+      return STATUS_HTTP_BAD_REQUEST;
+    }
+  }
+
+  if (enable) {
+    StartDrain();
+    resp = nlohmann::json({{"state", INSTANCE_STATE_DRAINING},
+                           {"tasks", registry_->Size()}})
+               .dump();
+    return STATUS_HTTP_ACCEPTED;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(drain_mutex_);
+    executor_->Cancel(drain_timer_);
+    drain_timer_ = INVALID_TIMER_ID;
+  }
+  SetDraining(false);
+  MBLOG_INFO << "drain cancelled.";
+  resp = nlohmann::json({{"state", INSTANCE_STATE_RUNNING}}).dump();
+  return STATUS_HTTP_OK;
+}
+
 modelbox::Status TaskManager::UpdateTaskStatus(const std::string &task_id,
-                                               const TaskStatusCode &status) {
+                                               const TaskStatusCode &status,
+                                               const std::string &reason) {
   auto task_group = FindTask(task_id);
   if (task_group == nullptr) {
     MBLOG_ERROR << "update task status failed, this task is not exist, taskid: "
@@ -481,16 +1141,29 @@ modelbox::Status TaskManager::UpdateTaskStatus(const std::string &task_id,
     return modelbox::STATUS_SUCCESS;
   }
 
-  task_group->SetTaskStatus(status);
+  if (!task_group->Transition(status, reason)) {
+    MBLOG_WARN << "reject task status transition "
+               << g_task_status_map[old_status] << " -> "
+               << g_task_status_map[status] << ", taskid: " << task_id;
+    return {modelbox::STATUS_INVALID, "invalid task status transition"};
+  }
+
+  if (status == TASK_STATUS_RUNNING) {
+    MarkTaskStage(task_group, TASK_STAGE_PIPELINE_STARTED);
+  } else if (status == TASK_STATUS_SUCCEEDED || status == TASK_STATUS_FAILED) {
+    MarkTaskStage(task_group, TASK_STAGE_TERMINAL);
+  }
+  if (!task_group->IsDrained()) {
+    JournalStatus(task_id, status);
+  }
 
   SendTaskInfoToMA(task_group);
 
   if (status == TASK_STATUS_SUCCEEDED || status == TASK_STATUS_FAILED) {
-    std::lock_guard<std::mutex> lock(task_group_map_mutex_);
-    if (task_group_map_.find(task_group->GetTaskId()) !=
-        task_group_map_.end()) {
-      task_group_map_.erase(task_group->GetTaskId());
-    }
+    // retain before erasing so a query never falls between the two
+    retention_->Put(task_id, task_group->GetTaskDetailToString());
+    registry_->Erase(task_group->GetTaskId());
+    OnTaskTerminated(task_group->GetTaskId());
   }
 
   SendInstanceInfoToMA();
@@ -508,6 +1181,135 @@ TaskStatusCode TaskManager::GetTaskStatus(const std::string &task_id) {
   return task_group->GetTaskStatus();
 }
 
+void TaskManager::RecordFirstFrame(const std::string &task_id) {
+  auto task_group = FindTask(task_id);
+  if (task_group == nullptr) {
+    return;
+  }
+  MarkTaskStage(task_group, TASK_STAGE_FIRST_FRAME);
+}
+
+void TaskManager::UpdateTaskProgress(const std::string &task_id,
+                                     const TaskProgress &progress) {
+  auto task_group = FindTask(task_id);
+  if (task_group == nullptr) {
+    return;
+  }
+  // a terminal message carries the last progress anyway
+  if (task_group->SetProgress(progress, progress_interval_ms_) &&
+      task_group->GetTaskStatus() == TASK_STATUS_RUNNING) {
+    SendTaskInfoToMA(task_group);
+  }
+}
+
+void TaskManager::MarkTaskStage(const std::shared_ptr<TaskGroup> &task_group,
+                                TaskStage stage) {
+  if (!task_group->MarkStage(stage)) {
+    return;
+  }
+
+  for (const auto &latency : g_stage_latencies) {
+    double latency_ms = 0;
+    if (latency.to == stage &&
+        task_group->GetStageLatency(latency.from, latency.to, latency_ms)) {
+      stage_latency_[latency.name]->Observe(latency_ms);
+    }
+  }
+}
+
+nlohmann::json TaskManager::GetStageLatencyMetrics() {
+  nlohmann::json metrics;
+  for (auto &item : stage_latency_) {
+    metrics[item.first] = item.second->ToJson();
+  }
+  return metrics;
+}
+
+static bool IsValidTransition(TaskStatusCode from, TaskStatusCode to) {
+  switch (from) {
+    case TASK_STATUS_PENDING:
+      return to == TASK_STATUS_RUNNING || to == TASK_STATUS_SUCCEEDED ||
+             to == TASK_STATUS_FAILED;
+    case TASK_STATUS_RUNNING:
+      return to == TASK_STATUS_SUCCEEDED || to == TASK_STATUS_FAILED;
+    default:
+      return false;
+  }
+}
+
+bool TaskGroup::Transition(TaskStatusCode status, const std::string &reason) {
+  std::lock_guard<std::mutex> lock(stage_mutex_);
+  if (!IsValidTransition(task_status_, status)) {
+    return false;
+  }
+
+  if (status == TASK_STATUS_FAILED) {
+    failure_reason_ = reason.empty() ? "unknown" : reason;
+  }
+  task_status_ = status;
+  return true;
+}
+
+bool TaskGroup::ClaimStop() {
+  std::lock_guard<std::mutex> lock(stage_mutex_);
+  if (!cancelled_ || stop_claimed_ || task_status_ != TASK_STATUS_RUNNING) {
+    return false;
+  }
+  stop_claimed_ = true;
+  return true;
+}
+
+std::string TaskGroup::GetFailureReason() {
+  std::lock_guard<std::mutex> lock(stage_mutex_);
+  return failure_reason_;
+}
+
+bool TaskGroup::MarkStage(TaskStage stage) {
+  std::lock_guard<std::mutex> lock(stage_mutex_);
+  if (stage_set_[stage]) {
+    return false;
+  }
+  stage_set_[stage] = true;
+  stage_time_[stage] = std::chrono::steady_clock::now();
+  return true;
+}
+
+bool TaskGroup::GetStageLatency(TaskStage from, TaskStage to,
+                                double &latency_ms) {
+  std::lock_guard<std::mutex> lock(stage_mutex_);
+  if (!stage_set_[from] || !stage_set_[to]) {
+    return false;
+  }
+  latency_ms = std::chrono::duration<double, std::milli>(stage_time_[to] -
+                                                         stage_time_[from])
+                   .count();
+  return true;
+}
+
+static int64_t ToUnixMs(std::chrono::steady_clock::time_point time) {
+  using SystemDuration = std::chrono::system_clock::duration;
+  auto elapsed = std::chrono::duration_cast<SystemDuration>(
+      std::chrono::steady_clock::now() - time);
+  auto system_time = std::chrono::system_clock::now() - elapsed;
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             system_time.time_since_epoch())
+      .count();
+}
+
+bool TaskGroup::SetProgress(const TaskProgress &progress, int interval_ms) {
+  std::lock_guard<std::mutex> lock(stage_mutex_);
+  progress_ = progress;
+  has_progress_ = true;
+  auto now = std::chrono::steady_clock::now();
+  if (progress_sent_ &&
+      now - last_progress_sent_ < std::chrono::milliseconds(interval_ms)) {
+    return false;
+  }
+  progress_sent_ = true;
+  last_progress_sent_ = now;
+  return true;
+}
+
 std::string TaskGroup::GetTaskDetailToString() {
   auto status_code = GetTaskStatus();
   if (status_code >= TASK_STATUS_BUTT) {
@@ -516,6 +1318,19 @@ std::string TaskGroup::GetTaskDetailToString() {
   try {
     nlohmann::json j = {{"id", GetTaskId()},
                         {"state", g_task_status_map[status_code]}};
+    std::lock_guard<std::mutex> lock(stage_mutex_);
+    for (int stage = 0; stage < TASK_STAGE_BUTT; ++stage) {
+      if (stage_set_[stage]) {
+        j["timestamps"][g_task_stage_map[stage]] =
+            ToUnixMs(stage_time_[stage]);
+      }
+    }
+    if (has_progress_) {
+      j["progress"] = progress_;
+    }
+    if (status_code == TASK_STATUS_FAILED) {
+      j["reason"] = failure_reason_;
+    }
     return j.dump();
   } catch (const std::exception &e) {
     MBLOG_ERROR << "get task info string failed, error: " << e.what();
@@ -523,4 +1338,27 @@ std::string TaskGroup::GetTaskDetailToString() {
   }
 }
 
+void to_json(nlohmann::json &j, const TaskProgress &progress) {
+  j = {{"objects_total", progress.objects_total},
+       {"objects_done", progress.objects_done},
+       {"objects_failed", progress.objects_failed},
+       {"listing_done", progress.listing_done}};
+  if (progress.bytes_known) {
+    j["bytes_processed"] = progress.bytes_processed;
+  }
+  if (progress.eta != 0) {
+    j["eta"] = progress.eta;
+  }
+}
+
+void from_json(const nlohmann::json &j, TaskProgress &progress) {
+  progress.objects_total = j.value("objects_total", (uint64_t)0);
+  progress.objects_done = j.value("objects_done", (uint64_t)0);
+  progress.objects_failed = j.value("objects_failed", (uint64_t)0);
+  progress.bytes_processed = j.value("bytes_processed", (uint64_t)0);
+  progress.bytes_known = j.contains("bytes_processed");
+  progress.listing_done = j.value("listing_done", false);
+  progress.eta = j.value("eta", (int64_t)0);
+}
+
 }  // namespace modelarts
@@ -0,0 +1,204 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "task_registry.h"
+
+#include <algorithm>
+
+namespace modelarts {
+
+TaskRegistry::TaskRegistry(size_t shard_num) {
+  shard_num = std::max<size_t>(shard_num, 1);
+  for (size_t i = 0; i < shard_num; ++i) {
+    shards_.emplace_back(new Shard());
+    index_shards_.emplace_back(new IndexShard());
+  }
+}
+
+TaskRegistry::Shard &TaskRegistry::GetShard(const std::string &task_id) {
+  return *shards_[std::hash<std::string>()(task_id) % shards_.size()];
+}
+
+TaskRegistry::IndexShard &TaskRegistry::GetIndexShard(
+    const std::string &modelbox_task_id) {
+  return *index_shards_[std::hash<std::string>()(modelbox_task_id) %
+                        index_shards_.size()];
+}
+
+bool TaskRegistry::Insert(const std::string &task_id,
+                          const std::shared_ptr<TaskGroup> &task_group) {
+  auto record = std::make_shared<TaskRecord>();
+  record->task_group = task_group;
+  auto &shard = GetShard(task_id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return shard.records.emplace(task_id, record).second;
+}
+
+bool TaskRegistry::Erase(const std::string &task_id) {
+  std::shared_ptr<TaskRecord> record;
+  {
+    auto &shard = GetShard(task_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.records.find(task_id);
+    if (it == shard.records.end()) {
+      return false;
+    }
+    record = it->second;
+    shard.records.erase(it);
+  }
+
+  for (auto &modelbox_task_id : record->modelbox_task_ids) {
+    RemoveIndex(modelbox_task_id, task_id);
+  }
+  return true;
+}
+
+std::shared_ptr<TaskGroup> TaskRegistry::Find(const std::string &task_id) {
+  auto &shard = GetShard(task_id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.records.find(task_id);
+  if (it == shard.records.end()) {
+    return nullptr;
+  }
+  return it->second->task_group;
+}
+
+bool TaskRegistry::Get(const std::string &task_id, TaskRecord &record) {
+  auto &shard = GetShard(task_id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.records.find(task_id);
+  if (it == shard.records.end()) {
+    return false;
+  }
+  record = *it->second;
+  return true;
+}
+
+bool TaskRegistry::GetByModelboxTaskId(const std::string &modelbox_task_id,
+                                       TaskRecord &record) {
+  std::string task_id;
+  {
+    auto &index_shard = GetIndexShard(modelbox_task_id);
+    std::lock_guard<std::mutex> lock(index_shard.mutex);
+    auto it = index_shard.task_ids.find(modelbox_task_id);
+    if (it == index_shard.task_ids.end()) {
+      return false;
+    }
+    task_id = it->second;
+  }
+
+  // the index is updated after the record, so confirm it is still bound
+  if (!Get(task_id, record)) {
+    return false;
+  }
+  return record.modelbox_task_ids.count(modelbox_task_id) > 0;
+}
+
+bool TaskRegistry::SetContext(const std::string &task_id,
+                              const std::shared_ptr<void> &context) {
+  auto &shard = GetShard(task_id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.records.find(task_id);
+  if (it == shard.records.end()) {
+    return false;
+  }
+  it->second->context = context;
+  return true;
+}
+
+bool TaskRegistry::AddModelboxTask(const std::string &task_id,
+                                   const std::string &modelbox_task_id) {
+  {
+    auto &shard = GetShard(task_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.records.find(task_id);
+    if (it == shard.records.end()) {
+      return false;
+    }
+    it->second->modelbox_task_ids.insert(modelbox_task_id);
+  }
+
+  auto &index_shard = GetIndexShard(modelbox_task_id);
+  std::lock_guard<std::mutex> lock(index_shard.mutex);
+  index_shard.task_ids[modelbox_task_id] = task_id;
+  return true;
+}
+
+bool TaskRegistry::RemoveModelboxTask(const std::string &task_id,
+                                      const std::string &modelbox_task_id) {
+  {
+    auto &shard = GetShard(task_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.records.find(task_id);
+    if (it == shard.records.end() ||
+        it->second->modelbox_task_ids.erase(modelbox_task_id) == 0) {
+      return false;
+    }
+  }
+
+  RemoveIndex(modelbox_task_id, task_id);
+  return true;
+}
+
+void TaskRegistry::RemoveIndex(const std::string &modelbox_task_id,
+                               const std::string &task_id) {
+  auto &index_shard = GetIndexShard(modelbox_task_id);
+  std::lock_guard<std::mutex> lock(index_shard.mutex);
+  auto it = index_shard.task_ids.find(modelbox_task_id);
+  if (it != index_shard.task_ids.end() && it->second == task_id) {
+    index_shard.task_ids.erase(it);
+  }
+}
+
+void TaskRegistry::ForEach(
+    const std::function<void(const TaskRecord &)> &func) {
+  for (auto &shard : shards_) {
+    std::vector<TaskRecord> records;
+    {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+      records.reserve(shard->records.size());
+      for (auto &item : shard->records) {
+        records.push_back(*item.second);
+      }
+    }
+
+    for (auto &record : records) {
+      func(record);
+    }
+  }
+}
+
+std::vector<std::string> TaskRegistry::ListTaskIds() {
+  std::vector<std::string> task_ids;
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    for (auto &item : shard->records) {
+      task_ids.push_back(item.first);
+    }
+  }
+  return task_ids;
+}
+
+size_t TaskRegistry::Size() {
+  size_t size = 0;
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    size += shard->records.size();
+  }
+  return size;
+}
+
+}  // namespace modelarts
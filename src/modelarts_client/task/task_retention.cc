@@ -0,0 +1,90 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "task_retention.h"
+
+namespace modelarts {
+
+TaskRetention::TaskRetention(size_t capacity, int ttl_ms)
+    : capacity_(capacity), ttl_(ttl_ms) {}
+
+void TaskRetention::Put(const std::string &task_id,
+                        const std::string &detail) {
+  if (capacity_ == 0 || ttl_.count() <= 0) {
+    return;
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(task_id);
+  if (it != index_.end()) {
+    entries_.erase(it->second);
+    index_.erase(it);
+  }
+
+  entries_.push_front({task_id, detail, now + ttl_});
+  index_[task_id] = entries_.begin();
+  EraseExpired(now);
+  while (entries_.size() > capacity_) {
+    index_.erase(entries_.back().task_id);
+    entries_.pop_back();
+  }
+}
+
+bool TaskRetention::Get(const std::string &task_id, std::string &detail) {
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(task_id);
+  if (it == index_.end()) {
+    return false;
+  }
+
+  if (it->second->expire_time <= now) {
+    entries_.erase(it->second);
+    index_.erase(it);
+    return false;
+  }
+
+  entries_.splice(entries_.begin(), entries_, it->second);
+  detail = it->second->detail;
+  return true;
+}
+
+void TaskRetention::Remove(const std::string &task_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(task_id);
+  if (it == index_.end()) {
+    return;
+  }
+  entries_.erase(it->second);
+  index_.erase(it);
+}
+
+size_t TaskRetention::Size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  EraseExpired(std::chrono::steady_clock::now());
+  return entries_.size();
+}
+
+void TaskRetention::EraseExpired(std::chrono::steady_clock::time_point now) {
+  // reads reorder the list, so this only trims the expired tail
+  while (!entries_.empty() && entries_.back().expire_time <= now) {
+    index_.erase(entries_.back().task_id);
+    entries_.pop_back();
+  }
+}
+
+}  // namespace modelarts
@@ -18,6 +18,9 @@
 #define MODELARTS_MANAGER_H_
 
 #include "modelarts_task.h"
+#include "task_event_queue.h"
+#include "worker_channel.h"
+#include "worker_pool.h"
 #include "modelbox/server/job_manager.h"
 #include "modelbox/server/plugin.h"
 
@@ -32,22 +35,51 @@ class ModelArtsManager {
   modelbox::Status Start();
   modelbox::Status Stop();
 
+  /* pipeline worker entry, runs in a process forked by the worker pool */
+  static int RunWorker(const std::shared_ptr<modelbox::Configuration> &config,
+                       size_t index, int fd);
+
  private:
+  modelbox::Status InitJob(
+      const std::shared_ptr<modelbox::Configuration> &config);
+  modelbox::Status StartJob();
+  void ServeWorker(const std::shared_ptr<WorkerChannel> &channel);
+  void HandleWorkerRequest(const nlohmann::json &msg);
+  void ReportTaskStatus(const std::string &task_id,
+                        modelarts::TaskStatusCode status,
+                        const std::string &reason = "");
+  void ReportFirstFrame(const std::string &task_id);
+  void ReportTaskProgress(const std::string &task_id,
+                          const modelarts::TaskProgress &progress);
   bool CreateTaskProc(const std::shared_ptr<modelarts::TaskInfo> &task);
 
   bool DeleteTaskProc(const std::string &task_id);
+  void ForceStopTask(const std::shared_ptr<MATask> &ma_task);
+  void FinishTask(const std::shared_ptr<MATask> &ma_task,
+                  modelarts::TaskStatusCode status, const std::string &reason);
   void ModelBoxTaskStatusCallBack(modelbox::OneShotTask *task,
                                   modelbox::TaskStatus status);
+  void HandleTaskStatusEvent(const std::string &modelbox_task_id,
+                             modelbox::TaskStatus status);
   std::shared_ptr<MATask> FindTaskByMaTaskId(const std::string &task_id);
   std::shared_ptr<MATask> FindTaskByModelboxTaskId(const std::string &task_id);
+  double GetSessionThroughput();
 
  private:
   std::shared_ptr<modelarts::ModelArtsClient> ma_client_;
   std::shared_ptr<modelbox::JobManager> modelbox_job_manager_;
   std::shared_ptr<modelbox::Job> modelbox_job_;
   std::shared_ptr<modelbox::TaskManager> modelbox_task_manager_;
-  std::unordered_map<std::string, std::shared_ptr<MATask>> task_list_map_;
-  std::mutex task_list_map_mutex_;
+  std::shared_ptr<TaskEventQueue> event_queue_;
+  std::shared_ptr<SessionSlots> session_slots_;
+  std::shared_ptr<WorkerPool> pool_;
+  std::shared_ptr<WorkerChannel> worker_channel_;
+  int stop_timeout_ms_{30000};
+  std::atomic<uint64_t> finished_session_count_{0};
+  uint64_t last_session_count_{0};
+  std::chrono::steady_clock::time_point last_throughput_time_{
+      std::chrono::steady_clock::now()};
+  std::mutex throughput_mutex_;
 };
 
 }  // namespace modelartsplugin
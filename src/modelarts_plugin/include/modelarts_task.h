@@ -16,19 +16,53 @@
 
 #ifndef MODELARTS_TASK_H_
 #define MODELARTS_TASK_H_
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "modelarts_client.h"
+#include "obs_checkpoint.h"
+#include "obs_object_source.h"
+#include "obs_prefetcher.h"
 #include "modelbox/base/status.h"
 #include "modelbox/server/task_manager.h"
 
 namespace modelartsplugin {
 
-class MATask {
+/* modelbox sessions in use by all tasks, bounded by the input count */
+class SessionSlots {
+ public:
+  explicit SessionSlots(int capacity) : capacity_(capacity){};
+  virtual ~SessionSlots() = default;
+
+  /* the first session of a task always runs, the task is already admitted */
+  void Acquire();
+  /* extra batch sessions only take a free slot */
+  bool TryAcquire();
+  void Release();
+
+ private:
+  int capacity_;
+  std::atomic<int> used_{0};
+};
+
+using TaskProgressCallback =
+    std::function<void(const modelarts::TaskProgress &progress)>;
+
+using TaskFinishCallback = std::function<void(
+    modelarts::TaskStatusCode status, const std::string &reason)>;
+
+class MATask : public std::enable_shared_from_this<MATask> {
  public:
   MATask(std::shared_ptr<modelarts::TaskInfo> task_info,
          std::shared_ptr<modelbox::TaskManager> modelbox_task_manager,
-         std::shared_ptr<modelarts::ModelArtsClient> ma_client);
+         std::shared_ptr<modelarts::ModelArtsClient> ma_client,
+         std::shared_ptr<SessionSlots> slots);
   virtual ~MATask();
 
  public:
@@ -37,16 +71,46 @@ class MATask {
   modelbox::Status Stop();
   modelbox::Status Delete();
 void RegisterStatusCallback(modelbox::TaskStatusCallback func);
-  bool TaskCanFinish();
-  void SetTaskFinishStatus(bool status);
+  void RegisterProgressCallback(TaskProgressCallback func);
+  /* called once when no session is left and nothing more will start */
+  void RegisterFinishCallback(TaskFinishCallback func);
+  /* release an ended session and start the next objects, a failed
+   * session only fails its own objects */
+  void OnSessionEnd(const std::string &modelbox_task_id,
+                    modelbox::TaskStatus status);
+  size_t GetSessionNum();
+  bool MarkTaskFinish();
   bool GetTaskFinishStatus() const;
-  void WaitTaskFinish();
 
  private:
   modelbox::Status PreProcess();
   modelbox::Status FillInputData();
   modelbox::Status FillSessionConfig();
-  modelbox::Status GetObsFileListByPath();
+  modelbox::Status StartObsSource(bool manifest);
+  /* the next listed objects not done yet, does blocking obs requests so
+   * it never runs under session_mutex_ */
+  void LoadObjects(std::vector<ObsObject> &objects, bool wait,
+                   size_t &skipped);
+  void RequestRefill(int delay_ms);
+  void RefillObjects();
+  void StartCheckpoint();
+  size_t SkipDoneObjects(std::vector<ObsObject> &objects);
+  /* at most once per progress interval unless forced */
+  void ReportProgress(bool force);
+  int64_t EstimateFinishTime();
+  void StartPrefetcher(const modelbox::ObsOptions &opt);
+  void PrefetchNext();
+  bool TakePrefetched(nlohmann::json &info_json);
+  void ReleaseFiles(const std::vector<std::string> &files);
+  /* move the next object to the session being started */
+  void TakeObsObject(const std::string &local_path);
+  void LookupObjectSizes(std::vector<ObsObject> &objects);
+  void SortObsFileListBySize(std::vector<ObsObject> &objects);
+  modelbox::Status StartSession();
+  void StartSessions();
+  /* true once, when the last session ended and no object is left */
+  bool MarkBatchEnd();
+  void EndBatch();
   std::string GetInputStringForActualPath();
   modelbox::Status BuildModelBoxTaskOutputInfo(std::string &output_config);
   modelbox::Status BuildModelBoxTaskInputInfo(std::string &input_config,
@@ -85,18 +149,52 @@ void RegisterStatusCallback(modelbox::TaskStatusCallback func);
 
  public:
   std::shared_ptr<modelarts::TaskInfo> task_info_;
-  std::shared_ptr<modelbox::OneShotTask> modelbox_task_;
   std::shared_ptr<modelbox::TaskManager> modelbox_task_manager_;
   std::shared_ptr<modelarts::ModelArtsClient> ma_client_;
 
  private:
   modelbox::TaskStatusCallback func_;
-  std::string input_path_running_;
-  std::vector<std::string> input_path_list_;
+  std::shared_ptr<SessionSlots> slots_;
+  int batch_concurrency_{1};
+  /* obs objects fed to one session as separate input buffers */
+  size_t batch_objects_{1};
+  std::string output_config_;
+  std::vector<std::string> outputs_;
+  std::mutex session_mutex_;
+  /* the session being started, valid under session_mutex_ */
+  std::shared_ptr<modelbox::OneShotTask> modelbox_task_;
+  std::map<std::string, std::shared_ptr<modelbox::OneShotTask>> sessions_;
+  /* obs objects of a session, released or recorded when it ends */
+  struct SessionInputs {
+    std::vector<std::string> keys;
+    std::vector<std::string> files;
+    uint64_t bytes{0};
+  };
+  /* inputs of the session being started */
+  SessionInputs inputs_running_;
+  std::map<std::string, SessionInputs> session_inputs_;
+  /* objects taken from the listing and not started yet */
+  std::vector<ObsObject> input_path_list_;
+  /* a refill is queued or running on the task executor */
+  bool refilling_{false};
+  bool start_failed_{false};
+  bool abnormal_{false};
+  bool batch_ended_{false};
+  std::shared_ptr<ObsObjectSource> obs_source_;
+  /* manifest objects start in manifest order, listed ones largest first */
+  bool manifest_input_{false};
+  std::shared_ptr<ObsPrefetcher> prefetcher_;
+  std::shared_ptr<ObsCheckpoint> checkpoint_;
+  size_t skipped_num_{0};
+  TaskProgressCallback progress_func_;
+  TaskFinishCallback finish_func_;
+  modelarts::TaskProgress progress_;
+  std::chrono::milliseconds progress_interval_{5000};
+  std::chrono::steady_clock::time_point start_time_;
+  std::chrono::steady_clock::time_point last_progress_;
 
   std::atomic<bool> is_finish_{false};
-  std::condition_variable task_finish_cv_;
-  std::mutex task_finish_lock_;
+  std::atomic<bool> stop_requested_{false};
 };
 }  // namespace modelartsplugin
 
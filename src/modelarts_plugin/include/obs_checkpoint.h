@@ -0,0 +1,68 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MODELARTS_OBS_CHECKPOINT_H_
+#define MODELARTS_OBS_CHECKPOINT_H_
+
+#include <modelbox/base/status.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace modelartsplugin {
+
+/*
+ * Keys of an obs batch task that are done, appended to a file one per
+ * line. Objects run out of listing order, so a set of keys is kept rather
+ * than a cursor. Writes are batched and flushed at most once per interval.
+ * The first line is a header naming the input and config the keys were
+ * done for, a checkpoint with another header is dropped on load.
+ */
+class ObsCheckpoint {
+ public:
+  ObsCheckpoint(const std::string &path, const std::string &header,
+                int flush_interval_ms);
+  virtual ~ObsCheckpoint();
+
+  modelbox::Status Load();
+  bool IsDone(const std::string &key);
+  void MarkDone(const std::vector<std::string> &keys);
+  void Flush();
+  /* drop the checkpoint once the whole task is done */
+  void Remove();
+  size_t GetDoneNum();
+
+ private:
+  void FlushLocked();
+
+ private:
+  std::string path_;
+  std::string header_;
+  bool header_written_{false};
+  std::chrono::milliseconds flush_interval_;
+  std::mutex mutex_;
+  std::unordered_set<std::string> done_;
+  std::vector<std::string> unflushed_;
+  std::chrono::steady_clock::time_point last_flush_;
+  bool removed_{false};
+};
+
+}  // namespace modelartsplugin
+
+#endif  // MODELARTS_OBS_CHECKPOINT_H_
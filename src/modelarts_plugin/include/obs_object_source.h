@@ -0,0 +1,136 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MODELARTS_OBS_OBJECT_SOURCE_H_
+#define MODELARTS_OBS_OBJECT_SOURCE_H_
+
+#include <modelbox/obs_client.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "task_io.h"
+
+namespace modelartsplugin {
+
+struct ObsObject {
+  std::string key;
+  /* bytes, 0 when not looked up yet */
+  uint64_t size{0};
+};
+
+/*
+ * Objects of an obs input, produced by a background thread and handed out
+ * in order. Producing pauses while buffer_num objects wait to be taken.
+ */
+class ObsObjectSource {
+ public:
+  ObsObjectSource(const modelbox::ObsOptions &opt, size_t buffer_num);
+  virtual ~ObsObjectSource();
+
+  void Start();
+  void Stop();
+
+  /* move up to max_num objects into objects, wait for more if asked */
+  void Pop(std::vector<ObsObject> &objects, size_t max_num, bool wait);
+  modelbox::Status GetStatus();
+  size_t GetListedNum();
+  /* all objects are listed, or listing stopped on error */
+  bool IsDone();
+  /* done and every listed object was popped */
+  bool IsDrained();
+
+ protected:
+  virtual modelbox::Status Produce() = 0;
+  /* queue objects, waits for room, false once stopped */
+  bool Push(std::vector<ObsObject> &objects);
+
+ protected:
+  modelbox::ObsOptions opt_;
+
+ private:
+  void ProduceLoop();
+
+ private:
+  size_t buffer_num_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<ObsObject> objects_;
+  bool done_{false};
+  bool stop_{false};
+  modelbox::Status status_{modelbox::STATUS_SUCCESS};
+  size_t listed_num_{0};
+  std::thread thread_;
+};
+
+/*
+ * Lists a prefix with one call, the obs client has no paged listing, so the
+ * keys of the whole prefix are held until produced. Keys are filtered and
+ * queued in chunks, the first objects are taken while later ones are still
+ * looked up. A size filter costs one HEAD per object, those of a chunk run
+ * on a few threads. Folder markers and objects rejected by the filter are
+ * dropped.
+ */
+class ObsObjectLister : public ObsObjectSource {
+ public:
+  ObsObjectLister(const modelbox::ObsOptions &opt, size_t buffer_num,
+                  const modelarts::ObsFilter &filter);
+  ~ObsObjectLister() override;
+
+ protected:
+  modelbox::Status Produce() override;
+
+ private:
+  modelbox::Status ListKeys(const std::string &prefix,
+                            std::vector<std::string> &keys);
+  /* false once the source is stopped */
+  bool PushKeys(std::vector<std::string>::const_iterator begin,
+                std::vector<std::string>::const_iterator end);
+  bool AcceptKey(const std::string &key);
+  void LookupSizes(std::vector<ObsObject> &objects);
+
+ private:
+  modelarts::ObsFilter filter_;
+  size_t filtered_num_{0};
+};
+
+/*
+ * Reads the objects of a manifest, one per line: a plain key, or a json
+ * object {"key": ""}. The pipeline always reads whole objects with the
+ * task config, so an item with a "range" or "config" fails the manifest
+ * rather than being processed differently than asked.
+ */
+class ObsManifestReader : public ObsObjectSource {
+ public:
+  using ObsObjectSource::ObsObjectSource;
+  ~ObsManifestReader() override;
+
+  /* key is left empty for blank and comment lines, a malformed item or
+   * one without a key fails */
+  static modelbox::Status ParseLine(const std::string &line,
+                                    ObsObject &object);
+
+ protected:
+  modelbox::Status Produce() override;
+};
+
+}  // namespace modelartsplugin
+
+#endif  // MODELARTS_OBS_OBJECT_SOURCE_H_
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MODELARTS_OBS_PREFETCHER_H_
+#define MODELARTS_OBS_PREFETCHER_H_
+
+#include <modelbox/obs_client.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace modelartsplugin {
+
+/*
+ * Downloads the next objects of an obs batch to a local scratch directory
+ * while the current ones decode. Depth grows on every object that was not
+ * ready in time and shrinks after a run of hits, disk use is capped by
+ * max_bytes. Local copies are removed when released or on stop.
+ */
+class ObsPrefetcher {
+ public:
+  ObsPrefetcher(const modelbox::ObsOptions &opt, const std::string &dir,
+                uint64_t max_bytes, size_t max_depth);
+  virtual ~ObsPrefetcher();
+
+  modelbox::Status Start();
+  void Stop();
+
+  /* upcoming keys in run order, the first depth of them are fetched */
+  void Request(const std::vector<std::string> &keys);
+  /* take the local copy of key when it is ready */
+  bool Take(const std::string &key, std::string &local_path);
+  void Release(const std::string &local_path);
+  size_t GetDepth();
+
+ private:
+  void DownloadLoop();
+  std::string LocalPath(const std::string &key);
+
+ private:
+  modelbox::ObsOptions opt_;
+  std::string dir_;
+  uint64_t max_bytes_;
+  size_t max_depth_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::string> pending_;
+  /* keys pending, downloading or ready */
+  std::unordered_set<std::string> requested_;
+  std::unordered_map<std::string, std::string> ready_;
+  std::unordered_map<std::string, uint64_t> file_bytes_;
+  uint64_t used_bytes_{0};
+  size_t depth_{1};
+  size_t hits_{0};
+  uint64_t file_index_{0};
+  bool stop_{false};
+  std::thread thread_;
+};
+
+}  // namespace modelartsplugin
+
+#endif  // MODELARTS_OBS_PREFETCHER_H_
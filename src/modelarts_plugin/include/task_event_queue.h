@@ -0,0 +1,80 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MODELARTS_TASK_EVENT_QUEUE_H_
+#define MODELARTS_TASK_EVENT_QUEUE_H_
+
+#include <executor.h>
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <unordered_map>
+
+#include "modelbox/server/task_manager.h"
+
+namespace modelartsplugin {
+
+using TaskEventHandler = std::function<void(
+    const std::string &modelbox_task_id, modelbox::TaskStatus status)>;
+
+/*
+ * Moves modelbox task status callbacks off the engine thread. A repeated
+ * status of a modelbox task is coalesced, distinct ones are all handled in
+ * order on the control plane executor, nothing is kept after a terminal one.
+ */
+class TaskEventQueue {
+ public:
+  TaskEventQueue(const std::shared_ptr<modelarts::Executor> &executor,
+                 const TaskEventHandler &handler);
+  virtual ~TaskEventQueue() = default;
+
+  void Push(const std::string &modelbox_task_id, modelbox::TaskStatus status);
+
+  /* queue depth, counters and latency since start */
+  nlohmann::json GetMetrics();
+
+ private:
+  struct TaskEvent {
+    modelbox::TaskStatus status;
+    std::chrono::steady_clock::time_point enqueue_time;
+  };
+
+  void Process();
+  static bool IsTerminal(modelbox::TaskStatus status);
+
+ private:
+  std::shared_ptr<modelarts::Executor> executor_;
+  TaskEventHandler handler_;
+  std::mutex queue_mutex_;
+  std::deque<std::string> order_;
+  std::unordered_map<std::string, std::deque<TaskEvent>> pending_;
+  bool processing_{false};
+  uint64_t pushed_{0};
+  uint64_t coalesced_{0};
+  uint64_t processed_{0};
+  uint64_t latency_count_{0};
+  double latency_sum_ms_{0};
+  double latency_max_ms_{0};
+};
+
+}  // namespace modelartsplugin
+
+#endif  // MODELARTS_TASK_EVENT_QUEUE_H_
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MODELARTS_WORKER_CHANNEL_H_
+#define MODELARTS_WORKER_CHANNEL_H_
+
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+
+#include "modelbox/base/status.h"
+
+namespace modelartsplugin {
+
+/* control plane to worker */
+constexpr const char *WORKER_MSG_CREATE = "create";
+constexpr const char *WORKER_MSG_DELETE = "delete";
+constexpr const char *WORKER_MSG_HEALTH = "health";
+/* worker to control plane */
+constexpr const char *WORKER_MSG_REPLY = "reply";
+constexpr const char *WORKER_MSG_STATUS = "status";
+constexpr const char *WORKER_MSG_FIRST_FRAME = "first_frame";
+constexpr const char *WORKER_MSG_PROGRESS = "progress";
+
+/*
+ * One json message per line over a unix stream socket shared by the
+ * control plane and a pipeline worker. Send is thread safe, Receive is
+ * meant for a single reader.
+ */
+class WorkerChannel {
+ public:
+  explicit WorkerChannel(int fd);
+  virtual ~WorkerChannel();
+
+  modelbox::Status Send(const nlohmann::json &msg);
+  /* blocks for the next message, STATUS_EOF once the peer is gone */
+  modelbox::Status Receive(nlohmann::json &msg);
+  /* wake up a blocked Receive */
+  void Shutdown();
+  int GetFd() const { return fd_; };
+
+ private:
+  int fd_;
+  std::mutex send_mutex_;
+  std::string buffer_;
+};
+
+}  // namespace modelartsplugin
+
+#endif  // MODELARTS_WORKER_CHANNEL_H_
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MODELARTS_WORKER_POOL_H_
+#define MODELARTS_WORKER_POOL_H_
+
+#include <executor.h>
+#include <sys/types.h>
+#include <task_manager.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "worker_channel.h"
+
+namespace modelartsplugin {
+
+/* runs in the forked worker with its end of the channel, returns exit code */
+using WorkerEntry = std::function<int(size_t index, int fd)>;
+
+using WorkerStatusFunc =
+    std::function<void(const std::string &task_id,
+                       modelarts::TaskStatusCode status,
+                       const std::string &reason)>;
+
+using WorkerFirstFrameFunc = std::function<void(const std::string &task_id)>;
+
+using WorkerProgressFunc =
+    std::function<void(const std::string &task_id,
+                       const modelarts::TaskProgress &progress)>;
+
+/*
+ * Local pipeline worker processes driven by the control plane. Workers are
+ * forked by a zygote process forked once at start, so the threads of the
+ * control plane never fork. Tasks are placed on the alive worker running
+ * the fewest tasks. A worker that exits or misses its health checks is
+ * restarted and its tasks are reported failed.
+ */
+class WorkerPool {
+ public:
+  WorkerPool(size_t worker_num, const WorkerEntry &entry);
+  virtual ~WorkerPool();
+
+  /* fork the zygote and the workers, call before the control plane starts
+   * its threads */
+  modelbox::Status Start();
+  void Watch(const std::shared_ptr<modelarts::Executor> &executor,
+             int health_interval_ms, const WorkerStatusFunc &status_func,
+             const WorkerFirstFrameFunc &first_frame_func,
+             const WorkerProgressFunc &progress_func);
+  void Stop();
+
+  bool CreateTask(const std::shared_ptr<modelarts::TaskInfo> &task_info);
+  bool DeleteTask(const std::string &task_id);
+
+  uint64_t GetFinishedSessions();
+  nlohmann::json GetMetrics();
+
+ private:
+  struct Worker {
+    size_t index{0};
+    pid_t pid{-1};
+    std::shared_ptr<WorkerChannel> channel;
+    bool alive{false};
+    std::set<std::string> tasks;
+    std::map<uint64_t, std::shared_ptr<std::promise<nlohmann::json>>> pending;
+    std::chrono::steady_clock::time_point last_health;
+    uint64_t finished_sessions{0};
+    uint64_t restarts{0};
+  };
+
+  modelbox::Status StartZygote();
+  [[noreturn]] void ZygoteLoop(int fd);
+  modelbox::Status ForkWorker(size_t index, int channel_fd, pid_t &pid);
+  modelbox::Status Spawn(const std::shared_ptr<Worker> &worker);
+  void ReadLoop(std::shared_ptr<Worker> worker,
+                std::shared_ptr<WorkerChannel> channel);
+  void HandleMessage(const std::shared_ptr<Worker> &worker,
+                     const nlohmann::json &msg);
+  bool Call(const std::shared_ptr<Worker> &worker, nlohmann::json msg);
+  void HealthCheck();
+  void OnWorkerLost(const std::shared_ptr<Worker> &worker,
+                    const std::shared_ptr<WorkerChannel> &channel);
+  std::shared_ptr<Worker> PickWorker();
+
+ private:
+  size_t worker_num_;
+  WorkerEntry entry_;
+  int zygote_fd_{-1};
+  pid_t zygote_pid_{-1};
+  std::shared_ptr<modelarts::Executor> executor_;
+  WorkerStatusFunc status_func_;
+  WorkerFirstFrameFunc first_frame_func_;
+  WorkerProgressFunc progress_func_;
+  int health_interval_ms_{5000};
+  modelarts::TimerId health_timer_{modelarts::INVALID_TIMER_ID};
+  bool running_{false};
+  std::mutex mutex_;
+  std::condition_variable reader_cond_;
+  size_t reader_count_{0};
+  uint64_t next_seq_{0};
+  uint64_t lost_sessions_{0};
+  std::vector<std::shared_ptr<Worker>> workers_;
+  std::map<std::string, std::shared_ptr<Worker>> task_workers_;
+};
+
+}  // namespace modelartsplugin
+
+#endif  // MODELARTS_WORKER_POOL_H_
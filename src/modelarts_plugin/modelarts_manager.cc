@@ -17,11 +17,14 @@
 #include "modelarts_manager.h"
 
 #include <modelbox/iam_auth.h>
+#include <signal.h>
+#include <unistd.h>
 
 namespace modelartsplugin {
 
 constexpr const char *GRAPH_PATH = "server.flow_path";
 constexpr const char *JOB_NAME = "modelarts";
+constexpr int DEFAULT_WORKER_HEALTH_INTERVAL = 5;
 
 std::string GetGraphContentPath(
     const std::shared_ptr<modelbox::Configuration> &config) {
@@ -50,8 +53,29 @@ std::string GetGraphContentPath(
 
 bool ModelArtsManager::CreateTaskProc(
     const std::shared_ptr<modelarts::TaskInfo> &task_info) {
-  auto ma_task =
-      std::make_shared<MATask>(task_info, modelbox_task_manager_, ma_client_);
+  auto ma_task = std::make_shared<MATask>(task_info, modelbox_task_manager_,
+                                          ma_client_, session_slots_);
+  if (!ma_client_->task_registry_->SetContext(task_info->GetTaskId(),
+                                              ma_task)) {
+    MBLOG_ERROR << "modelarts task is not registered, taskid: "
+                << task_info->GetTaskId();
+    return false;
+  }
+
+  auto task_id = task_info->GetTaskId();
+  ma_task->RegisterProgressCallback(
+      [this, task_id](const modelarts::TaskProgress &progress) {
+        this->ReportTaskProgress(task_id, progress);
+      });
+  std::weak_ptr<MATask> weak_task = ma_task;
+  ma_task->RegisterFinishCallback(
+      [this, weak_task](modelarts::TaskStatusCode status,
+                        const std::string &reason) {
+        auto task = weak_task.lock();
+        if (task != nullptr) {
+          this->FinishTask(task, status, reason);
+        }
+      });
 
   auto status = ma_task->Init();
   if (!status) {
@@ -72,12 +96,7 @@ bool ModelArtsManager::CreateTaskProc(
 
   MBLOG_INFO << " modelbox task start success. modelarts taskid: "
              << task_info->GetTaskId()
-             << "  modelbox taskid:" << ma_task->modelbox_task_->GetTaskId();
-
-  {
-    std::lock_guard<std::mutex> lock(task_list_map_mutex_);
-    task_list_map_[task_info->GetTaskId()] = ma_task;
-  }
+             << "  modelbox sessions:" << ma_task->GetSessionNum();
 
   return true;
 }
@@ -93,107 +112,267 @@ bool ModelArtsManager::DeleteTaskProc(const std::string &task_id) {
   auto status = ma_task->Stop();
   if (!status) {
     MBLOG_ERROR << "modelarts task stop failed.  modelarts taskid: " << task_id;
-    return false;
+    ForceStopTask(ma_task);
+    return true;
   }
 
-  ma_task->WaitTaskFinish();
-
-  MBLOG_ERROR << "modelarts task stop success.  modelarts taskid: " << task_id;
+  std::weak_ptr<MATask> weak_task = ma_task;
+  auto timer_id = ma_client_->executor_->Schedule(
+      stop_timeout_ms_, [this, weak_task]() {
+        auto task = weak_task.lock();
+        if (task != nullptr && !task->GetTaskFinishStatus()) {
+          this->ForceStopTask(task);
+        }
+      });
+  if (timer_id == modelarts::INVALID_TIMER_ID) {
+    MBLOG_WARN << "schedule stop deadline failed, modelarts taskid: "
+               << task_id;
+  }
 
+  MBLOG_INFO << "modelarts task stopping.  modelarts taskid: " << task_id;
   return true;
 }
 
+void ModelArtsManager::ForceStopTask(const std::shared_ptr<MATask> &ma_task) {
+  if (!ma_task->MarkTaskFinish()) {
+    return;
+  }
+
+  auto task_id = ma_task->task_info_->GetTaskId();
+  MBLOG_WARN << "modelarts task stop timeout, force delete. modelarts taskid: "
+             << task_id;
+  auto status = ma_task->Delete();
+  if (!status) {
+    MBLOG_ERROR << "force delete modelbox task failed. modelarts taskid: "
+                << task_id << " error: " << status.WrapErrormsgs();
+  }
+  ReportTaskStatus(task_id, modelarts::TASK_STATUS_FAILED,
+                   "stop timeout, pipeline force stopped");
+}
+
+void ModelArtsManager::FinishTask(const std::shared_ptr<MATask> &ma_task,
+                                  modelarts::TaskStatusCode status,
+                                  const std::string &reason) {
+  if (!ma_task->MarkTaskFinish()) {
+    return;
+  }
+
+  ReportTaskStatus(ma_task->task_info_->GetTaskId(), status, reason);
+  ma_task->Delete();
+}
+
 std::shared_ptr<MATask> ModelArtsManager::FindTaskByMaTaskId(
     const std::string &task_id) {
-  std::lock_guard<std::mutex> lock(task_list_map_mutex_);
-  auto it = task_list_map_.find(task_id);
-  if (it == task_list_map_.end()) {
+  modelarts::TaskRecord record;
+  if (!ma_client_->task_registry_->Get(task_id, record)) {
     return nullptr;
   }
-  return it->second;
+  return std::static_pointer_cast<MATask>(record.context);
 }
 
 std::shared_ptr<MATask> ModelArtsManager::FindTaskByModelboxTaskId(
     const std::string &task_id) {
-  std::lock_guard<std::mutex> lock(task_list_map_mutex_);
-
-  for (auto it = task_list_map_.begin(); it != task_list_map_.end(); it++) {
-    if (it->second->modelbox_task_ == nullptr) {
-      return nullptr;
-    }
-    if (it->second->modelbox_task_->GetTaskId() == task_id) {
-      return it->second;
-    }
+  modelarts::TaskRecord record;
+  if (!ma_client_->task_registry_->GetByModelboxTaskId(task_id, record)) {
+    return nullptr;
   }
-
-  return nullptr;
+  return std::static_pointer_cast<MATask>(record.context);
 }
 
 void ModelArtsManager::ModelBoxTaskStatusCallBack(modelbox::OneShotTask *task,
                                                   modelbox::TaskStatus status) {
-  auto ma_task = FindTaskByModelboxTaskId(task->GetTaskId());
+  event_queue_->Push(task->GetTaskId(), status);
+}
+
+void ModelArtsManager::HandleTaskStatusEvent(
+    const std::string &modelbox_task_id, modelbox::TaskStatus status) {
+  auto ma_task = FindTaskByModelboxTaskId(modelbox_task_id);
   if (ma_task == nullptr) {
-    MBLOG_INFO << "ModelBoxTaskStatusCallBack: cannot find  modelarts task , "
+    MBLOG_INFO << "HandleTaskStatusEvent: cannot find  modelarts task , "
                   "modelbox task id: "
-               << task->GetTaskId() << " status:" << status;
+               << modelbox_task_id << " status:" << status;
+    return;
   }
 
   std::string ma_taskid = ma_task->task_info_->GetTaskId();
-  MBLOG_INFO
-      << "ModelBoxTaskStatusCallBack: Receive callback, modelarts taskid: "
-      << ma_taskid << " modelbox taskid: " << task->GetTaskId()
-      << " status:" << status;
+  MBLOG_INFO << "HandleTaskStatusEvent: Receive callback, modelarts taskid: "
+             << ma_taskid << " modelbox taskid: " << modelbox_task_id
+             << " status:" << status;
+
+  if (status == modelbox::ABNORMAL || status == modelbox::STOPPED ||
+      status == modelbox::FINISHED) {
+    finished_session_count_++;
+  }
 
-  modelarts::TaskStatusCode status_code = modelarts::TASK_STATUS_RUNNING;
-  bool finish = false;
   switch (status) {
-    case modelbox::ABNORMAL:
-      finish = true;
-      status_code = modelarts::TASK_STATUS_FAILED;
+    case modelbox::WORKING:
+      ReportFirstFrame(ma_taskid);
       break;
+    case modelbox::ABNORMAL:
     case modelbox::STOPPED:
-      finish = true;
-      status_code = modelarts::TASK_STATUS_SUCCEEDED;
-      break;
     case modelbox::FINISHED:
-      if (!ma_task->TaskCanFinish()) {
-        ma_task->Delete();
-        ma_task->Run();
-        return;
-      } else {
-        finish = true;
-        status_code = modelarts::TASK_STATUS_SUCCEEDED;
-      }
+      // the task reports its status once its last session ended
+      ma_task->OnSessionEnd(modelbox_task_id, status);
       break;
     default:
       break;
   }
 
-  if (finish) {
-    ma_client_->UpdateTaskStatus(ma_task->task_info_->GetTaskId(), status_code);
-    ma_task->Delete();
-    ma_task->SetTaskFinishStatus(true);
-    {
-      std::lock_guard<std::mutex> lock(task_list_map_mutex_);
-      task_list_map_.erase(ma_task->task_info_->GetTaskId());
+  MBLOG_INFO
+      << "HandleTaskStatusEvent: Receive callback end, modelarts taskid: "
+      << ma_taskid << " modelbox taskid: " << modelbox_task_id;
+}
+
+double ModelArtsManager::GetSessionThroughput() {
+  std::lock_guard<std::mutex> lock(throughput_mutex_);
+  auto now = std::chrono::steady_clock::now();
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     now - last_throughput_time_)
+                     .count();
+  if (elapsed <= 0) {
+    return 0;
+  }
+
+  uint64_t count = pool_ != nullptr ? pool_->GetFinishedSessions()
+                                     : finished_session_count_.load();
+  double per_minute = (count - last_session_count_) * 60000.0 / elapsed;
+  last_session_count_ = count;
+  last_throughput_time_ = now;
+  return per_minute;
+}
+
+void ModelArtsManager::ReportTaskStatus(const std::string &task_id,
+                                        modelarts::TaskStatusCode status,
+                                        const std::string &reason) {
+  if (worker_channel_ == nullptr) {
+    ma_client_->UpdateTaskStatus(task_id, status, reason);
+    return;
+  }
+
+  if (status == modelarts::TASK_STATUS_SUCCEEDED ||
+      status == modelarts::TASK_STATUS_FAILED) {
+    ma_client_->task_registry_->Erase(task_id);
+  }
+  auto ret = worker_channel_->Send({{"type", WORKER_MSG_STATUS},
+                                    {"task_id", task_id},
+                                    {"status", (int)status},
+                                    {"reason", reason}});
+  if (!ret) {
+    MBLOG_ERROR << "report task status failed, taskid: " << task_id
+                << " error: " << ret.WrapErrormsgs();
+  }
+}
+
+void ModelArtsManager::ReportFirstFrame(const std::string &task_id) {
+  if (worker_channel_ == nullptr) {
+    ma_client_->ReportFirstFrame(task_id);
+    return;
+  }
+
+  worker_channel_->Send(
+      {{"type", WORKER_MSG_FIRST_FRAME}, {"task_id", task_id}});
+}
+
+void ModelArtsManager::ReportTaskProgress(
+    const std::string &task_id, const modelarts::TaskProgress &progress) {
+  if (worker_channel_ == nullptr) {
+    ma_client_->UpdateTaskProgress(task_id, progress);
+    return;
+  }
+
+  worker_channel_->Send({{"type", WORKER_MSG_PROGRESS},
+                         {"task_id", task_id},
+                         {"progress", progress}});
+}
+
+void ModelArtsManager::HandleWorkerRequest(const nlohmann::json &msg) {
+  auto type = msg.value("type", "");
+  nlohmann::json reply = {{"type", WORKER_MSG_REPLY},
+                          {"seq", msg.value("seq", (uint64_t)0)}};
+  bool ok = false;
+  if (type == WORKER_MSG_CREATE) {
+    auto task_info = std::make_shared<modelarts::TaskInfo>();
+    auto status = task_info->Parse(msg.value("spec", ""));
+    auto task_id = task_info->GetTaskId();
+    if (!status) {
+      MBLOG_ERROR << "worker parse task failed. " << status.WrapErrormsgs();
+    } else if (ma_client_->task_registry_->Insert(
+                   task_id,
+                   std::make_shared<modelarts::TaskGroup>(task_info, ""))) {
+      ok = CreateTaskProc(task_info);
+      if (!ok) {
+        ma_client_->task_registry_->Erase(task_id);
+      }
     }
+  } else if (type == WORKER_MSG_DELETE) {
+    ok = DeleteTaskProc(msg.value("task_id", ""));
+  } else if (type == WORKER_MSG_HEALTH) {
+    ok = true;
+    reply["tasks"] = ma_client_->task_registry_->Size();
+    reply["finished_sessions"] = finished_session_count_.load();
+  } else {
+    MBLOG_WARN << "unknown worker request type: " << type;
   }
 
-  MBLOG_INFO
-      << "ModelBoxTaskStatusCallBack: Receive callback end, modelarts taskid: "
-      << ma_taskid << " modelbox taskid: " << task->GetTaskId();
+  reply["ok"] = ok;
+  worker_channel_->Send(reply);
 }
 
-modelbox::Status ModelArtsManager::Init(
-    const std::shared_ptr<modelbox::Configuration> &config) {
-  ma_client_ = std::make_shared<modelarts::ModelArtsClient>();
-  auto status = ma_client_->Init();
+void ModelArtsManager::ServeWorker(
+    const std::shared_ptr<WorkerChannel> &channel) {
+  MBLOG_INFO << "pipeline worker ready, pid: " << getpid();
+  while (true) {
+    nlohmann::json msg;
+    auto status = channel->Receive(msg);
+    if (status == modelbox::STATUS_EOF) {
+      break;
+    }
+    if (!status) {
+      MBLOG_WARN << "worker receive failed. " << status.WrapErrormsgs();
+      continue;
+    }
+    // creating and stopping pipelines block, health replies must not wait
+    auto type = msg.value("type", "");
+    auto executor = type == WORKER_MSG_CREATE || type == WORKER_MSG_DELETE
+                        ? ma_client_->task_executor_
+                        : ma_client_->executor_;
+    executor->Submit([this, msg]() { this->HandleWorkerRequest(msg); });
+  }
+
+  MBLOG_INFO << "worker channel closed, pipeline worker stop.";
+  modelbox_task_manager_->Stop();
+  ma_client_->Stop();
+}
+
+int ModelArtsManager::RunWorker(
+    const std::shared_ptr<modelbox::Configuration> &config, size_t index,
+    int fd) {
+  auto manager = std::make_shared<ModelArtsManager>();
+  manager->worker_channel_ = std::make_shared<WorkerChannel>(fd);
+  manager->ma_client_ = std::make_shared<modelarts::ModelArtsClient>();
+  auto status = manager->ma_client_->InitWorker(index);
   if (!status) {
-    MBLOG_ERROR << "modelarts client init failed. error: "
+    MBLOG_ERROR << "worker client init failed. error: "
                 << status.WrapErrormsgs();
-    return modelbox::STATUS_FAULT;
+    return 1;
+  }
+
+  status = manager->InitJob(config);
+  if (!status) {
+    return 1;
   }
 
+  status = manager->StartJob();
+  if (!status) {
+    return 1;
+  }
+
+  manager->ServeWorker(manager->worker_channel_);
+  return 0;
+}
+
+modelbox::Status ModelArtsManager::InitJob(
+    const std::shared_ptr<modelbox::Configuration> &config) {
   modelbox_job_manager_ = std::make_shared<modelbox::JobManager>();
   auto graph_path = GetGraphContentPath(config);
   if (graph_path == "") {
@@ -207,7 +386,7 @@ modelbox::Status ModelArtsManager::Init(
     return modelbox::STATUS_FAULT;
   }
 
-  status = modelbox_job_->Init();
+  auto status = modelbox_job_->Init();
   if (!status) {
     MBLOG_ERROR << "job init failed. error:" << status.WrapErrormsgs();
     return modelbox::STATUS_FAULT;
@@ -220,13 +399,16 @@ modelbox::Status ModelArtsManager::Init(
     MBLOG_ERROR << "create task manager failed. graph path:" << graph_path;
     return modelbox::STATUS_FAULT;
   }
+  session_slots_ = std::make_shared<SessionSlots>(max_task_num);
 
-  ma_client_->RegisterTaskMsgCallBack(
-      [this](const std::shared_ptr<modelarts::TaskInfo> task) -> bool {
-        return this->CreateTaskProc(task);
-      },
-      [this](const std::string &task_id) -> bool {
-        return this->DeleteTaskProc(task_id);
+  stop_timeout_ms_ =
+      ma_client_->config_->GetInt(modelarts::CONFIG_TASK_STOP_TIMEOUT, 30) *
+      1000;
+
+  event_queue_ = std::make_shared<TaskEventQueue>(
+      ma_client_->executor_,
+      [this](const std::string &modelbox_task_id, modelbox::TaskStatus status) {
+        this->HandleTaskStatusEvent(modelbox_task_id, status);
       });
 
   auto cert = modelbox::IAMAuth::GetInstance();
@@ -246,7 +428,8 @@ modelbox::Status ModelArtsManager::Init(
 
   return modelbox::STATUS_SUCCESS;
 }
-modelbox::Status ModelArtsManager::Start() {
+
+modelbox::Status ModelArtsManager::StartJob() {
   auto status = modelbox_job_->Build();
   if (!status) {
     MBLOG_ERROR << "modelbox job build failed. error:"
@@ -261,8 +444,102 @@ modelbox::Status ModelArtsManager::Start() {
                 << status.WrapErrormsgs();
     return modelbox::STATUS_FAULT;
   }
+  return modelbox::STATUS_SUCCESS;
+}
 
-  status = ma_client_->Start();
+modelbox::Status ModelArtsManager::Init(
+    const std::shared_ptr<modelbox::Configuration> &config) {
+  auto ma_config = modelarts::Config::GetInstance();
+  int worker_num = 0;
+  if (ma_config != nullptr) {
+    worker_num = ma_config->GetInt(modelarts::CONFIG_WORKER_NUM, 0);
+  }
+  if (worker_num > 0) {
+    // fork before the client starts threads of its own
+    pool_ = std::make_shared<WorkerPool>(
+        worker_num, [config](size_t index, int fd) -> int {
+          MBLOG_INFO << "pipeline worker " << index << " start.";
+          return ModelArtsManager::RunWorker(config, index, fd);
+        });
+    auto status = pool_->Start();
+    if (!status) {
+      MBLOG_ERROR << "worker pool start failed. error: "
+                  << status.WrapErrormsgs();
+      return modelbox::STATUS_FAULT;
+    }
+  }
+
+  ma_client_ = std::make_shared<modelarts::ModelArtsClient>();
+  auto status = ma_client_->Init();
+  if (!status) {
+    MBLOG_ERROR << "modelarts client init failed. error: "
+                << status.WrapErrormsgs();
+    return modelbox::STATUS_FAULT;
+  }
+
+  ma_client_->RegisterThroughputCallBack(
+      [this]() -> double { return this->GetSessionThroughput(); });
+  // the modelbox server stops its plugins, and so this one, on SIGTERM
+  ma_client_->RegisterShutdownCallBack([]() { kill(getpid(), SIGTERM); });
+
+  if (pool_ != nullptr) {
+    ma_client_->RegisterTaskMsgCallBack(
+        [this](const std::shared_ptr<modelarts::TaskInfo> task) -> bool {
+          return this->pool_->CreateTask(task);
+        },
+        [this](const std::string &task_id) -> bool {
+          return this->pool_->DeleteTask(task_id);
+        });
+    ma_client_->RegisterMetricsCallBack([this]() -> nlohmann::json {
+      return {{"workers", this->pool_->GetMetrics()}};
+    });
+    auto interval = ma_client_->config_->GetInt(
+        modelarts::CONFIG_WORKER_HEALTH_INTERVAL,
+        DEFAULT_WORKER_HEALTH_INTERVAL);
+    pool_->Watch(
+        ma_client_->executor_, interval * 1000,
+        [this](const std::string &task_id, modelarts::TaskStatusCode status,
+               const std::string &reason) {
+          this->ma_client_->UpdateTaskStatus(task_id, status, reason);
+        },
+        [this](const std::string &task_id) {
+          this->ma_client_->ReportFirstFrame(task_id);
+        },
+        [this](const std::string &task_id,
+               const modelarts::TaskProgress &progress) {
+          this->ma_client_->UpdateTaskProgress(task_id, progress);
+        });
+    return modelbox::STATUS_SUCCESS;
+  }
+
+  status = InitJob(config);
+  if (!status) {
+    return status;
+  }
+
+  ma_client_->RegisterTaskMsgCallBack(
+      [this](const std::shared_ptr<modelarts::TaskInfo> task) -> bool {
+        return this->CreateTaskProc(task);
+      },
+      [this](const std::string &task_id) -> bool {
+        return this->DeleteTaskProc(task_id);
+      });
+  ma_client_->RegisterMetricsCallBack([this]() -> nlohmann::json {
+    return {{"task_event_queue", this->event_queue_->GetMetrics()}};
+  });
+
+  return modelbox::STATUS_SUCCESS;
+}
+
+modelbox::Status ModelArtsManager::Start() {
+  if (pool_ == nullptr) {
+    auto status = StartJob();
+    if (!status) {
+      return status;
+    }
+  }
+
+  auto status = ma_client_->Start();
   if (!status) {
     MBLOG_ERROR << "modelarts client start failed. " << status.WrapErrormsgs();
     return modelbox::STATUS_FAULT;
@@ -271,9 +548,20 @@ modelbox::Status ModelArtsManager::Start() {
 }
 
 modelbox::Status ModelArtsManager::Stop() {
-  ma_client_->Stop();
-  modelbox_task_manager_->Stop();
+  // plugin stop is reached on SIGTERM, let running tasks finish first
+  if (ma_client_ != nullptr) {
+    ma_client_->Drain();
+  }
+  if (pool_ != nullptr) {
+    pool_->Stop();
+  }
+  if (ma_client_ != nullptr) {
+    ma_client_->Stop();
+  }
+  if (modelbox_task_manager_ != nullptr) {
+    modelbox_task_manager_->Stop();
+  }
   return modelbox::STATUS_SUCCESS;
 }
 
-}  // namespace modelartsplugin
\ No newline at end of file
+}  // namespace modelartsplugin
@@ -20,19 +20,49 @@
 #include <modelbox/obs_client.h>
 #include <utils.h>
 
+#include <algorithm>
+#include <iterator>
+
 namespace modelartsplugin {
 
+constexpr size_t OBS_REFILL_NUM = 256;
+/* refill before the running sessions use up the loaded objects */
+constexpr size_t OBS_REFILL_LOW_NUM = 64;
+constexpr int OBS_REFILL_RETRY_MS = 200;
+
+void SessionSlots::Acquire() { used_++; }
+
+bool SessionSlots::TryAcquire() {
+  auto used = used_.load();
+  do {
+    if (capacity_ > 0 && used >= capacity_) {
+      return false;
+    }
+  } while (!used_.compare_exchange_weak(used, used + 1));
+  return true;
+}
+
+void SessionSlots::Release() { used_--; }
+
 MATask::MATask(std::shared_ptr<modelarts::TaskInfo> task_info,
                std::shared_ptr<modelbox::TaskManager> modelbox_task_manager,
-               std::shared_ptr<modelarts::ModelArtsClient> ma_client)
+               std::shared_ptr<modelarts::ModelArtsClient> ma_client,
+               std::shared_ptr<SessionSlots> slots)
     : task_info_(task_info),
       modelbox_task_manager_(modelbox_task_manager),
-      ma_client_(ma_client){};
+      ma_client_(ma_client),
+      slots_(slots){};
 
-MATask::~MATask() = default;
+MATask::~MATask() {
+  if (obs_source_ != nullptr) {
+    obs_source_->Stop();
+  }
+  if (prefetcher_ != nullptr) {
+    prefetcher_->Stop();
+  }
+}
 
-modelbox::Status MATask::GetObsFileListByPath() {
-  auto obs_client = modelbox::ObsClient::GetInstance();
+modelbox::Status MATask::StartObsSource(bool manifest) {
   modelbox::ObsOptions opt;
   auto obs =
       std::dynamic_pointer_cast<const modelarts::ObsIO>(task_info_->GetInput());
@@ -40,28 +70,351 @@ modelbox::Status MATask::GetObsFileListByPath() {
   opt.path = obs->GetPath();
   opt.end_point =
       ma_client_->config_->GetString(modelarts::CONFIG_ENDPOINT_OBS);
-  auto status = obs_client->GetObjectsList(opt, input_path_list_);
+  auto buffer_num =
+      ma_client_->config_->GetInt(modelarts::CONFIG_OBS_LIST_BUFFER, 10000);
+  manifest_input_ = manifest;
+  // sizes are only looked up to sort or filter the listing, a zero byte
+  // count would be wrong otherwise
+  progress_.bytes_known =
+      !manifest && (batch_concurrency_ > 1 || obs->GetFilter().HasSizeLimit());
+  if (manifest) {
+    obs_source_ = std::make_shared<ObsManifestReader>(opt, buffer_num);
+  } else {
+    obs_source_ =
+        std::make_shared<ObsObjectLister>(opt, buffer_num, obs->GetFilter());
+  }
+  StartCheckpoint();
+  start_time_ = std::chrono::steady_clock::now();
+  obs_source_->Start();
+  StartPrefetcher(opt);
+
+  // the task starts with the first objects, the rest are refilled later
+  size_t skipped = 0;
+  LoadObjects(input_path_list_, true, skipped);
+  skipped_num_ += skipped;
+  progress_.objects_done += skipped;
+  if (!input_path_list_.empty()) {
+    PrefetchNext();
+    return modelbox::STATUS_SUCCESS;
+  }
+
+  auto status = obs_source_->GetStatus();
   if (!status) {
     MBLOG_ERROR << " get obs objects list failed, error: " << status
                 << " config:" << obs->ToString();
     return modelbox::STATUS_FAULT;
   }
 
-  if (input_path_list_.empty()) {
-    MBLOG_ERROR << " there is no obs file, config:" << obs->ToString();
-    return modelbox::STATUS_FAULT;
+  MBLOG_ERROR << " there is no obs file, config:" << obs->ToString();
+  return modelbox::STATUS_FAULT;
+}
+
+void MATask::LoadObjects(std::vector<ObsObject> &objects, bool wait,
+                         size_t &skipped) {
+  while (true) {
+    obs_source_->Pop(objects, OBS_REFILL_NUM, wait);
+    if (objects.empty()) {
+      return;
+    }
+
+    skipped += SkipDoneObjects(objects);
+    if (!objects.empty()) {
+      break;
+    }
   }
-  return modelbox::STATUS_SUCCESS;
+
+  // the list runs from the back, a manifest keeps its own order
+  if (batch_concurrency_ > 1 && !manifest_input_) {
+    SortObsFileListBySize(objects);
+  } else {
+    std::reverse(objects.begin(), objects.end());
+  }
+}
+
+void MATask::RequestRefill(int delay_ms) {
+  if (refilling_ || obs_source_ == nullptr || obs_source_->IsDrained()) {
+    return;
+  }
+
+  refilling_ = true;
+  std::weak_ptr<MATask> weak_task = shared_from_this();
+  auto refill = [weak_task]() {
+    auto task = weak_task.lock();
+    if (task != nullptr) {
+      task->RefillObjects();
+    }
+  };
+  auto executor = ma_client_->task_executor_;
+  if (delay_ms <= 0) {
+    executor->Submit(refill);
+    return;
+  }
+  ma_client_->executor_->Schedule(
+      delay_ms, [executor, refill]() { executor->Submit(refill); });
+}
+
+void MATask::RefillObjects() {
+  std::vector<ObsObject> objects;
+  size_t skipped = 0;
+  if (!stop_requested_ && !is_finish_) {
+    LoadObjects(objects, false, skipped);
+  }
+
+  bool batch_end = false;
+  {
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    refilling_ = false;
+    if (batch_ended_ || is_finish_) {
+      return;
+    }
+
+    skipped_num_ += skipped;
+    progress_.objects_done += skipped;
+    auto loaded = !objects.empty();
+    // the list runs from the back, objects loaded earlier go first
+    objects.insert(objects.end(),
+                   std::make_move_iterator(input_path_list_.begin()),
+                   std::make_move_iterator(input_path_list_.end()));
+    input_path_list_.swap(objects);
+    PrefetchNext();
+    if (!loaded && !obs_source_->IsDone() && !stop_requested_ &&
+        !is_finish_) {
+      // the listing has not caught up yet
+      RequestRefill(OBS_REFILL_RETRY_MS);
+    } else {
+      StartSessions();
+    }
+    ReportProgress(false);
+    batch_end = MarkBatchEnd();
+  }
+
+  if (batch_end) {
+    EndBatch();
+  }
+}
+
+void MATask::StartCheckpoint() {
+  auto dir =
+      ma_client_->config_->GetString(modelarts::CONFIG_OBS_CHECKPOINT_DIR, "");
+  if (dir.empty()) {
+    return;
+  }
+
+  auto name = task_info_->GetTaskId();
+  std::replace(name.begin(), name.end(), '/', '_');
+  auto interval_ms = ma_client_->config_->GetInt(
+                         modelarts::CONFIG_OBS_CHECKPOINT_INTERVAL, 10) *
+                     1000;
+  auto obs =
+      std::dynamic_pointer_cast<const modelarts::ObsIO>(task_info_->GetInput());
+  nlohmann::json header = {
+      {"bucket", obs->GetBucket()},
+      {"path", obs->GetPath()},
+      {"config", modelarts::Sha256Hex(task_info_->GetConfig() + "\n" +
+                                      output_config_)}};
+  checkpoint_ = std::make_shared<ObsCheckpoint>(
+      dir + "/" + name + ".ckpt", header.dump(), interval_ms);
+  checkpoint_->Load();
+}
+
+size_t MATask::SkipDoneObjects(std::vector<ObsObject> &objects) {
+  if (checkpoint_ == nullptr) {
+    return 0;
+  }
+
+  auto size = objects.size();
+  objects.erase(std::remove_if(objects.begin(), objects.end(),
+                               [this](const ObsObject &object) {
+                                 return checkpoint_->IsDone(object.key);
+                               }),
+                objects.end());
+  return size - objects.size();
+}
+
+void MATask::ReportProgress(bool force) {
+  if (!progress_func_ || obs_source_ == nullptr) {
+    return;
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  if (!force && now - last_progress_ < progress_interval_) {
+    return;
+  }
+  last_progress_ = now;
+  progress_.objects_total = obs_source_->GetListedNum();
+  progress_.listing_done = obs_source_->IsDone();
+  progress_.eta = EstimateFinishTime();
+  progress_func_(progress_);
+}
+
+int64_t MATask::EstimateFinishTime() {
+  // skipped objects took no time, they would make the rate look too high
+  auto processed = progress_.objects_done - skipped_num_;
+  auto finished = progress_.objects_done + progress_.objects_failed;
+  if (!progress_.listing_done || processed == 0 ||
+      finished >= progress_.objects_total) {
+    return 0;
+  }
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start_time_)
+                     .count();
+  auto remaining = static_cast<double>(elapsed) *
+                   (progress_.objects_total - finished) / processed;
+  auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::system_clock::now().time_since_epoch())
+                 .count();
+  return now + static_cast<int64_t>(remaining);
+}
+
+void MATask::StartPrefetcher(const modelbox::ObsOptions &opt) {
+  auto dir =
+      ma_client_->config_->GetString(modelarts::CONFIG_OBS_PREFETCH_DIR, "");
+  if (dir.empty()) {
+    return;
+  }
+
+  uint64_t max_mb =
+      ma_client_->config_->GetInt(modelarts::CONFIG_OBS_PREFETCH_MAX_MB, 1024);
+  auto max_depth =
+      ma_client_->config_->GetInt(modelarts::CONFIG_OBS_PREFETCH_DEPTH, 8);
+  auto prefetcher = std::make_shared<ObsPrefetcher>(
+      opt, dir, max_mb * 1024 * 1024, std::max(max_depth, 1));
+  auto status = prefetcher->Start();
+  if (!status) {
+    MBLOG_WARN << "obs prefetch disabled, error: " << status.WrapErrormsgs();
+    return;
+  }
+  prefetcher_ = prefetcher;
+}
+
+void MATask::PrefetchNext() {
+  if (prefetcher_ == nullptr) {
+    return;
+  }
+
+  // objects run from the back of the list
+  auto depth = prefetcher_->GetDepth();
+  std::vector<std::string> keys;
+  for (auto it = input_path_list_.rbegin();
+       it != input_path_list_.rend() && keys.size() < depth; ++it) {
+    keys.push_back(it->key);
+  }
+  prefetcher_->Request(keys);
+}
+
+bool MATask::TakePrefetched(nlohmann::json &info_json) {
+  if (prefetcher_ == nullptr || input_path_list_.empty()) {
+    return false;
+  }
+
+  auto &object = input_path_list_.back();
+  std::string local_path;
+  if (!prefetcher_->Take(object.key, local_path)) {
+    return false;
+  }
+
+  info_json["url"] = local_path;
+  info_json["url_type"] = "file";
+  TakeObsObject(local_path);
+  return true;
+}
+
+void MATask::TakeObsObject(const std::string &local_path) {
+  auto &object = input_path_list_.back();
+  inputs_running_.keys.push_back(object.key);
+  inputs_running_.bytes += object.size;
+  if (!local_path.empty()) {
+    inputs_running_.files.push_back(local_path);
+  }
+  input_path_list_.pop_back();
+}
+
+void MATask::ReleaseFiles(const std::vector<std::string> &files) {
+  if (prefetcher_ == nullptr) {
+    return;
+  }
+
+  for (auto &file : files) {
+    prefetcher_->Release(file);
+  }
+}
+
+void MATask::LookupObjectSizes(std::vector<ObsObject> &objects) {
+  auto obs =
+      std::dynamic_pointer_cast<const modelarts::ObsIO>(task_info_->GetInput());
+  modelbox::ObsOptions base_opt;
+  base_opt.bucket = obs->GetBucket();
+  base_opt.end_point =
+      ma_client_->config_->GetString(modelarts::CONFIG_ENDPOINT_OBS);
+
+  auto obs_client = modelbox::ObsClient::GetInstance();
+  for (auto &object : objects) {
+    if (object.size == 0) {
+      auto opt = base_opt;
+      opt.path = object.key;
+      object.size = obs_client->GetObjectSize(opt);
+    }
+  }
+}
+
+void MATask::SortObsFileListBySize(std::vector<ObsObject> &objects) {
+  LookupObjectSizes(objects);
+  std::vector<std::pair<uint64_t, size_t>> sizes(objects.size());
+  for (size_t i = 0; i < objects.size(); ++i) {
+    sizes[i] = {objects[i].size, i};
+  }
+
+  // the list is consumed from the back, so the largest object starts first
+  std::stable_sort(sizes.begin(), sizes.end(),
+                   [](const std::pair<uint64_t, size_t> &a,
+                      const std::pair<uint64_t, size_t> &b) {
+                     return a.first < b.first;
+                   });
+  std::vector<ObsObject> sorted;
+  sorted.reserve(sizes.size());
+  for (auto &size : sizes) {
+    sorted.push_back(std::move(objects[size.second]));
+  }
+  objects.swap(sorted);
+  MBLOG_DEBUG << "obs objects sorted: " << sizes.size()
+              << " largest: " << sizes.back().first << " bytes";
 }
 
 modelbox::Status MATask::Init() {
+  batch_concurrency_ = std::max(
+      ma_client_->config_->GetInt(modelarts::CONFIG_OBS_BATCH_CONCURRENCY, 1),
+      1);
+  batch_objects_ = std::max(
+      ma_client_->config_->GetInt(modelarts::CONFIG_OBS_BATCH_OBJECTS, 1), 1);
+  progress_interval_ = std::chrono::seconds(
+      ma_client_->config_->GetInt(modelarts::CONFIG_TASK_PROGRESS_INTERVAL, 5));
+
+  // the outputs are the same for every session of the task
+  auto status = BuildModelBoxTaskOutputInfo(output_config_);
+  if (!status) {
+    MBLOG_ERROR << "build modelbox task output failed.";
+    return status;
+  }
+  for (auto &it : task_info_->GetOutputs()) {
+    outputs_.push_back(it->ToString());
+    MBLOG_INFO << "modelbox task output: " << it->ToString();
+  }
+
   auto input_type = task_info_->GetInput()->GetType();
+  if (input_type == "obs_manifest") {
+    return StartObsSource(true);
+  }
+
   if (input_type == "obs") {
     auto obs = std::dynamic_pointer_cast<const modelarts::ObsIO>(
         task_info_->GetInput());
     auto input_path = obs->GetPath();
     if (input_path.rfind("/") == input_path.length() - 1) {
-      return GetObsFileListByPath();
+      status = StartObsSource(false);
+      if (!status) {
+        return status;
+      }
     }
   }
 
@@ -69,66 +422,275 @@ modelbox::Status MATask::Init() {
 }
 
 modelbox::Status MATask::Stop() {
-  MBLOG_INFO << "modelbox task begin stop . modelarts taskid: "
-             << task_info_->GetTaskId()
-             << "  modelbox taskid:" << modelbox_task_->GetTaskId();
-
-  auto status = modelbox_task_->Stop();
-  if (!status) {
-    MBLOG_ERROR << "modelbox task stop failed.  modelarts taskid: "
-                << task_info_->GetTaskId()
-                << "  modelbox taskid:" << modelbox_task_->GetTaskId()
-                << " error: " << status.WrapErrormsgs();
-    return modelbox::STATUS_FAULT;
+  stop_requested_ = true;
+  std::lock_guard<std::mutex> lock(session_mutex_);
+  if (sessions_.empty() && refilling_) {
+    // the pending refill sees the stop and ends the batch
+    return modelbox::STATUS_SUCCESS;
+  }
+  if (sessions_.empty()) {
+    return {modelbox::STATUS_FAULT, "no modelbox task running"};
   }
 
-  MBLOG_INFO << "modelbox task stop success. modelarts taskid: "
-             << task_info_->GetTaskId()
-             << "  modelbox taskid:" << modelbox_task_->GetTaskId();
+  modelbox::Status result = modelbox::STATUS_SUCCESS;
+  for (auto &session : sessions_) {
+    MBLOG_INFO << "modelbox task begin stop . modelarts taskid: "
+               << task_info_->GetTaskId() << "  modelbox taskid:"
+               << session.first;
 
-  return modelbox::STATUS_SUCCESS;
+    auto status = session.second->Stop();
+    if (!status) {
+      MBLOG_ERROR << "modelbox task stop failed.  modelarts taskid: "
+                  << task_info_->GetTaskId()
+                  << "  modelbox taskid:" << session.first
+                  << " error: " << status.WrapErrormsgs();
+      result = modelbox::STATUS_FAULT;
+      continue;
+    }
+
+    MBLOG_INFO << "modelbox task stop success. modelarts taskid: "
+               << task_info_->GetTaskId() << "  modelbox taskid:"
+               << session.first;
+  }
+
+  return result;
 }
 
 modelbox::Status MATask::Delete() {
-  return modelbox_task_manager_->DeleteTaskById(modelbox_task_->GetTaskId());
+  std::lock_guard<std::mutex> lock(session_mutex_);
+  if (obs_source_ != nullptr) {
+    obs_source_->Stop();
+  }
+
+  modelbox::Status result = modelbox::STATUS_SUCCESS;
+  for (auto &session : sessions_) {
+    ma_client_->task_registry_->RemoveModelboxTask(task_info_->GetTaskId(),
+                                                   session.first);
+    auto status = modelbox_task_manager_->DeleteTaskById(session.first);
+    if (!status) {
+      result = status;
+    }
+    slots_->Release();
+  }
+  sessions_.clear();
+  session_inputs_.clear();
+  if (checkpoint_ != nullptr) {
+    checkpoint_->Flush();
+  }
+  if (prefetcher_ != nullptr) {
+    prefetcher_->Stop();
+  }
+  return result;
 }
 
 modelbox::Status MATask::Run() {
+  if (func_ == nullptr) {
+    return {modelbox::STATUS_FAULT,
+            "modelbox task status callback not be set, please set it first. "};
+  }
+
+  std::lock_guard<std::mutex> lock(session_mutex_);
+  slots_->Acquire();
+  auto status = StartSession();
+  if (!status) {
+    slots_->Release();
+    return status;
+  }
+
+  StartSessions();
+  return modelbox::STATUS_SUCCESS;
+}
+
+modelbox::Status MATask::StartSession() {
+  inputs_running_ = SessionInputs();
   auto task = modelbox_task_manager_->CreateTask(modelbox::TASK_ONESHOT);
   modelbox_task_ = std::dynamic_pointer_cast<modelbox::OneShotTask>(task);
   if (modelbox_task_ == nullptr) {
     return {modelbox::STATUS_FAULT, "modelbox task create failed."};
   }
 
+  auto session_id = modelbox_task_->GetTaskId();
   auto status = PreProcess();
   if (!status) {
+    modelbox_task_manager_->DeleteTaskById(session_id);
+    ReleaseFiles(inputs_running_.files);
     return {modelbox::STATUS_FAULT,
             "modelbox task preprocess failed. " + status.WrapErrormsgs()};
   }
 
-  if (func_ == nullptr) {
-    return {modelbox::STATUS_FAULT,
-            "modelbox task status callback not be set, please set it first. "};
-  }
   modelbox_task_->RegisterStatusCallback(func_);
-
+  ma_client_->task_registry_->AddModelboxTask(task_info_->GetTaskId(),
+                                              session_id);
+  sessions_[session_id] = modelbox_task_;
   status = modelbox_task_->Start();
   if (!status) {
+    sessions_.erase(session_id);
+    ma_client_->task_registry_->RemoveModelboxTask(task_info_->GetTaskId(),
+                                                   session_id);
+    modelbox_task_manager_->DeleteTaskById(session_id);
+    ReleaseFiles(inputs_running_.files);
     return {modelbox::STATUS_FAULT,
             "modelbox task create failed. " + status.WrapErrormsgs()};
   }
 
+  session_inputs_[session_id] = inputs_running_;
+  PrefetchNext();
   MBLOG_INFO << " modelarts task run success, modelarts taskid:  "
-             << task_info_->GetTaskId()
-             << " modelbox taskid::" << modelbox_task_->GetTaskId();
+             << task_info_->GetTaskId() << " modelbox taskid::" << session_id
+             << " sessions: " << sessions_.size();
   return modelbox::STATUS_SUCCESS;
 }
 
+void MATask::StartSessions() {
+  // the first session takes a slot even when all are in use, the task is
+  // already admitted
+  while (!stop_requested_ && !is_finish_ && !start_failed_ &&
+         !input_path_list_.empty() &&
+         sessions_.size() < static_cast<size_t>(batch_concurrency_)) {
+    if (sessions_.empty()) {
+      slots_->Acquire();
+    } else if (!slots_->TryAcquire()) {
+      break;
+    }
+
+    auto status = StartSession();
+    if (!status) {
+      slots_->Release();
+      progress_.objects_failed += inputs_running_.keys.size();
+      start_failed_ = sessions_.empty();
+      MBLOG_WARN << "start batch session failed, modelarts taskid: "
+                 << task_info_->GetTaskId() << " error: "
+                 << status.WrapErrormsgs();
+      break;
+    }
+  }
+
+  if (!stop_requested_ && !is_finish_ &&
+      input_path_list_.size() < OBS_REFILL_LOW_NUM) {
+    RequestRefill(0);
+  }
+}
+
+bool MATask::MarkBatchEnd() {
+  if (batch_ended_ || !sessions_.empty()) {
+    return false;
+  }
+
+  auto stopping = stop_requested_ || is_finish_ || start_failed_;
+  if (!stopping &&
+      (!input_path_list_.empty() || refilling_ ||
+       (obs_source_ != nullptr && !obs_source_->IsDrained()))) {
+    return false;
+  }
+
+  batch_ended_ = true;
+  return true;
+}
+
+void MATask::EndBatch() {
+  auto status = modelarts::TASK_STATUS_SUCCEEDED;
+  std::string reason;
+  {
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    ReportProgress(true);
+    if (obs_source_ == nullptr && abnormal_) {
+      status = modelarts::TASK_STATUS_FAILED;
+      reason = "modelbox task abnormal";
+    } else if (start_failed_) {
+      status = modelarts::TASK_STATUS_FAILED;
+      reason = "start modelbox session failed";
+    } else if (obs_source_ != nullptr && !stop_requested_ && !is_finish_) {
+      auto failed = progress_.objects_failed;
+      if (!obs_source_->GetStatus()) {
+        status = modelarts::TASK_STATUS_FAILED;
+        reason = "list obs objects failed";
+      } else if (failed > 0) {
+        status = modelarts::TASK_STATUS_FAILED;
+        reason = std::to_string(failed) + " of " +
+                 std::to_string(progress_.objects_total) +
+                 " obs objects failed";
+      }
+    }
+    // a failed or stopped object stays open for the resubmitted task
+    if (checkpoint_ != nullptr && !stop_requested_ && !is_finish_ &&
+        status == modelarts::TASK_STATUS_SUCCEEDED) {
+      MBLOG_INFO << "obs batch done, modelarts taskid: "
+                 << task_info_->GetTaskId()
+                 << " skipped by checkpoint: " << skipped_num_;
+      checkpoint_->Remove();
+    }
+  }
+
+  if (finish_func_) {
+    finish_func_(status, reason);
+  }
+}
+
+void MATask::OnSessionEnd(const std::string &modelbox_task_id,
+                          modelbox::TaskStatus status) {
+  auto completed = status == modelbox::FINISHED;
+  bool batch_end = false;
+  {
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    auto it = sessions_.find(modelbox_task_id);
+    if (it == sessions_.end()) {
+      return;
+    }
+
+    if (status == modelbox::ABNORMAL) {
+      abnormal_ = true;
+      MBLOG_WARN << "modelbox session abnormal, modelarts taskid: "
+                 << task_info_->GetTaskId()
+                 << " modelbox taskid: " << modelbox_task_id;
+    }
+    sessions_.erase(it);
+    ma_client_->task_registry_->RemoveModelboxTask(task_info_->GetTaskId(),
+                                                   modelbox_task_id);
+    modelbox_task_manager_->DeleteTaskById(modelbox_task_id);
+    slots_->Release();
+    auto inputs = session_inputs_.find(modelbox_task_id);
+    if (inputs != session_inputs_.end()) {
+      ReleaseFiles(inputs->second.files);
+      if (completed && checkpoint_ != nullptr) {
+        checkpoint_->MarkDone(inputs->second.keys);
+      }
+      if (completed) {
+        progress_.objects_done += inputs->second.keys.size();
+        progress_.bytes_processed += inputs->second.bytes;
+      } else {
+        progress_.objects_failed += inputs->second.keys.size();
+      }
+      session_inputs_.erase(inputs);
+    }
+
+    StartSessions();
+    ReportProgress(false);
+    batch_end = MarkBatchEnd();
+  }
+
+  if (batch_end) {
+    EndBatch();
+  }
+}
+
+size_t MATask::GetSessionNum() {
+  std::lock_guard<std::mutex> lock(session_mutex_);
+  return sessions_.size();
+}
+
 void MATask::RegisterStatusCallback(
     modelbox::TaskStatusCallback func) {
   func_ = func;
 }
 
+void MATask::RegisterProgressCallback(TaskProgressCallback func) {
+  progress_func_ = func;
+}
+
+void MATask::RegisterFinishCallback(TaskFinishCallback func) {
+  finish_func_ = func;
+}
+
 modelbox::Status MATask::FillObsInputInfo(
     nlohmann::json &info_json,
     const std::shared_ptr<const modelarts::TaskIO> &io) {
@@ -139,9 +701,8 @@ modelbox::Status MATask::FillObsInputInfo(
   if (input_path_list_.empty()) {
     info_json["path"] = obs->GetPath();
   } else {
-    info_json["path"] = input_path_list_.back();
-    input_path_running_ = info_json["path"];
-    input_path_list_.pop_back();
+    info_json["path"] = input_path_list_.back().key;
+    TakeObsObject("");
   }
 
   return modelbox::STATUS_SUCCESS;
@@ -290,7 +851,10 @@ modelbox::Status MATask::BuildModelBoxTaskInputInfo(std::string &input_config,
   auto input_type = task_info_->GetInput()->GetType();
   modelbox::Status status;
   nlohmann::json info_json;
-  if (input_type == "obs") {
+  if ((input_type == "obs" || input_type == "obs_manifest") &&
+      TakePrefetched(info_json)) {
+    source_type = "url";
+  } else if (input_type == "obs" || input_type == "obs_manifest") {
     source_type = "obs";
     status = FillObsInputInfo(info_json, task_info_->GetInput());
   } else if (input_type == "vis") {
@@ -356,12 +920,13 @@ modelbox::Status MATask::BuildModelBoxTaskOutputInfo(
 
 std::string MATask::GetInputStringForActualPath() {
   auto input_type = task_info_->GetInput()->GetType();
-  if (input_type == "obs" && input_path_running_ != "") {
+  if ((input_type == "obs" || input_type == "obs_manifest") &&
+      inputs_running_.keys.size() == 1) {
     nlohmann::json json_data;
     auto obs = std::dynamic_pointer_cast<const modelarts::ObsIO>(
         task_info_->GetInput());
     json_data["data"] = {{"bucket", obs->GetBucket()},
-                         {"path", input_path_running_}};
+                         {"path", inputs_running_.keys.front()}};
     json_data["type"] = "obs";
     return json_data.dump();
   } else {
@@ -370,26 +935,13 @@ std::string MATask::GetInputStringForActualPath() {
 }
 
 modelbox::Status MATask::FillSessionConfig() {
-  std::string output_config;
-  auto status = BuildModelBoxTaskOutputInfo(output_config);
-  if (!status) {
-    MBLOG_ERROR << "build modelbox task output failed.";
-    return status;
-  }
-
   auto config = modelbox_task_->GetSessionConfig();
-  config->SetProperty("flowunit.output_broker.config", output_config);
+  config->SetProperty("flowunit.output_broker.config", output_config_);
   auto input_str = GetInputStringForActualPath();
   config->SetProperty("nodes.modelarts_task_input", input_str);
   MBLOG_INFO << "modelbox task input: " << input_str;
 
-  std::vector<std::string> outputs;
-  for (auto &it : task_info_->GetOutputs()) {
-    outputs.push_back(it->ToString());
-    MBLOG_INFO << "modelbox task output: " << it->ToString();
-  }
-
-  config->SetProperty("nodes.modelarts_task_output", outputs);
+  config->SetProperty("nodes.modelarts_task_output", outputs_);
   config->SetProperty("nodes.modelarts_task_config", task_info_->GetConfig());
   config->SetProperty("nodes.modelarts_task_id", task_info_->GetTaskId());
 
@@ -397,43 +949,55 @@ modelbox::Status MATask::FillSessionConfig() {
 }
 
 modelbox::Status MATask::FillInputData() {
-  std::string input_cfg;
-  std::string source_type;
+  std::vector<std::string> input_cfgs;
+  std::vector<size_t> sizes;
+  std::vector<std::string> source_types;
   std::string input_name = "input1";
-  auto status = BuildModelBoxTaskInputInfo(input_cfg, source_type);
-  if (!status) {
-    MBLOG_ERROR << "build modelbox task input failed.";
-    return status;
-  }
+  inputs_running_ = SessionInputs();
+  do {
+    std::string input_cfg;
+    std::string source_type;
+    auto status = BuildModelBoxTaskInputInfo(input_cfg, source_type);
+    if (!status) {
+      MBLOG_ERROR << "build modelbox task input failed.";
+      return status;
+    }
+    sizes.push_back(input_cfg.size());
+    input_cfgs.push_back(input_cfg);
+    source_types.push_back(source_type);
+  } while (input_cfgs.size() < batch_objects_ && !input_path_list_.empty());
 
   auto buff_list = modelbox_task_->CreateBufferList();
-  status = buff_list->Build({input_cfg.size()});
+  auto status = buff_list->Build(sizes);
   if (!status) {
     MBLOG_ERROR << "input buffer build failed.";
     return status;
   }
 
-  auto buff = buff_list->At(0);
-  if (buff == nullptr) {
-    MBLOG_ERROR << "buffer is null.";
-    return modelbox::STATUS_FAULT;
-  }
+  for (size_t i = 0; i < input_cfgs.size(); ++i) {
+    auto buff = buff_list->At(i);
+    if (buff == nullptr) {
+      MBLOG_ERROR << "buffer is null.";
+      return modelbox::STATUS_FAULT;
+    }
 
-  auto buffer_ptr = buff->MutableData();
-  if (buffer_ptr == nullptr) {
-    MBLOG_ERROR << "buffer_ptr is null.";
-    return modelbox::STATUS_FAULT;
-  }
+    auto buffer_ptr = buff->MutableData();
+    if (buffer_ptr == nullptr) {
+      MBLOG_ERROR << "buffer_ptr is null.";
+      return modelbox::STATUS_FAULT;
+    }
 
-  auto ret = memcpy_s(buffer_ptr, buff->GetBytes(), input_cfg.data(),
-                      input_cfg.size());
-  if (ret > 0) {
-    MBLOG_ERROR << "memcpy failed. dest size:" << buff->GetBytes()
-                << " src size:" << input_cfg.size();
-    return modelbox::STATUS_FAULT;
+    auto ret = memcpy_s(buffer_ptr, buff->GetBytes(), input_cfgs[i].data(),
+                        input_cfgs[i].size());
+    if (ret > 0) {
+      MBLOG_ERROR << "memcpy failed. dest size:" << buff->GetBytes()
+                  << " src size:" << input_cfgs[i].size();
+      return modelbox::STATUS_FAULT;
+    }
+
+    buff->Set("source_type", source_types[i]);
   }
 
-  buff->Set("source_type", source_type);
   std::unordered_map<std::string, std::shared_ptr<modelbox::BufferList>> datas;
   datas.emplace(input_name, buff_list);
   status = modelbox_task_->FillData(datas);
@@ -445,19 +1009,8 @@ modelbox::Status MATask::FillInputData() {
   return modelbox::STATUS_SUCCESS;
 }
 
-void MATask::SetTaskFinishStatus(bool status) {
-  std::lock_guard<std::mutex> lock(task_finish_lock_);
-  is_finish_ = status;
-  task_finish_cv_.notify_all();
-}
+bool MATask::MarkTaskFinish() { return !is_finish_.exchange(true); }
 
 bool MATask::GetTaskFinishStatus() const { return is_finish_; }
 
-void MATask::WaitTaskFinish() {
-  std::unique_lock<std::mutex> lock(task_finish_lock_);
-  task_finish_cv_.wait(lock, [&]() { return GetTaskFinishStatus(); });
-}
-
-bool MATask::TaskCanFinish() { return input_path_list_.empty(); }
-
 }  // namespace modelartsplugin
\ No newline at end of file
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "obs_checkpoint.h"
+
+#include <modelbox/base/log.h>
+#include <unistd.h>
+
+#include <fstream>
+
+namespace modelartsplugin {
+
+ObsCheckpoint::ObsCheckpoint(const std::string &path,
+                             const std::string &header, int flush_interval_ms)
+    : path_(path),
+      header_(header),
+      flush_interval_(flush_interval_ms),
+      last_flush_(std::chrono::steady_clock::now()){};
+
+ObsCheckpoint::~ObsCheckpoint() { Flush(); }
+
+modelbox::Status ObsCheckpoint::Load() {
+  std::ifstream file(path_);
+  if (file.fail()) {
+    return modelbox::STATUS_SUCCESS;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string key;
+  if (!std::getline(file, key) || key != header_) {
+    // the task id was reused for another input or config
+    MBLOG_WARN << "obs checkpoint of another task input, drop it. path: "
+               << path_ << " header: " << key;
+    unlink(path_.c_str());
+    return modelbox::STATUS_SUCCESS;
+  }
+
+  header_written_ = true;
+  while (std::getline(file, key)) {
+    if (!key.empty()) {
+      done_.insert(key);
+    }
+  }
+  MBLOG_INFO << "obs checkpoint loaded, path: " << path_
+             << " done objects: " << done_.size();
+  return modelbox::STATUS_SUCCESS;
+}
+
+bool ObsCheckpoint::IsDone(const std::string &key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return done_.find(key) != done_.end();
+}
+
+void ObsCheckpoint::MarkDone(const std::vector<std::string> &keys) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &key : keys) {
+    if (done_.insert(key).second) {
+      unflushed_.push_back(key);
+    }
+  }
+
+  if (std::chrono::steady_clock::now() - last_flush_ >= flush_interval_) {
+    FlushLocked();
+  }
+}
+
+void ObsCheckpoint::Flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  FlushLocked();
+}
+
+void ObsCheckpoint::FlushLocked() {
+  last_flush_ = std::chrono::steady_clock::now();
+  if (unflushed_.empty() || removed_) {
+    return;
+  }
+
+  std::ofstream file(path_, header_written_ ? std::ios::app : std::ios::trunc);
+  if (!header_written_) {
+    file << header_ << "\n";
+  }
+  for (auto &key : unflushed_) {
+    file << key << "\n";
+  }
+  file.flush();
+  if (file.fail()) {
+    MBLOG_WARN << "write obs checkpoint failed, path: " << path_;
+    return;
+  }
+  header_written_ = true;
+  unflushed_.clear();
+}
+
+void ObsCheckpoint::Remove() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  removed_ = true;
+  unflushed_.clear();
+  unlink(path_.c_str());
+}
+
+size_t ObsCheckpoint::GetDoneNum() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return done_.size();
+}
+
+}  // namespace modelartsplugin
@@ -0,0 +1,302 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "obs_object_source.h"
+
+#include <modelbox/base/log.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+namespace modelartsplugin {
+
+constexpr size_t MANIFEST_PUSH_NUM = 256;
+constexpr size_t LIST_PUSH_NUM = 256;
+constexpr size_t SIZE_LOOKUP_THREADS = 8;
+
+ObsObjectSource::ObsObjectSource(const modelbox::ObsOptions &opt,
+                                 size_t buffer_num)
+    : opt_(opt), buffer_num_(std::max<size_t>(buffer_num, 1)){};
+
+ObsObjectSource::~ObsObjectSource() { Stop(); }
+
+void ObsObjectSource::Start() {
+  thread_ = std::thread(&ObsObjectSource::ProduceLoop, this);
+}
+
+void ObsObjectSource::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void ObsObjectSource::ProduceLoop() {
+  auto status = Produce();
+  if (!status) {
+    MBLOG_ERROR << "produce obs objects failed, bucket: " << opt_.bucket
+                << " path: " << opt_.path << " error: " << status;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  status_ = status;
+  done_ = true;
+  cv_.notify_all();
+  MBLOG_INFO << "produce obs objects end, bucket: " << opt_.bucket
+             << " path: " << opt_.path << " objects: " << listed_num_;
+}
+
+bool ObsObjectSource::Push(std::vector<ObsObject> &objects) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this]() { return stop_ || objects_.size() < buffer_num_; });
+  if (stop_) {
+    return false;
+  }
+
+  listed_num_ += objects.size();
+  for (auto &object : objects) {
+    objects_.push_back(std::move(object));
+  }
+  objects.clear();
+  cv_.notify_all();
+  return true;
+}
+
+void ObsObjectSource::Pop(std::vector<ObsObject> &objects, size_t max_num,
+                          bool wait) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (wait) {
+    cv_.wait(lock, [this]() { return !objects_.empty() || done_; });
+  }
+
+  while (!objects_.empty() && objects.size() < max_num) {
+    objects.push_back(std::move(objects_.front()));
+    objects_.pop_front();
+  }
+  cv_.notify_all();
+}
+
+modelbox::Status ObsObjectSource::GetStatus() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return status_;
+}
+
+size_t ObsObjectSource::GetListedNum() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return listed_num_;
+}
+
+bool ObsObjectSource::IsDone() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return done_;
+}
+
+bool ObsObjectSource::IsDrained() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return done_ && objects_.empty();
+}
+
+ObsObjectLister::ObsObjectLister(const modelbox::ObsOptions &opt,
+                                 size_t buffer_num,
+                                 const modelarts::ObsFilter &filter)
+    : ObsObjectSource(opt, buffer_num), filter_(filter){};
+
+ObsObjectLister::~ObsObjectLister() { Stop(); }
+
+bool ObsObjectLister::AcceptKey(const std::string &key) {
+  if (key.empty() || key.back() == '/') {
+    return false;
+  }
+
+  auto relative_key = key.substr(std::min(key.size(), opt_.path.size()));
+  return filter_.MatchKey(relative_key);
+}
+
+void ObsObjectLister::LookupSizes(std::vector<ObsObject> &objects) {
+  // one HEAD per object, several in flight hide the round trips
+  std::atomic<size_t> next{0};
+  auto lookup = [this, &objects, &next]() {
+    for (auto i = next++; i < objects.size(); i = next++) {
+      auto opt = opt_;
+      opt.path = objects[i].key;
+      objects[i].size =
+          modelbox::ObsClient::GetInstance()->GetObjectSize(opt);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  auto thread_num = std::min(objects.size(), SIZE_LOOKUP_THREADS);
+  for (size_t i = 1; i < thread_num; ++i) {
+    threads.emplace_back(lookup);
+  }
+  lookup();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+modelbox::Status ObsObjectLister::ListKeys(const std::string &prefix,
+                                          std::vector<std::string> &keys) {
+  auto opt = opt_;
+  opt.path = prefix;
+  keys.clear();
+  auto status = modelbox::ObsClient::GetInstance()->GetObjectsList(opt, keys);
+  if (!status) {
+    return {status, "list obs objects failed, prefix: " + prefix};
+  }
+
+  keys.erase(std::remove_if(keys.begin(), keys.end(),
+                            [&prefix](const std::string &key) {
+                              return key.compare(0, prefix.size(), prefix) != 0;
+                            }),
+             keys.end());
+  std::sort(keys.begin(), keys.end());
+  return modelbox::STATUS_SUCCESS;
+}
+
+bool ObsObjectLister::PushKeys(std::vector<std::string>::const_iterator begin,
+                               std::vector<std::string>::const_iterator end) {
+  std::vector<ObsObject> objects;
+  for (auto key = begin; key != end; ++key) {
+    if (!AcceptKey(*key)) {
+      filtered_num_++;
+      continue;
+    }
+    ObsObject object;
+    object.key = *key;
+    objects.push_back(std::move(object));
+  }
+
+  if (filter_.HasSizeLimit()) {
+    LookupSizes(objects);
+    auto size_end = std::remove_if(
+        objects.begin(), objects.end(), [this](const ObsObject &object) {
+          return !filter_.MatchSize(object.size);
+        });
+    filtered_num_ += objects.end() - size_end;
+    objects.erase(size_end, objects.end());
+  }
+  return Push(objects);
+}
+
+modelbox::Status ObsObjectLister::Produce() {
+  std::vector<std::string> keys;
+  auto status = ListKeys(opt_.path, keys);
+  if (!status) {
+    return status;
+  }
+
+  for (size_t begin = 0; begin < keys.size(); begin += LIST_PUSH_NUM) {
+    auto end = std::min(keys.size(), begin + LIST_PUSH_NUM);
+    if (!PushKeys(keys.begin() + begin, keys.begin() + end)) {
+      break;
+    }
+  }
+
+  MBLOG_INFO << "obs objects filtered out: " << filtered_num_
+             << " prefix: " << opt_.path;
+  return modelbox::STATUS_SUCCESS;
+}
+
+ObsManifestReader::~ObsManifestReader() { Stop(); }
+
+modelbox::Status ObsManifestReader::ParseLine(const std::string &line,
+                                              ObsObject &object) {
+  auto begin = line.find_first_not_of(" \t\r");
+  if (begin == std::string::npos || line[begin] == '#') {
+    return modelbox::STATUS_SUCCESS;
+  }
+  auto end = line.find_last_not_of(" \t\r");
+  auto item = line.substr(begin, end - begin + 1);
+  if (item[0] != '{') {
+    object.key = item;
+    return modelbox::STATUS_SUCCESS;
+  }
+
+  try {
+    auto j = nlohmann::json::parse(item);
+    if (j.contains("range") || j.contains("config")) {
+      return {modelbox::STATUS_NOTSUPPORT,
+              "manifest item range and config are not supported: " + item};
+    }
+    if (!j.contains("key") || !j["key"].is_string() ||
+        j["key"].get<std::string>().empty()) {
+      return {modelbox::STATUS_BADCONF, "manifest item has no key: " + item};
+    }
+    object.key = j["key"].get<std::string>();
+  } catch (const std::exception &e) {
+    return {modelbox::STATUS_BADCONF,
+            "invalid manifest item: " + item + " error: " + e.what()};
+  }
+
+  return modelbox::STATUS_SUCCESS;
+}
+
+modelbox::Status ObsManifestReader::Produce() {
+  char local_path[] = "/tmp/ma_manifest_XXXXXX";
+  auto fd = mkstemp(local_path);
+  if (fd < 0) {
+    return {modelbox::STATUS_FAULT, "create manifest file failed"};
+  }
+  close(fd);
+
+  auto status =
+      modelbox::ObsClient::GetInstance()->GetObject(opt_, local_path);
+  std::ifstream file(local_path);
+  // the open stream keeps the data readable
+  unlink(local_path);
+  if (!status) {
+    return {status, "download manifest failed, path: " + opt_.path};
+  }
+  if (file.fail()) {
+    return {modelbox::STATUS_FAULT, "open manifest failed"};
+  }
+
+  std::vector<ObsObject> objects;
+  std::string line;
+  size_t line_num = 0;
+  while (std::getline(file, line)) {
+    ++line_num;
+    ObsObject object;
+    status = ObsManifestReader::ParseLine(line, object);
+    if (!status) {
+      return {status, "manifest line " + std::to_string(line_num)};
+    }
+    if (object.key.empty()) {
+      continue;
+    }
+
+    objects.push_back(std::move(object));
+    if (objects.size() >= MANIFEST_PUSH_NUM && !Push(objects)) {
+      return modelbox::STATUS_SUCCESS;
+    }
+  }
+
+  if (!objects.empty()) {
+    Push(objects);
+  }
+  return modelbox::STATUS_SUCCESS;
+}
+
+}  // namespace modelartsplugin
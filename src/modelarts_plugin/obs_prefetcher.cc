@@ -0,0 +1,175 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "obs_prefetcher.h"
+
+#include <errno.h>
+#include <modelbox/base/log.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace modelartsplugin {
+
+ObsPrefetcher::ObsPrefetcher(const modelbox::ObsOptions &opt,
+                             const std::string &dir, uint64_t max_bytes,
+                             size_t max_depth)
+    : opt_(opt),
+      dir_(dir),
+      max_bytes_(max_bytes),
+      max_depth_(std::max<size_t>(max_depth, 1)){};
+
+ObsPrefetcher::~ObsPrefetcher() { Stop(); }
+
+modelbox::Status ObsPrefetcher::Start() {
+  if (mkdir(dir_.c_str(), 0750) != 0 && errno != EEXIST) {
+    return {modelbox::STATUS_FAULT,
+            "create prefetch dir " + dir_ + " failed, " + strerror(errno)};
+  }
+
+  thread_ = std::thread(&ObsPrefetcher::DownloadLoop, this);
+  return modelbox::STATUS_SUCCESS;
+}
+
+void ObsPrefetcher::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &file : file_bytes_) {
+    unlink(file.first.c_str());
+  }
+  file_bytes_.clear();
+  ready_.clear();
+  pending_.clear();
+  requested_.clear();
+  used_bytes_ = 0;
+}
+
+std::string ObsPrefetcher::LocalPath(const std::string &key) {
+  auto name = key.substr(key.rfind('/') + 1);
+  return dir_ + "/" + std::to_string(getpid()) + "_" +
+         std::to_string(file_index_++) + "_" + name;
+}
+
+void ObsPrefetcher::Request(const std::vector<std::string> &keys) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < keys.size() && i < depth_; ++i) {
+    if (requested_.size() >= depth_) {
+      break;
+    }
+    if (requested_.insert(keys[i]).second) {
+      pending_.push_back(keys[i]);
+    }
+  }
+  cv_.notify_all();
+}
+
+bool ObsPrefetcher::Take(const std::string &key, std::string &local_path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = ready_.find(key);
+  if (it != ready_.end()) {
+    local_path = it->second;
+    ready_.erase(it);
+    requested_.erase(key);
+    if (++hits_ >= depth_ * 2 && depth_ > 1) {
+      depth_--;
+      hits_ = 0;
+    }
+    return true;
+  }
+
+  // read from obs this time, a download still running is dropped when done
+  requested_.erase(key);
+  pending_.erase(std::remove(pending_.begin(), pending_.end(), key),
+                 pending_.end());
+  depth_ = std::min(depth_ + 1, max_depth_);
+  hits_ = 0;
+  return false;
+}
+
+void ObsPrefetcher::Release(const std::string &local_path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = file_bytes_.find(local_path);
+  if (it == file_bytes_.end()) {
+    return;
+  }
+
+  unlink(local_path.c_str());
+  used_bytes_ -= it->second;
+  file_bytes_.erase(it);
+  cv_.notify_all();
+}
+
+size_t ObsPrefetcher::GetDepth() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return depth_;
+}
+
+void ObsPrefetcher::DownloadLoop() {
+  auto obs_client = modelbox::ObsClient::GetInstance();
+  while (true) {
+    std::string key;
+    std::string local_path;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() {
+        return stop_ || (!pending_.empty() && used_bytes_ < max_bytes_);
+      });
+      if (stop_) {
+        return;
+      }
+
+      key = pending_.front();
+      pending_.pop_front();
+      local_path = LocalPath(key);
+    }
+
+    auto opt = opt_;
+    opt.path = key;
+    auto status = obs_client->GetObject(opt, local_path);
+    struct stat file_stat;
+    uint64_t bytes = 0;
+    if (status && stat(local_path.c_str(), &file_stat) == 0) {
+      bytes = file_stat.st_size;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!status || requested_.find(key) == requested_.end()) {
+      if (!status) {
+        MBLOG_WARN << "prefetch obs object failed, key: " << key
+                   << " error: " << status;
+        requested_.erase(key);
+      }
+      unlink(local_path.c_str());
+      continue;
+    }
+
+    file_bytes_[local_path] = bytes;
+    used_bytes_ += bytes;
+    ready_[key] = local_path;
+  }
+}
+
+}  // namespace modelartsplugin
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "task_event_queue.h"
+
+#include <modelbox/base/log.h>
+
+#include <algorithm>
+
+namespace modelartsplugin {
+
+constexpr size_t MAX_EVENTS_PER_ROUND = 32;
+
+TaskEventQueue::TaskEventQueue(
+    const std::shared_ptr<modelarts::Executor> &executor,
+    const TaskEventHandler &handler)
+    : executor_(executor), handler_(handler) {}
+
+bool TaskEventQueue::IsTerminal(modelbox::TaskStatus status) {
+  return status == modelbox::ABNORMAL || status == modelbox::STOPPED ||
+         status == modelbox::FINISHED;
+}
+
+void TaskEventQueue::Push(const std::string &modelbox_task_id,
+                          modelbox::TaskStatus status) {
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    ++pushed_;
+    auto &events = pending_[modelbox_task_id];
+    if (!events.empty()) {
+      // WORKING still queued before FINISHED is delivered, it records the
+      // first frame of short sessions
+      auto last = events.back().status;
+      if (last == status || IsTerminal(last)) {
+        ++coalesced_;
+      } else {
+        events.push_back({status, std::chrono::steady_clock::now()});
+      }
+      return;
+    }
+
+    events.push_back({status, std::chrono::steady_clock::now()});
+    order_.push_back(modelbox_task_id);
+    if (processing_) {
+      return;
+    }
+    processing_ = true;
+  }
+
+  executor_->Submit([this]() { this->Process(); });
+}
+
+void TaskEventQueue::Process() {
+  for (size_t i = 0; i < MAX_EVENTS_PER_ROUND; ++i) {
+    std::string modelbox_task_id;
+    std::deque<TaskEvent> events;
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      if (order_.empty()) {
+        processing_ = false;
+        return;
+      }
+      modelbox_task_id = order_.front();
+      order_.pop_front();
+      auto it = pending_.find(modelbox_task_id);
+      events.swap(it->second);
+      pending_.erase(it);
+
+      auto now = std::chrono::steady_clock::now();
+      for (auto &event : events) {
+        auto latency = std::chrono::duration<double, std::milli>(
+                           now - event.enqueue_time)
+                           .count();
+        ++processed_;
+        ++latency_count_;
+        latency_sum_ms_ += latency;
+        latency_max_ms_ = std::max(latency_max_ms_, latency);
+      }
+    }
+
+    for (auto &event : events) {
+      try {
+        handler_(modelbox_task_id, event.status);
+      } catch (const std::exception &e) {
+        MBLOG_ERROR << "handle task event failed, modelbox taskid: "
+                    << modelbox_task_id << " error: " << e.what();
+      }
+    }
+  }
+
+  // yield the worker between rounds so a burst cannot starve other work
+  executor_->Submit([this]() { this->Process(); });
+}
+
+nlohmann::json TaskEventQueue::GetMetrics() {
+  std::lock_guard<std::mutex> lock(queue_mutex_);
+  double avg_latency_ms = 0;
+  if (latency_count_ != 0) {
+    avg_latency_ms = latency_sum_ms_ / latency_count_;
+  }
+  nlohmann::json metrics = {{"queue_depth", order_.size()},
+                            {"pushed", pushed_},
+                            {"coalesced", coalesced_},
+                            {"processed", processed_},
+                            {"avg_latency_ms", avg_latency_ms},
+                            {"max_latency_ms", latency_max_ms_}};
+  return metrics;
+}
+
+}  // namespace modelartsplugin
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "worker_channel.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace modelartsplugin {
+
+constexpr size_t WORKER_READ_SIZE = 4096;
+constexpr size_t WORKER_MAX_MSG_SIZE = 16 * 1024 * 1024;
+
+WorkerChannel::WorkerChannel(int fd) : fd_(fd) {}
+
+WorkerChannel::~WorkerChannel() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+modelbox::Status WorkerChannel::Send(const nlohmann::json &msg) {
+  auto data = msg.dump() + "\n";
+  std::lock_guard<std::mutex> lock(send_mutex_);
+  size_t offset = 0;
+  while (offset < data.size()) {
+    auto len = send(fd_, data.data() + offset, data.size() - offset,
+                    MSG_NOSIGNAL);
+    if (len < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return {modelbox::STATUS_FAULT,
+              std::string("send to worker channel failed, ") +
+                  strerror(errno)};
+    }
+    offset += len;
+  }
+  return modelbox::STATUS_SUCCESS;
+}
+
+modelbox::Status WorkerChannel::Receive(nlohmann::json &msg) {
+  while (true) {
+    auto pos = buffer_.find('\n');
+    if (pos != std::string::npos) {
+      auto line = buffer_.substr(0, pos);
+      buffer_.erase(0, pos + 1);
+      try {
+        msg = nlohmann::json::parse(line);
+        return modelbox::STATUS_SUCCESS;
+      } catch (const std::exception &e) {
+        return {modelbox::STATUS_INVALID,
+                std::string("bad worker message, ") + e.what()};
+      }
+    }
+
+    if (buffer_.size() > WORKER_MAX_MSG_SIZE) {
+      return {modelbox::STATUS_INVALID, "worker message is too large"};
+    }
+
+    char data[WORKER_READ_SIZE];
+    auto len = read(fd_, data, sizeof(data));
+    if (len < 0 && errno == EINTR) {
+      continue;
+    }
+    if (len <= 0) {
+      return modelbox::STATUS_EOF;
+    }
+    buffer_.append(data, len);
+  }
+}
+
+void WorkerChannel::Shutdown() { shutdown(fd_, SHUT_RDWR); }
+
+}  // namespace modelartsplugin
@@ -0,0 +1,624 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "worker_pool.h"
+
+#include <dirent.h>
+#include <modelbox/base/log.h>
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+namespace modelartsplugin {
+
+constexpr int WORKER_CALL_TIMEOUT_MS = 30000;
+constexpr int WORKER_HEALTH_MISS_LIMIT = 3;
+constexpr int WORKER_STOP_WAIT_MS = 5000;
+constexpr int WORKER_STOP_POLL_MS = 100;
+constexpr int ZYGOTE_REPLY_TIMEOUT_SEC = 5;
+
+// workers are children of the zygote, which leaves reaping to the kernel
+static bool ProcessExited(pid_t pid) {
+  auto ret = waitpid(pid, nullptr, WNOHANG);
+  if (ret == pid) {
+    return true;
+  }
+  return ret < 0 && errno == ECHILD && kill(pid, 0) != 0 && errno == ESRCH;
+}
+
+static void WaitWorkerExit(pid_t pid) {
+  for (int waited = 0; waited < WORKER_STOP_WAIT_MS;
+       waited += WORKER_STOP_POLL_MS) {
+    if (ProcessExited(pid)) {
+      return;
+    }
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(WORKER_STOP_POLL_MS));
+  }
+
+  MBLOG_WARN << "worker does not exit in time, kill it. pid: " << pid;
+  kill(pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+}
+
+static size_t CountThreads() {
+  size_t count = 0;
+  auto dir = opendir("/proc/self/task");
+  if (dir == nullptr) {
+    return 0;
+  }
+  while (auto entry = readdir(dir)) {
+    if (entry->d_name[0] != '.') {
+      ++count;
+    }
+  }
+  closedir(dir);
+  return count;
+}
+
+WorkerPool::WorkerPool(size_t worker_num, const WorkerEntry &entry)
+    : worker_num_(std::max<size_t>(worker_num, 1)), entry_(entry) {}
+
+WorkerPool::~WorkerPool() { Stop(); }
+
+modelbox::Status WorkerPool::Start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto status = StartZygote();
+  if (!status) {
+    return status;
+  }
+
+  running_ = true;
+  for (size_t i = 0; i < worker_num_; ++i) {
+    auto worker = std::make_shared<Worker>();
+    worker->index = i;
+    workers_.push_back(worker);
+    status = Spawn(worker);
+    if (!status) {
+      return status;
+    }
+  }
+  return modelbox::STATUS_SUCCESS;
+}
+
+modelbox::Status WorkerPool::StartZygote() {
+  // a process forked while other threads run may inherit locks they hold
+  auto threads = CountThreads();
+  if (threads > 1) {
+    MBLOG_WARN << "fork worker zygote with " << threads << " threads running";
+  }
+
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) != 0) {
+    return {modelbox::STATUS_FAULT,
+            std::string("create zygote channel failed, ") + strerror(errno)};
+  }
+
+  auto pid = fork();
+  if (pid < 0) {
+    close(fds[0]);
+    close(fds[1]);
+    return {modelbox::STATUS_FAULT,
+            std::string("fork worker zygote failed, ") + strerror(errno)};
+  }
+
+  if (pid == 0) {
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    close(fds[0]);
+    ZygoteLoop(fds[1]);
+  }
+
+  close(fds[1]);
+  struct timeval timeout = {ZYGOTE_REPLY_TIMEOUT_SEC, 0};
+  setsockopt(fds[0], SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  zygote_fd_ = fds[0];
+  zygote_pid_ = pid;
+  MBLOG_INFO << "worker zygote start, pid: " << pid;
+  return modelbox::STATUS_SUCCESS;
+}
+
+void WorkerPool::ZygoteLoop(int fd) {
+  // single threaded from here on, so forking a worker is safe; no logging,
+  // the logger lock may be held by a thread of the control plane
+  signal(SIGCHLD, SIG_IGN);
+  while (true) {
+    uint64_t index = 0;
+    struct iovec iov = {&index, sizeof(index)};
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    auto len = recvmsg(fd, &msg, 0);
+    if (len < 0 && errno == EINTR) {
+      continue;
+    }
+    if (len <= 0) {
+      _exit(0);
+    }
+
+    auto cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == nullptr || cmsg->cmsg_type != SCM_RIGHTS) {
+      int32_t reply = -EINVAL;
+      send(fd, &reply, sizeof(reply), MSG_NOSIGNAL);
+      continue;
+    }
+    int channel_fd = -1;
+    memcpy(&channel_fd, CMSG_DATA(cmsg), sizeof(channel_fd));
+
+    auto pid = fork();
+    if (pid == 0) {
+      // dies with the zygote, and so with the control plane
+      prctl(PR_SET_PDEATHSIG, SIGKILL);
+      signal(SIGCHLD, SIG_DFL);
+      close(fd);
+      _exit(entry_(index, channel_fd));
+    }
+
+    int32_t reply = pid > 0 ? pid : -errno;
+    close(channel_fd);
+    send(fd, &reply, sizeof(reply), MSG_NOSIGNAL);
+  }
+}
+
+modelbox::Status WorkerPool::ForkWorker(size_t index, int channel_fd,
+                                        pid_t &pid) {
+  uint64_t msg_index = index;
+  struct iovec iov = {&msg_index, sizeof(msg_index)};
+  char control[CMSG_SPACE(sizeof(int))] = {};
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  auto cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &channel_fd, sizeof(channel_fd));
+  if (sendmsg(zygote_fd_, &msg, MSG_NOSIGNAL) < 0) {
+    return {modelbox::STATUS_FAULT,
+            std::string("send to worker zygote failed, ") + strerror(errno)};
+  }
+
+  int32_t reply = 0;
+  if (recv(zygote_fd_, &reply, sizeof(reply), 0) != sizeof(reply)) {
+    return {modelbox::STATUS_FAULT, "worker zygote does not reply"};
+  }
+  if (reply <= 0) {
+    return {modelbox::STATUS_FAULT,
+            std::string("fork worker failed, ") + strerror(-reply)};
+  }
+  pid = reply;
+  return modelbox::STATUS_SUCCESS;
+}
+
+modelbox::Status WorkerPool::Spawn(const std::shared_ptr<Worker> &worker) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+    return {modelbox::STATUS_FAULT,
+            std::string("create worker channel failed, ") + strerror(errno)};
+  }
+
+  pid_t pid = -1;
+  auto status = ForkWorker(worker->index, fds[1], pid);
+  close(fds[1]);
+  if (!status) {
+    close(fds[0]);
+    return status;
+  }
+
+  worker->pid = pid;
+  worker->channel = std::make_shared<WorkerChannel>(fds[0]);
+  worker->alive = true;
+  worker->last_health = std::chrono::steady_clock::now();
+  ++reader_count_;
+  std::thread(&WorkerPool::ReadLoop, this, worker, worker->channel).detach();
+  MBLOG_INFO << "worker start, index: " << worker->index << " pid: " << pid;
+  return modelbox::STATUS_SUCCESS;
+}
+
+void WorkerPool::Watch(const std::shared_ptr<modelarts::Executor> &executor,
+                       int health_interval_ms,
+                       const WorkerStatusFunc &status_func,
+                       const WorkerFirstFrameFunc &first_frame_func,
+                       const WorkerProgressFunc &progress_func) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  executor_ = executor;
+  health_interval_ms_ = std::max(health_interval_ms, 1);
+  status_func_ = status_func;
+  first_frame_func_ = first_frame_func;
+  progress_func_ = progress_func;
+  health_timer_ = executor_->Schedule(health_interval_ms_,
+                                      [this]() { this->HealthCheck(); });
+}
+
+void WorkerPool::Stop() {
+  std::vector<std::shared_ptr<Worker>> workers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+    if (executor_ != nullptr) {
+      executor_->Cancel(health_timer_);
+    }
+    workers = workers_;
+  }
+
+  // a worker stops its pipeline and exits once its channel is closed
+  for (auto &worker : workers) {
+    pid_t pid = -1;
+    std::shared_ptr<WorkerChannel> channel;
+    std::map<uint64_t, std::shared_ptr<std::promise<nlohmann::json>>> pending;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      worker->alive = false;
+      pid = worker->pid;
+      worker->pid = -1;
+      channel = worker->channel;
+      pending.swap(worker->pending);
+    }
+
+    for (auto &item : pending) {
+      item.second->set_value({{"ok", false}});
+    }
+    if (channel != nullptr) {
+      channel->Shutdown();
+    }
+    if (pid > 0) {
+      WaitWorkerExit(pid);
+    }
+  }
+
+  // the zygote exits once its channel is closed
+  if (zygote_fd_ >= 0) {
+    close(zygote_fd_);
+    zygote_fd_ = -1;
+    WaitWorkerExit(zygote_pid_);
+    zygote_pid_ = -1;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  reader_cond_.wait(lock, [this]() { return reader_count_ == 0; });
+  MBLOG_INFO << "worker pool stop.";
+}
+
+void WorkerPool::ReadLoop(std::shared_ptr<Worker> worker,
+                          std::shared_ptr<WorkerChannel> channel) {
+  while (true) {
+    nlohmann::json msg;
+    auto status = channel->Receive(msg);
+    if (status == modelbox::STATUS_EOF) {
+      break;
+    }
+    if (!status) {
+      MBLOG_WARN << "worker " << worker->index << ": "
+                 << status.WrapErrormsgs();
+      continue;
+    }
+    HandleMessage(worker, msg);
+  }
+
+  OnWorkerLost(worker, channel);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    --reader_count_;
+  }
+  reader_cond_.notify_all();
+}
+
+void WorkerPool::HandleMessage(const std::shared_ptr<Worker> &worker,
+                               const nlohmann::json &msg) {
+  auto type = msg.value("type", "");
+  if (type == WORKER_MSG_REPLY) {
+    std::shared_ptr<std::promise<nlohmann::json>> promise;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (msg.contains("finished_sessions")) {
+        worker->finished_sessions = msg["finished_sessions"].get<uint64_t>();
+        worker->last_health = std::chrono::steady_clock::now();
+      }
+      auto it = worker->pending.find(msg.value("seq", (uint64_t)0));
+      if (it == worker->pending.end()) {
+        return;
+      }
+      promise = it->second;
+      worker->pending.erase(it);
+    }
+    promise->set_value(msg);
+    return;
+  }
+
+  auto task_id = msg.value("task_id", "");
+  if (type == WORKER_MSG_FIRST_FRAME) {
+    WorkerFirstFrameFunc first_frame_func;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      first_frame_func = first_frame_func_;
+    }
+    if (first_frame_func) {
+      first_frame_func(task_id);
+    }
+    return;
+  }
+
+  if (type == WORKER_MSG_PROGRESS) {
+    WorkerProgressFunc progress_func;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      progress_func = progress_func_;
+    }
+    if (progress_func && msg.contains("progress")) {
+      progress_func(task_id, msg["progress"].get<modelarts::TaskProgress>());
+    }
+    return;
+  }
+
+  if (type != WORKER_MSG_STATUS) {
+    MBLOG_WARN << "unknown worker message type: " << type;
+    return;
+  }
+
+  auto status = (modelarts::TaskStatusCode)msg.value(
+      "status", (int)modelarts::TASK_STATUS_FAILED);
+  WorkerStatusFunc status_func;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (status == modelarts::TASK_STATUS_SUCCEEDED ||
+        status == modelarts::TASK_STATUS_FAILED) {
+      worker->tasks.erase(task_id);
+      task_workers_.erase(task_id);
+    }
+    status_func = status_func_;
+  }
+
+  if (status_func) {
+    status_func(task_id, status, msg.value("reason", ""));
+  }
+}
+
+bool WorkerPool::Call(const std::shared_ptr<Worker> &worker,
+                      nlohmann::json msg) {
+  auto promise = std::make_shared<std::promise<nlohmann::json>>();
+  auto future = promise->get_future();
+  std::shared_ptr<WorkerChannel> channel;
+  uint64_t seq = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!worker->alive) {
+      return false;
+    }
+    seq = ++next_seq_;
+    worker->pending[seq] = promise;
+    channel = worker->channel;
+  }
+
+  msg["seq"] = seq;
+  auto status = channel->Send(msg);
+  if (status && future.wait_for(std::chrono::milliseconds(
+                    WORKER_CALL_TIMEOUT_MS)) == std::future_status::ready) {
+    return future.get().value("ok", false);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    worker->pending.erase(seq);
+  }
+  MBLOG_WARN << "call worker failed, index: " << worker->index
+             << " type: " << msg.value("type", "");
+  return false;
+}
+
+void WorkerPool::HealthCheck() {
+  using LostWorker =
+      std::pair<std::shared_ptr<Worker>, std::shared_ptr<WorkerChannel>>;
+  std::vector<LostWorker> lost;
+  std::vector<std::pair<std::shared_ptr<WorkerChannel>, nlohmann::json>> probes;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) {
+      return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    auto deadline = std::chrono::milliseconds(health_interval_ms_ *
+                                              WORKER_HEALTH_MISS_LIMIT);
+    for (auto &worker : workers_) {
+      if (!worker->alive) {
+        continue;
+      }
+
+      if (ProcessExited(worker->pid)) {
+        worker->pid = -1;
+        lost.emplace_back(worker, worker->channel);
+        continue;
+      }
+      if (now - worker->last_health > deadline) {
+        lost.emplace_back(worker, worker->channel);
+        continue;
+      }
+
+      auto seq = ++next_seq_;
+      worker->pending[seq] = std::make_shared<std::promise<nlohmann::json>>();
+      probes.emplace_back(worker->channel,
+                          nlohmann::json({{"type", WORKER_MSG_HEALTH},
+                                          {"seq", seq}}));
+    }
+  }
+
+  for (auto &probe : probes) {
+    probe.first->Send(probe.second);
+  }
+  for (auto &item : lost) {
+    OnWorkerLost(item.first, item.second);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_) {
+    health_timer_ = executor_->Schedule(health_interval_ms_,
+                                        [this]() { this->HealthCheck(); });
+  }
+}
+
+void WorkerPool::OnWorkerLost(const std::shared_ptr<Worker> &worker,
+                              const std::shared_ptr<WorkerChannel> &channel) {
+  std::set<std::string> tasks;
+  std::map<uint64_t, std::shared_ptr<std::promise<nlohmann::json>>> pending;
+  WorkerStatusFunc status_func;
+  pid_t pid = -1;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (worker->channel != channel || !worker->alive) {
+      return;
+    }
+    worker->alive = false;
+    pid = worker->pid;
+    worker->pid = -1;
+    tasks.swap(worker->tasks);
+    pending.swap(worker->pending);
+    for (auto &task_id : tasks) {
+      task_workers_.erase(task_id);
+    }
+    lost_sessions_ += worker->finished_sessions;
+    worker->finished_sessions = 0;
+    status_func = status_func_;
+  }
+
+  MBLOG_ERROR << "worker lost, index: " << worker->index
+              << " tasks: " << tasks.size();
+  if (pid > 0) {
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+  }
+  channel->Shutdown();
+
+  for (auto &item : pending) {
+    item.second->set_value({{"ok", false}});
+  }
+  if (status_func) {
+    for (auto &task_id : tasks) {
+      status_func(task_id, modelarts::TASK_STATUS_FAILED,
+                  "pipeline worker lost");
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!running_) {
+    return;
+  }
+  ++worker->restarts;
+  auto status = Spawn(worker);
+  if (!status) {
+    MBLOG_ERROR << "restart worker failed, index: " << worker->index << " "
+                << status.WrapErrormsgs();
+  }
+}
+
+std::shared_ptr<WorkerPool::Worker> WorkerPool::PickWorker() {
+  std::shared_ptr<Worker> picked;
+  for (auto &worker : workers_) {
+    if (!worker->alive) {
+      continue;
+    }
+    if (picked == nullptr || worker->tasks.size() < picked->tasks.size()) {
+      picked = worker;
+    }
+  }
+  return picked;
+}
+
+bool WorkerPool::CreateTask(
+    const std::shared_ptr<modelarts::TaskInfo> &task_info) {
+  auto task_id = task_info->GetTaskId();
+  std::shared_ptr<Worker> worker;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    worker = PickWorker();
+    if (worker == nullptr) {
+      MBLOG_ERROR << "no alive worker, taskid: " << task_id;
+      return false;
+    }
+    worker->tasks.insert(task_id);
+    task_workers_[task_id] = worker;
+  }
+
+  auto ok = Call(worker, {{"type", WORKER_MSG_CREATE},
+                          {"task_id", task_id},
+                          {"spec", task_info->GetRawData()}});
+  if (!ok) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    worker->tasks.erase(task_id);
+    auto it = task_workers_.find(task_id);
+    if (it != task_workers_.end() && it->second == worker) {
+      task_workers_.erase(it);
+    }
+    return false;
+  }
+
+  MBLOG_INFO << "task placed on worker " << worker->index
+             << ", taskid: " << task_id;
+  return true;
+}
+
+bool WorkerPool::DeleteTask(const std::string &task_id) {
+  std::shared_ptr<Worker> worker;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = task_workers_.find(task_id);
+    if (it == task_workers_.end()) {
+      return false;
+    }
+    worker = it->second;
+  }
+
+  return Call(worker, {{"type", WORKER_MSG_DELETE}, {"task_id", task_id}});
+}
+
+uint64_t WorkerPool::GetFinishedSessions() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto sessions = lost_sessions_;
+  for (auto &worker : workers_) {
+    sessions += worker->finished_sessions;
+  }
+  return sessions;
+}
+
+nlohmann::json WorkerPool::GetMetrics() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  nlohmann::json metrics = nlohmann::json::array();
+  for (auto &worker : workers_) {
+    metrics.push_back({{"index", worker->index},
+                       {"pid", worker->pid},
+                       {"alive", worker->alive},
+                       {"tasks", worker->tasks.size()},
+                       {"restarts", worker->restarts}});
+  }
+  return metrics;
+}
+
+}  // namespace modelartsplugin
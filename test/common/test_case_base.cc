@@ -29,6 +29,7 @@ void SetEnv() {
         "iam_endpoint": "http://127.0.0.1:7000"
     },
     "notification_url": "http://127.0.0.1:7500/v2/notifications",
+    "notification_compress_threshold": 512,
     "instance_id": "MOCK_INSTANCE_ID",
     "service": {
         "port": 6500,
@@ -41,6 +42,15 @@ void SetEnv() {
         "domain_id": "DEVELOP_USER_DOMAIN_ID"
     },
     "input_count_max": 10,
+    "obs": {"batch_concurrency": 2},
+    "journal": {"path": ")" + std::string(TEST_WORKING_DIR) +
+                       R"(/task_journal"},
+    "handover": {"socket": ")" + std::string(TEST_WORKING_DIR) +
+                       R"(/handover.sock"},
+    "overload": {
+        "cpu_percent": 101,
+        "mem_percent": 101
+    },
     "algorithm": {
         "multi_task": "yes",
         "alg_type": "cloud"
@@ -127,17 +137,28 @@ modelbox::Status TestCaseBase::StartMockServer() {
 
   RegisterCustomHandle();
 
+  // every case starts without tasks left by the previous one
+  remove((std::string(TEST_WORKING_DIR) + "/task_journal").c_str());
+
+  if (StartModelboxProcess(MODELBOX_PID_FILE) != modelbox::STATUS_OK) {
+    return modelbox::STATUS_FAULT;
+  }
+
+  MBLOG_INFO << "mock server start success.";
+  return modelbox::STATUS_OK;
+}
+
+modelbox::Status TestCaseBase::StartModelboxProcess(
+    const std::string &pid_file) {
   MBLOG_INFO << "open modelbox proccess. ";
 
   std::string cmd_str = "/usr/local/bin/modelbox -c " + modelbox_conig_path_ +
-                        " -fV -p /var/run/modelbox/modelbox.pid &";
+                        " -fV -p " + pid_file + " &";
 
   if (system(cmd_str.c_str())) {
     MBLOG_INFO << " execute cmd failed, cmd_str: " << cmd_str;
     return modelbox::STATUS_FAULT;
   }
-
-  MBLOG_INFO << "mock server start success.";
   return modelbox::STATUS_OK;
 }
 
@@ -38,6 +38,8 @@ class TestCaseBase : public testing::Test {
 
   virtual void TearDown() { StopMockServer(); };
 
+  modelbox::Status StartModelboxProcess(const std::string &pid_file);
+
  public:
   std::shared_ptr<MaMockServer> ma_server_;
   std::shared_ptr<WebHookMockServer> webhook_server_;
@@ -28,6 +28,14 @@ const std::string MA_MOCK_ENDPOINT = "http://127.0.0.1:7500";
 const std::string WEBHOOK_MOCK_ENDPOINT = "http://127.0.0.1:22360";
 const std::string MA_PLUGIN_CREATE_TASK_URL =
     MA_PLUGIN_MOCK_ENDPOINT + "/v1/tasks";
+const std::string MODELBOX_PID_FILE = "/var/run/modelbox/modelbox.pid";
+const std::string MODELBOX_HANDOVER_PID_FILE =
+    "/var/run/modelbox/modelbox-handover.pid";
+const std::string MA_PLUGIN_READY_URL =
+    MA_PLUGIN_MOCK_ENDPOINT + "/health/ready";
+const std::string MA_PLUGIN_DRAIN_URL =
+    MA_PLUGIN_MOCK_ENDPOINT + "/admin/drain";
+const std::string MA_PLUGIN_METRICS_URL = MA_PLUGIN_MOCK_ENDPOINT + "/metrics";
 const web::json::value MA_PLUGIN_WEBHOOK_OUTPUT = web::json::value::parse(R"({
     "data":{
         "headers":{
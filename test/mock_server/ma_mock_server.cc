@@ -16,6 +16,7 @@
 
 #include "ma_mock_server.h"
 
+#include "compress.h"
 #include "modelbox/base/log.h"
 #include "modelbox/base/uuid.h"
 #include "test_case_utils.h"
@@ -55,14 +56,39 @@ void MaMockServer::Stop() {
 }
 
 modelbox::Status MaMockServer::HandleFunc(web::http::http_request request) {
-  if (custom_handle_ == nullptr ||
-      custom_handle_(request) == modelbox::STATUS_NOTFOUND) {
+  if (custom_handle_ != nullptr &&
+      custom_handle_(request) != modelbox::STATUS_NOTFOUND) {
+    return modelbox::STATUS_OK;
+  }
+
+  auto& headers = request.headers();
+  auto encoding = headers.find("Content-Encoding");
+  if (encoding == headers.end() || encoding->second != "gzip") {
     request.extract_string().then([=](utility::string_t request_body) {
       MBLOG_INFO << "ma mock server get request [" << request.method() << ", "
                  << request.request_uri().to_string() << "]";
+      wire_bytes_ += request_body.size();
+      plain_bytes_ += request_body.size();
       DefaultHandleFunc(request, request_body);
     });
+    return modelbox::STATUS_OK;
   }
+
+  request.extract_vector().then([=](std::vector<unsigned char> request_body) {
+    MBLOG_INFO << "ma mock server get gzip request [" << request.method()
+               << ", " << request.request_uri().to_string() << "]";
+    std::string body;
+    std::string compressed(request_body.begin(), request_body.end());
+    if (modelarts::GzipDecompress(compressed, body) != modelbox::STATUS_OK) {
+      MBLOG_ERROR << "ma mock server decompress request failed.";
+      request.reply(web::http::status_codes::BadRequest);
+      return;
+    }
+    wire_bytes_ += request_body.size();
+    plain_bytes_ += body.size();
+    compressed_count_++;
+    DefaultHandleFunc(request, body);
+  });
   return modelbox::STATUS_OK;
 }
 
@@ -108,6 +134,11 @@ web::http::http_response MaMockServer::HandleInstanceMsg(
   instance_info_[instance_id] = msg_json["data"]["state"];
   std::lock_guard<std::mutex> lock(task_info_mutex_);
   task_info_.clear();
+  if (msg_json["data"].contains("recovery")) {
+    for (auto& task_id : msg_json["data"]["recovery"]["recovered"]) {
+      recovered_tasks_.insert(task_id.get<std::string>());
+    }
+  }
   for (auto& task : msg_json["data"]["tasks"]) {
     task_info_[task["id"]] = task["state"];
     MBLOG_INFO << "get instance " << instance_id << " state "
@@ -188,6 +219,78 @@ modelbox::Status MaMockServer::DeleteTask(const std::string& task_id) {
   return modelbox::STATUS_OK;
 }
 
+modelbox::Status MaMockServer::DeleteAllTask(std::string& resp) {
+  web::http::http_request request;
+  request.set_method(web::http::methods::DEL);
+  request.headers()["Content-Type"] = "application/json";
+  request.headers()["X-Auth-Token"] = "token";
+  auto response = DoRequestUrl(MA_PLUGIN_CREATE_TASK_URL, request);
+
+  resp = response.extract_string().get();
+  if (response.status_code() != web::http::status_codes::Accepted) {
+    MBLOG_ERROR << "delete all ma task failed, httpcode:"
+                << response.status_code() << " , response: " << resp;
+    return modelbox::STATUS_FAULT;
+  }
+  return modelbox::STATUS_OK;
+}
+
+modelbox::Status MaMockServer::Drain(bool enable) {
+  web::json::value request_body;
+  request_body["enable"] = web::json::value::boolean(enable);
+  web::http::http_request request;
+  request.set_method(web::http::methods::POST);
+  request.set_body(request_body);
+  request.headers()["Content-Type"] = "application/json";
+  request.headers()["X-Auth-Token"] = "token";
+  auto response = DoRequestUrl(MA_PLUGIN_DRAIN_URL, request);
+
+  auto expect = enable ? web::http::status_codes::Accepted
+                       : web::http::status_codes::OK;
+  if (response.status_code() != expect) {
+    MBLOG_ERROR << "drain instance failed, httpcode:" << response.status_code()
+                << " , response: " << response.extract_string().get();
+    return modelbox::STATUS_FAULT;
+  }
+  return modelbox::STATUS_OK;
+}
+
+int MaMockServer::GetReadyStatus() {
+  web::http::http_request request;
+  request.set_method(web::http::methods::GET);
+  auto response = DoRequestUrl(MA_PLUGIN_READY_URL, request);
+  return response.status_code();
+}
+
+int MaMockServer::GetMetrics(std::string& metrics) {
+  web::http::http_request request;
+  request.set_method(web::http::methods::GET);
+  auto response = DoRequestUrl(MA_PLUGIN_METRICS_URL, request);
+  metrics = response.extract_string().get();
+  return response.status_code();
+}
+
+int MaMockServer::QueryTask(const std::string& task_id) {
+  std::string detail;
+  return QueryTask(task_id, detail);
+}
+
+int MaMockServer::QueryTask(const std::string& task_id, std::string& detail) {
+  web::http::http_request request;
+  request.set_method(web::http::methods::GET);
+  request.headers()["Content-Type"] = "application/json";
+  request.headers()["X-Auth-Token"] = "token";
+  try {
+    auto response =
+        DoRequestUrl(MA_PLUGIN_CREATE_TASK_URL + "/" + task_id, request);
+    detail = response.extract_string().get();
+    return response.status_code();
+  } catch (const std::exception& e) {
+    MBLOG_ERROR << "query ma task failed, error: " << e.what();
+    return 0;
+  }
+}
+
 modelbox::Status MaMockServer::GenCreateMaPluginTaskMsg(
     const std::string& task_id, const std::string& msg,
     web::json::value& request_body) {
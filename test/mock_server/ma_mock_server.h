@@ -20,10 +20,12 @@
 #include <cpprest/http_listener.h>
 #include <cpprest/http_msg.h>
 
+#include <atomic>
 #include <iostream>
 #include <map>
 #include <nlohmann/json.hpp>
 #include <string>
+#include <unordered_set>
 
 #include "modelbox/base/log.h"
 #include "modelbox/base/status.h"
@@ -44,6 +46,17 @@ class MaMockServer {
 
   modelbox::Status DeleteTask(const std::string &task_id);
 
+  modelbox::Status DeleteAllTask(std::string &resp);
+
+  modelbox::Status Drain(bool enable);
+
+  int GetReadyStatus();
+
+  int GetMetrics(std::string &metrics);
+
+  int QueryTask(const std::string &task_id);
+  int QueryTask(const std::string &task_id, std::string &detail);
+
   modelbox::Status RegisterCustomHandle(RequestHandler callback);
 
   std::string GetInstanceState(const std::string &instance_id) {
@@ -52,6 +65,13 @@ class MaMockServer {
                : instance_info_.find(instance_id)->second;
   };
 
+  uint64_t GetCompressedCount() { return compressed_count_; }
+
+  uint64_t GetWireBytes() { return wire_bytes_; }
+
+  /* request bytes after decompression */
+  uint64_t GetPlainBytes() { return plain_bytes_; }
+
   std::string GetTaskState(const std::string task_id) {
     std::lock_guard<std::mutex> lock(task_info_mutex_);
     return task_info_.find(task_id) == task_info_.end()
@@ -59,6 +79,12 @@ class MaMockServer {
                : task_info_.find(task_id)->second;
   }
 
+  /* the task was reported as recovered by a restarted process */
+  bool IsTaskRecovered(const std::string &task_id) {
+    std::lock_guard<std::mutex> lock(task_info_mutex_);
+    return recovered_tasks_.count(task_id) != 0;
+  }
+
  private:
   modelbox::Status HandleFunc(web::http::http_request request);
   void DefaultHandleFunc(web::http::http_request request,
@@ -72,7 +98,11 @@ class MaMockServer {
 
   std::unordered_map<std::string, std::string> instance_info_;
   std::unordered_map<std::string, std::string> task_info_;
+  std::unordered_set<std::string> recovered_tasks_;
   std::mutex task_info_mutex_;
+  std::atomic<uint64_t> compressed_count_{0};
+  std::atomic<uint64_t> wire_bytes_{0};
+  std::atomic<uint64_t> plain_bytes_{0};
   RequestHandler custom_handle_{nullptr};
   std::shared_ptr<web::http::experimental::listener::http_listener> listener_;
 };
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sched.h>
+#include <stdlib.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpu_affinity.h"
+#include "gtest/gtest.h"
+
+using modelarts::CpuAffinity;
+using modelarts::ParseCpuList;
+
+static std::vector<int> GetAffinity() {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  sched_getaffinity(0, sizeof(set), &set);
+  std::vector<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &set)) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+static void SetAffinity(const std::vector<int> &cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  sched_setaffinity(0, sizeof(set), &set);
+}
+
+static std::string ToCpuList(const std::vector<int> &cpus) {
+  std::string str;
+  for (auto cpu : cpus) {
+    str += (str.empty() ? "" : ",") + std::to_string(cpu);
+  }
+  return str;
+}
+
+TEST(CpuAffinity, TestCase_parse_cpu_list) {
+  std::vector<int> cpus = {7};
+  EXPECT_EQ(ParseCpuList("", cpus), modelbox::STATUS_OK);
+  EXPECT_TRUE(cpus.empty());
+  EXPECT_EQ(ParseCpuList("0-3,8,10-11", cpus), modelbox::STATUS_OK);
+  EXPECT_EQ(cpus, std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+
+  // blanks and empty items are skipped, the result is sorted and unique
+  EXPECT_EQ(ParseCpuList(" 5 , 1 - 2,,2-3 ,", cpus), modelbox::STATUS_OK);
+  EXPECT_EQ(cpus, std::vector<int>({1, 2, 3, 5}));
+  EXPECT_EQ(ParseCpuList("1023", cpus), modelbox::STATUS_OK);
+  EXPECT_EQ(cpus, std::vector<int>({1023}));
+
+  EXPECT_EQ(ParseCpuList("a", cpus), modelbox::STATUS_INVALID);
+  EXPECT_EQ(ParseCpuList("-1", cpus), modelbox::STATUS_INVALID);
+  EXPECT_EQ(ParseCpuList("1-", cpus), modelbox::STATUS_INVALID);
+  EXPECT_EQ(ParseCpuList("3-1", cpus), modelbox::STATUS_INVALID);
+  EXPECT_EQ(ParseCpuList("0,1024", cpus), modelbox::STATUS_INVALID);
+  EXPECT_EQ(ParseCpuList("99999999999", cpus), modelbox::STATUS_INVALID);
+};
+
+TEST(CpuAffinity, TestCase_bind_threads) {
+  setenv("MODELARTS_SVC_CONFIG", R"({"instance_id": "MOCK_INSTANCE_ID"})",
+         true);
+  auto config = std::make_shared<modelarts::Config>();
+  ASSERT_EQ(config->LoadConfig(), modelbox::STATUS_OK);
+  auto affinity = std::make_shared<CpuAffinity>();
+
+  config->SetProperty(modelarts::CONFIG_AFFINITY_TASK_CPUS, "0-x");
+  EXPECT_EQ(affinity->Init(config), modelbox::STATUS_INVALID);
+
+  // an empty cpu list leaves the threads where they are
+  auto allowed = GetAffinity();
+  ASSERT_FALSE(allowed.empty());
+  config->SetProperty(modelarts::CONFIG_AFFINITY_TASK_CPUS, "");
+  EXPECT_EQ(affinity->Init(config), modelbox::STATUS_OK);
+  affinity->BindPipeline(0);
+  EXPECT_EQ(GetAffinity(), allowed);
+
+  config->SetProperty(modelarts::CONFIG_AFFINITY_CONTROL_CPUS,
+                      std::to_string(allowed.back()));
+  config->SetProperty(modelarts::CONFIG_AFFINITY_TASK_CPUS,
+                      ToCpuList(allowed));
+  config->SetProperty(modelarts::CONFIG_AFFINITY_GROUP_SIZE, "1");
+  EXPECT_EQ(affinity->Init(config), modelbox::STATUS_OK);
+
+  std::vector<int> control_cpus;
+  std::thread control([&]() {
+    affinity->BindControlThread("control_test");
+    control_cpus = GetAffinity();
+  });
+  control.join();
+  EXPECT_EQ(control_cpus, std::vector<int>({allowed.back()}));
+
+  // a worker is pinned to one group, groups wrap around
+  for (int group = 0; group <= (int)allowed.size(); ++group) {
+    affinity->BindPipeline(group);
+    EXPECT_EQ(GetAffinity(),
+              std::vector<int>({allowed[group % allowed.size()]}));
+  }
+  affinity->BindPipeline();
+  EXPECT_EQ(GetAffinity(), allowed);
+
+  affinity->BindControlThread("main_test");
+  auto threads = affinity->SampleThreadUsage();
+  bool found = false;
+  for (auto &thread : threads) {
+    if (thread["name"] == "main_test") {
+      found = true;
+      EXPECT_EQ(thread["role"], "control");
+    } else {
+      EXPECT_EQ(thread["role"], "pipeline");
+    }
+  }
+  EXPECT_TRUE(found);
+  SetAffinity(allowed);
+};
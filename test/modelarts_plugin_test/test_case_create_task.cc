@@ -16,6 +16,11 @@
 
 #include "test_case_create_task.h"
 
+#include <signal.h>
+
+#include <fstream>
+#include <thread>
+
 void CreateSingleTask::InitWebhookResult() {
   *webhook_count_ = 0;
   return;
@@ -302,6 +307,37 @@ TEST_F(CreateSingleTask, TestCase_obs_obs) {
   EXPECT_EQ(ma_server_->GetTaskState(task_id), get_state);
 };
 
+TEST_F(CreateSingleTask, TestCase_obs_prefix_batch) {
+  const uint32_t timeout_ms = 100000;
+  std::string get_state = "RUNNING";
+  WaitInstanceState(get_state, timeout_ms);
+  EXPECT_EQ(ma_server_->GetInstanceState("MOCK_INSTANCE_ID"), get_state);
+
+  auto input = MA_PLUGIN_OBS_INPUT;
+  input["data"]["path"] = web::json::value::string("input/");
+  auto request_body = GenCreateTaskMsg();
+  request_body["input"] = input;
+  request_body["outputs"][0] = MA_PLUGIN_OBS_OUTPUT;
+
+  std::string task_id;
+  auto ret = ma_server_->CreateTask(request_body.serialize(), task_id);
+  EXPECT_EQ(ret, modelbox::STATUS_OK);
+
+  // the mock bucket cannot be listed, the batch has to fail, not hang
+  std::string state;
+  uint32_t time_count_ms = 0;
+  while (time_count_ms <= timeout_ms && state != "FAILED") {
+    std::string resp;
+    if (ma_server_->QueryTask(task_id, resp) == web::http::status_codes::OK) {
+      state = nlohmann::json::parse(resp)["state"].get<std::string>();
+    }
+    usleep(200 * 1000);
+    time_count_ms += 200;
+  }
+  EXPECT_EQ(state, "FAILED");
+  EXPECT_EQ(ma_server_->GetInstanceState("MOCK_INSTANCE_ID"), get_state);
+};
+
 TEST_F(CreateSingleTask, TestCase_vis_dis) {
   const uint32_t timeout_ms = 100000;
   std::string get_state = "RUNNING";
@@ -357,4 +393,222 @@ TEST_F(CreateSingleTask, TestCase_edgecamera_dis_obs) {
   get_state = "NOT_FOUND";
   WaitTaskState(task_id, get_state, timeout_ms);
   EXPECT_EQ(ma_server_->GetTaskState(task_id), get_state);
-};
\ No newline at end of file
+};
+
+TEST_F(CreateSingleTask, TestCase_compressed_instance_info) {
+  const uint32_t timeout_ms = 100000;
+  std::string get_state = "RUNNING";
+  WaitInstanceState(get_state, timeout_ms);
+  EXPECT_EQ(ma_server_->GetInstanceState("MOCK_INSTANCE_ID"), get_state);
+
+  std::vector<std::string> taskid_list(10);
+  for (size_t i = 0; i < taskid_list.size(); i++) {
+    auto request_body = GenCreateTaskRequestBody(true);
+    auto ret = ma_server_->CreateTask(request_body.serialize(), taskid_list[i]);
+    EXPECT_EQ(ret, modelbox::STATUS_OK);
+  }
+
+  for (size_t i = 0; i < taskid_list.size(); i++) {
+    get_state = "RUNNING";
+    WaitTaskState(taskid_list[i], get_state, timeout_ms);
+    EXPECT_EQ(ma_server_->GetTaskState(taskid_list[i]), get_state);
+  }
+
+  EXPECT_GT(ma_server_->GetCompressedCount(), 0);
+  EXPECT_LT(ma_server_->GetWireBytes(), ma_server_->GetPlainBytes());
+
+  for (size_t i = 0; i < taskid_list.size(); i++) {
+    auto ret = ma_server_->DeleteTask(taskid_list[i]);
+    EXPECT_EQ(ret, modelbox::STATUS_OK);
+  }
+
+  for (size_t i = 0; i < taskid_list.size(); i++) {
+    get_state = "NOT_FOUND";
+    WaitTaskState(taskid_list[i], get_state, timeout_ms);
+    EXPECT_EQ(ma_server_->GetTaskState(taskid_list[i]), get_state);
+  }
+};
+
+TEST_F(CreateSingleTask, TestCase_delete_all_task) {
+  const uint32_t timeout_ms = 100000;
+  std::string get_state = "RUNNING";
+  WaitInstanceState(get_state, timeout_ms);
+  EXPECT_EQ(ma_server_->GetInstanceState("MOCK_INSTANCE_ID"), get_state);
+
+  std::vector<std::string> taskid_list(3);
+  for (size_t i = 0; i < taskid_list.size(); i++) {
+    auto request_body = GenCreateTaskRequestBody(true);
+    auto ret = ma_server_->CreateTask(request_body.serialize(), taskid_list[i]);
+    EXPECT_EQ(ret, modelbox::STATUS_OK);
+  }
+
+  for (size_t i = 0; i < taskid_list.size(); i++) {
+    get_state = "RUNNING";
+    WaitTaskState(taskid_list[i], get_state, timeout_ms);
+    EXPECT_EQ(ma_server_->GetTaskState(taskid_list[i]), get_state);
+  }
+
+  std::string resp;
+  auto ret = ma_server_->DeleteAllTask(resp);
+  EXPECT_EQ(ret, modelbox::STATUS_OK);
+  auto summary = nlohmann::json::parse(resp);
+  EXPECT_EQ(summary["total"].get<size_t>(), taskid_list.size());
+
+  for (size_t i = 0; i < taskid_list.size(); i++) {
+    get_state = "NOT_FOUND";
+    WaitTaskState(taskid_list[i], get_state, timeout_ms);
+    EXPECT_EQ(ma_server_->GetTaskState(taskid_list[i]), get_state);
+  }
+};
+
+TEST_F(CreateSingleTask, TestCase_drain_instance) {
+  const uint32_t timeout_ms = 100000;
+  std::string get_state = "RUNNING";
+  WaitInstanceState(get_state, timeout_ms);
+  EXPECT_EQ(ma_server_->GetReadyStatus(), web::http::status_codes::OK);
+
+  auto ret = ma_server_->Drain(true);
+  EXPECT_EQ(ret, modelbox::STATUS_OK);
+  EXPECT_EQ(ma_server_->GetReadyStatus(),
+            web::http::status_codes::ServiceUnavailable);
+  get_state = "DRAINING";
+  WaitInstanceState(get_state, timeout_ms);
+  EXPECT_EQ(ma_server_->GetInstanceState("MOCK_INSTANCE_ID"), get_state);
+
+  std::string taskid;
+  auto request_body = GenCreateTaskRequestBody(true);
+  ret = ma_server_->CreateTask(request_body.serialize(), taskid);
+  EXPECT_EQ(ret, modelbox::STATUS_FAULT);
+
+  ret = ma_server_->Drain(false);
+  EXPECT_EQ(ret, modelbox::STATUS_OK);
+  EXPECT_EQ(ma_server_->GetReadyStatus(), web::http::status_codes::OK);
+};
+
+TEST_F(CreateSingleTask, TestCase_metrics_endpoint) {
+  const uint32_t timeout_ms = 100000;
+  std::string get_state = "RUNNING";
+  WaitInstanceState(get_state, timeout_ms);
+
+  std::string resp;
+  EXPECT_EQ(ma_server_->GetMetrics(resp), web::http::status_codes::OK);
+  auto metrics = nlohmann::json::parse(resp);
+  EXPECT_TRUE(metrics.contains("executor"));
+  EXPECT_TRUE(metrics.contains("task_executor"));
+  EXPECT_TRUE(metrics.contains("task_latency"));
+  EXPECT_TRUE(metrics["threads"].is_array());
+};
+
+TEST_F(CreateSingleTask, TestCase_task_lifecycle_timestamps) {
+  const uint32_t timeout_ms = 100000;
+  std::string get_state = "RUNNING";
+  WaitInstanceState(get_state, timeout_ms);
+
+  std::string taskid;
+  auto request_body = GenCreateTaskRequestBody(true);
+  auto ret = ma_server_->CreateTask(request_body.serialize(), taskid);
+  EXPECT_EQ(ret, modelbox::STATUS_OK);
+  WaitTaskState(taskid, get_state, timeout_ms);
+  EXPECT_EQ(ma_server_->GetTaskState(taskid), get_state);
+
+  std::string resp;
+  EXPECT_EQ(ma_server_->QueryTask(taskid, resp), web::http::status_codes::OK);
+  auto detail = nlohmann::json::parse(resp);
+  EXPECT_EQ(detail["state"], "RUNNING");
+  auto timestamps = detail["timestamps"];
+  EXPECT_LE(timestamps["accepted"].get<int64_t>(),
+            timestamps["admitted"].get<int64_t>());
+  EXPECT_LE(timestamps["admitted"].get<int64_t>(),
+            timestamps["pipeline_started"].get<int64_t>());
+  EXPECT_FALSE(timestamps.contains("terminal"));
+
+  ret = ma_server_->DeleteTask(taskid);
+  EXPECT_EQ(ret, modelbox::STATUS_OK);
+  get_state = "NOT_FOUND";
+  WaitTaskState(taskid, get_state, timeout_ms);
+  EXPECT_EQ(ma_server_->GetTaskState(taskid), get_state);
+};
+
+TEST_F(CreateSingleTask, TestCase_query_finished_task) {
+  const uint32_t timeout_ms = 100000;
+  std::string get_state = "RUNNING";
+  WaitInstanceState(get_state, timeout_ms);
+
+  std::string taskid;
+  auto request_body = GenCreateTaskRequestBody(true);
+  auto ret = ma_server_->CreateTask(request_body.serialize(), taskid);
+  EXPECT_EQ(ret, modelbox::STATUS_OK);
+  WaitTaskState(taskid, get_state, timeout_ms);
+
+  ret = ma_server_->DeleteTask(taskid);
+  EXPECT_EQ(ret, modelbox::STATUS_OK);
+  get_state = "NOT_FOUND";
+  WaitTaskState(taskid, get_state, timeout_ms);
+  EXPECT_EQ(ma_server_->GetTaskState(taskid), get_state);
+
+  std::string resp;
+  EXPECT_EQ(ma_server_->QueryTask(taskid, resp), web::http::status_codes::OK);
+  auto detail = nlohmann::json::parse(resp);
+  EXPECT_EQ(detail["state"], "SUCCEEDED");
+  EXPECT_TRUE(detail["timestamps"].contains("terminal"));
+  EXPECT_EQ(ma_server_->QueryTask("not_exist_task"),
+            web::http::status_codes::NotFound);
+};
+
+TEST_F(CreateSingleTask, TestCase_handover_restart) {
+  const uint32_t timeout_ms = 100000;
+  std::string get_state = "RUNNING";
+  WaitInstanceState(get_state, timeout_ms);
+
+  std::string taskid;
+  auto request_body = GenCreateTaskRequestBody(true);
+  auto ret = ma_server_->CreateTask(request_body.serialize(), taskid);
+  EXPECT_EQ(ret, modelbox::STATUS_OK);
+  WaitTaskState(taskid, get_state, timeout_ms);
+  EXPECT_EQ(ma_server_->GetTaskState(taskid), get_state);
+
+  pid_t old_pid = 0;
+  std::ifstream pid_file(MODELBOX_PID_FILE);
+  pid_file >> old_pid;
+  EXPECT_GT(old_pid, 0);
+
+  std::atomic<bool> running{true};
+  std::atomic<uint32_t> sent{0};
+  std::atomic<uint32_t> failed{0};
+  std::thread client([&]() {
+    while (running) {
+      ++sent;
+      if (ma_server_->QueryTask(taskid) != web::http::status_codes::OK) {
+        ++failed;
+      }
+      usleep(20 * 1000);
+    }
+  });
+
+  ret = StartModelboxProcess(MODELBOX_HANDOVER_PID_FILE);
+  EXPECT_EQ(ret, modelbox::STATUS_OK);
+  // handed over once the old process is gone and the new one reported the
+  // task recovered, then the new one has to answer queries on its own
+  uint32_t time_count_ms = 0;
+  while (time_count_ms <= timeout_ms &&
+         (kill(old_pid, 0) == 0 || !ma_server_->IsTaskRecovered(taskid))) {
+    usleep(200 * 1000);
+    time_count_ms += 200;
+  }
+  const uint32_t queries_after_handover = 20;
+  uint32_t handover_sent = sent;
+  while (time_count_ms <= timeout_ms &&
+         sent < handover_sent + queries_after_handover) {
+    usleep(20 * 1000);
+    time_count_ms += 20;
+  }
+  running = false;
+  client.join();
+
+  EXPECT_TRUE(ma_server_->IsTaskRecovered(taskid));
+  EXPECT_GE(sent, handover_sent + queries_after_handover);
+  EXPECT_NE(kill(old_pid, 0), 0);
+  EXPECT_EQ(failed, 0);
+  WaitTaskState(taskid, get_state, timeout_ms);
+  EXPECT_EQ(ma_server_->GetTaskState(taskid), get_state);
+};
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <mutex>
+#include <vector>
+
+#include "executor.h"
+#include "gtest/gtest.h"
+
+using modelarts::Executor;
+
+static bool WaitCount(std::atomic<int> &count, int expect,
+                      uint32_t timeout_ms) {
+  uint32_t time_count_ms = 0;
+  while (time_count_ms <= timeout_ms && count < expect) {
+    usleep(10 * 1000);
+    time_count_ms += 10;
+  }
+  return count >= expect;
+}
+
+TEST(Executor, TestCase_timer_cascade) {
+  auto executor = std::make_shared<Executor>(2, 1);
+  EXPECT_EQ(executor->Start(), modelbox::STATUS_OK);
+
+  // one delay per wheel level below the max, the last cascades twice
+  const std::vector<int> delays = {5, 100, 300, 4200};
+  std::mutex mutex;
+  std::vector<int> fired;
+  std::vector<int64_t> fire_ms;
+  std::atomic<int> count{0};
+  auto begin = std::chrono::steady_clock::now();
+  for (auto delay : delays) {
+    auto id = executor->Schedule(delay, [&, delay]() {
+      auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::steady_clock::now() - begin)
+                         .count();
+      std::lock_guard<std::mutex> lock(mutex);
+      fired.push_back(delay);
+      fire_ms.push_back(elapsed);
+      count++;
+    });
+    EXPECT_NE(id, modelarts::INVALID_TIMER_ID);
+  }
+  auto canceled = executor->Schedule(150, [&]() { count += 100; });
+  EXPECT_TRUE(executor->Cancel(canceled));
+  EXPECT_FALSE(executor->Cancel(canceled));
+  EXPECT_EQ(executor->GetMetrics().pending_timers, delays.size());
+
+  EXPECT_TRUE(WaitCount(count, delays.size(), 10000));
+  usleep(100 * 1000);
+  EXPECT_EQ(count, delays.size());
+  std::lock_guard<std::mutex> lock(mutex);
+  EXPECT_EQ(fired, delays);
+  for (size_t i = 0; i < fire_ms.size(); ++i) {
+    EXPECT_GE(fire_ms[i], fired[i] - 2);
+    EXPECT_LE(fire_ms[i], fired[i] + 500);
+  }
+  EXPECT_EQ(executor->GetMetrics().pending_timers, 0);
+  executor->Stop();
+};
+
+TEST(Executor, TestCase_timer_clamp) {
+  auto executor = std::make_shared<Executor>(1, 10);
+  EXPECT_EQ(executor->Start(), modelbox::STATUS_OK);
+
+  // beyond the wheel span the timer is kept at the last slot
+  std::atomic<int> count{0};
+  auto far = executor->Schedule(INT_MAX, [&]() { count += 100; });
+  EXPECT_NE(far, modelarts::INVALID_TIMER_ID);
+
+  // a negative or zero delay still waits for the next tick
+  executor->Schedule(-5, [&]() { count++; });
+  executor->Schedule(0, [&]() { count++; });
+  EXPECT_TRUE(WaitCount(count, 2, 2000));
+  EXPECT_EQ(count, 2);
+  EXPECT_EQ(executor->GetMetrics().pending_timers, 1);
+  EXPECT_TRUE(executor->Cancel(far));
+  EXPECT_EQ(executor->GetMetrics().pending_timers, 0);
+
+  executor->Stop();
+  EXPECT_EQ(executor->Schedule(10, [&]() { count++; }),
+            modelarts::INVALID_TIMER_ID);
+  EXPECT_FALSE(executor->Submit([&]() { count++; }));
+};
+
+TEST(Executor, TestCase_own_queue_lifo) {
+  auto executor = std::make_shared<Executor>(1, 10);
+  EXPECT_EQ(executor->Start(), modelbox::STATUS_OK);
+
+  std::mutex mutex;
+  std::vector<int> order;
+  std::atomic<int> count{0};
+  executor->Submit([&]() {
+    for (int i = 1; i <= 4; ++i) {
+      executor->Submit([&, i]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(i);
+        count++;
+      });
+    }
+  });
+
+  EXPECT_TRUE(WaitCount(count, 4, 2000));
+  std::lock_guard<std::mutex> lock(mutex);
+  EXPECT_EQ(order, std::vector<int>({4, 3, 2, 1}));
+  executor->Stop();
+};
+
+TEST(Executor, TestCase_steal_fifo) {
+  auto executor = std::make_shared<Executor>(2, 10);
+  EXPECT_EQ(executor->Start(), modelbox::STATUS_OK);
+
+  // the submitting worker stays busy, the idle one steals from the front
+  std::mutex mutex;
+  std::vector<int> order;
+  std::atomic<int> count{0};
+  executor->Submit([&]() {
+    for (int i = 1; i <= 4; ++i) {
+      executor->Submit([&, i]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(i);
+        count++;
+      });
+    }
+    WaitCount(count, 4, 2000);
+  });
+
+  EXPECT_TRUE(WaitCount(count, 4, 3000));
+  std::lock_guard<std::mutex> lock(mutex);
+  EXPECT_EQ(order, std::vector<int>({1, 2, 3, 4}));
+  EXPECT_GE(executor->GetMetrics().stolen, 4);
+  executor->Stop();
+};
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "obs_checkpoint.h"
+#include "obs_object_source.h"
+#include "obs_prefetcher.h"
+#include "task_io.h"
+#include "test_config.h"
+
+using modelartsplugin::ObsCheckpoint;
+using modelartsplugin::ObsManifestReader;
+using modelartsplugin::ObsObject;
+using modelartsplugin::ObsPrefetcher;
+
+static modelbox::Status ParseManifestLine(const std::string &line,
+                                          std::string &key) {
+  ObsObject object;
+  auto status = ObsManifestReader::ParseLine(line, object);
+  key = object.key;
+  return status;
+}
+
+static size_t CountLines(const std::string &path) {
+  std::ifstream file(path);
+  std::string line;
+  size_t count = 0;
+  while (std::getline(file, line)) {
+    count++;
+  }
+  return count;
+}
+
+TEST(ObsBatch, TestCase_manifest_parse_line) {
+  std::string key;
+  EXPECT_EQ(ParseManifestLine("  input/a.jpg \r", key), modelbox::STATUS_OK);
+  EXPECT_EQ(key, "input/a.jpg");
+  EXPECT_EQ(ParseManifestLine(R"({"key": "input/b.jpg"})", key),
+            modelbox::STATUS_OK);
+  EXPECT_EQ(key, "input/b.jpg");
+
+  EXPECT_EQ(ParseManifestLine("", key), modelbox::STATUS_OK);
+  EXPECT_TRUE(key.empty());
+  EXPECT_EQ(ParseManifestLine(" \t", key), modelbox::STATUS_OK);
+  EXPECT_TRUE(key.empty());
+  EXPECT_EQ(ParseManifestLine("  # input/c.jpg", key), modelbox::STATUS_OK);
+  EXPECT_TRUE(key.empty());
+
+  EXPECT_EQ(ParseManifestLine(R"({"key": "c.jpg", "range": [0, 9]})", key),
+            modelbox::STATUS_NOTSUPPORT);
+  EXPECT_EQ(ParseManifestLine(R"({"key": "c.jpg", "config": {}})", key),
+            modelbox::STATUS_NOTSUPPORT);
+
+  EXPECT_EQ(ParseManifestLine(R"({"name": "d.jpg"})", key),
+            modelbox::STATUS_BADCONF);
+  EXPECT_EQ(ParseManifestLine(R"({"key": ""})", key),
+            modelbox::STATUS_BADCONF);
+  EXPECT_EQ(ParseManifestLine(R"({"key": 1})", key), modelbox::STATUS_BADCONF);
+  EXPECT_EQ(ParseManifestLine(R"({"key": "e.jpg")", key),
+            modelbox::STATUS_BADCONF);
+};
+
+TEST(ObsBatch, TestCase_obs_filter) {
+  modelarts::ObsFilter filter;
+  EXPECT_TRUE(filter.MatchKey("a/b.txt"));
+  EXPECT_TRUE(filter.MatchSize(0));
+  EXPECT_FALSE(filter.HasSizeLimit());
+
+  filter.suffixes = {".jpg", ".png"};
+  EXPECT_TRUE(filter.MatchKey("a/b.jpg"));
+  EXPECT_TRUE(filter.MatchKey("a/b.PNG"));
+  EXPECT_FALSE(filter.MatchKey("a/b.jpeg"));
+  EXPECT_FALSE(filter.MatchKey("jpg"));
+
+  filter.pattern = "cam1/*";
+  EXPECT_TRUE(filter.MatchKey("cam1/b.jpg"));
+  EXPECT_TRUE(filter.MatchKey("cam1/day/b.jpg"));
+  EXPECT_FALSE(filter.MatchKey("cam2/b.jpg"));
+  EXPECT_FALSE(filter.MatchKey("cam1/b.txt"));
+
+  filter.min_size = 10;
+  EXPECT_TRUE(filter.HasSizeLimit());
+  EXPECT_FALSE(filter.MatchSize(9));
+  EXPECT_TRUE(filter.MatchSize(10));
+  EXPECT_TRUE(filter.MatchSize(1 << 30));
+
+  filter.max_size = 100;
+  EXPECT_TRUE(filter.MatchSize(100));
+  EXPECT_FALSE(filter.MatchSize(101));
+};
+
+TEST(ObsBatch, TestCase_checkpoint) {
+  auto path = std::string(TEST_WORKING_DIR) + "/obs_checkpoint_test";
+  remove(path.c_str());
+
+  {
+    ObsCheckpoint checkpoint(path, "input_a", 0);
+    EXPECT_EQ(checkpoint.Load(), modelbox::STATUS_OK);
+    EXPECT_EQ(checkpoint.GetDoneNum(), 0);
+    checkpoint.MarkDone({"a.jpg", "b.jpg", "a.jpg"});
+    EXPECT_EQ(checkpoint.GetDoneNum(), 2);
+    EXPECT_EQ(CountLines(path), 3);
+  }
+
+  {
+    // marks within the interval are written on flush
+    ObsCheckpoint checkpoint(path, "input_a", 60000);
+    EXPECT_EQ(checkpoint.Load(), modelbox::STATUS_OK);
+    EXPECT_TRUE(checkpoint.IsDone("a.jpg"));
+    EXPECT_TRUE(checkpoint.IsDone("b.jpg"));
+    EXPECT_FALSE(checkpoint.IsDone("c.jpg"));
+    checkpoint.MarkDone({"c.jpg"});
+    EXPECT_EQ(CountLines(path), 3);
+    checkpoint.Flush();
+    EXPECT_EQ(CountLines(path), 4);
+  }
+
+  {
+    ObsCheckpoint checkpoint(path, "input_a", 0);
+    EXPECT_EQ(checkpoint.Load(), modelbox::STATUS_OK);
+    EXPECT_EQ(checkpoint.GetDoneNum(), 3);
+    checkpoint.Remove();
+    EXPECT_NE(access(path.c_str(), F_OK), 0);
+    checkpoint.MarkDone({"d.jpg"});
+    EXPECT_NE(access(path.c_str(), F_OK), 0);
+  }
+
+  {
+    ObsCheckpoint checkpoint(path, "input_a", 0);
+    checkpoint.MarkDone({"a.jpg"});
+  }
+  {
+    ObsCheckpoint checkpoint(path, "input_b", 0);
+    EXPECT_EQ(checkpoint.Load(), modelbox::STATUS_OK);
+    EXPECT_EQ(checkpoint.GetDoneNum(), 0);
+    EXPECT_NE(access(path.c_str(), F_OK), 0);
+    checkpoint.MarkDone({"e.jpg"});
+  }
+
+  std::ifstream file(path);
+  std::string line;
+  std::getline(file, line);
+  EXPECT_EQ(line, "input_b");
+  std::getline(file, line);
+  EXPECT_EQ(line, "e.jpg");
+  remove(path.c_str());
+};
+
+TEST(ObsBatch, TestCase_prefetch_depth) {
+  modelbox::ObsOptions opt;
+  ObsPrefetcher prefetcher(opt, std::string(TEST_WORKING_DIR), 1 << 20, 3);
+  EXPECT_EQ(prefetcher.GetDepth(), 1);
+
+  // every object not ready in time deepens the prefetch, up to the max
+  std::string local_path;
+  prefetcher.Request({"a.jpg", "b.jpg", "c.jpg", "d.jpg"});
+  EXPECT_FALSE(prefetcher.Take("a.jpg", local_path));
+  EXPECT_EQ(prefetcher.GetDepth(), 2);
+  EXPECT_FALSE(prefetcher.Take("b.jpg", local_path));
+  EXPECT_EQ(prefetcher.GetDepth(), 3);
+  EXPECT_FALSE(prefetcher.Take("c.jpg", local_path));
+  EXPECT_EQ(prefetcher.GetDepth(), 3);
+  EXPECT_TRUE(local_path.empty());
+
+  ObsPrefetcher single(opt, std::string(TEST_WORKING_DIR), 1 << 20, 0);
+  EXPECT_FALSE(single.Take("a.jpg", local_path));
+  EXPECT_EQ(single.GetDepth(), 1);
+};
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "task_journal.h"
+#include "test_config.h"
+
+using modelarts::JournalTask;
+using modelarts::TaskJournal;
+
+static size_t CountLines(const std::string &path) {
+  std::ifstream file(path);
+  std::string line;
+  size_t count = 0;
+  while (std::getline(file, line)) {
+    count++;
+  }
+  return count;
+}
+
+static std::vector<JournalTask> OpenJournal(const std::string &path) {
+  TaskJournal journal(path, 100);
+  std::vector<JournalTask> tasks;
+  EXPECT_EQ(journal.Open(tasks), modelbox::STATUS_OK);
+  return tasks;
+}
+
+TEST(TaskJournal, TestCase_replay) {
+  auto path = std::string(TEST_WORKING_DIR) + "/task_journal_test";
+  remove(path.c_str());
+
+  {
+    TaskJournal journal(path, 100);
+    std::vector<JournalTask> tasks;
+    EXPECT_EQ(journal.Open(tasks), modelbox::STATUS_OK);
+    EXPECT_TRUE(tasks.empty());
+
+    journal.AppendSpec("task_1", "spec_1");
+    journal.AppendSpec("task_2", "spec_2");
+    journal.AppendSpec("task_3", "spec_3");
+    journal.AppendSpec("task_4", "spec_4");
+    journal.AppendState("task_1", 2);
+    journal.AppendCancel("task_2");
+    journal.AppendDrain("task_3");
+    journal.AppendState("task_4", 2);
+    journal.AppendDrain("task_4");
+    journal.AppendState("task_4", 3);
+    journal.AppendRemove("task_1");
+    // records of unknown tasks are ignored
+    journal.AppendState("task_5", 2);
+    EXPECT_EQ(CountLines(path), 12);
+  }
+
+  // a crash can leave the last record half written
+  {
+    std::ofstream file(path, std::ios::app);
+    file << R"({"op":"spec","id":"task_6","sp)";
+  }
+
+  auto tasks = OpenJournal(path);
+  ASSERT_EQ(tasks.size(), 3);
+  EXPECT_EQ(tasks[0].task_id, "task_2");
+  EXPECT_EQ(tasks[0].spec, "spec_2");
+  EXPECT_EQ(tasks[0].status, 0);
+  EXPECT_TRUE(tasks[0].cancelled);
+  EXPECT_FALSE(tasks[0].drained);
+  EXPECT_EQ(tasks[1].task_id, "task_3");
+  EXPECT_FALSE(tasks[1].cancelled);
+  EXPECT_TRUE(tasks[1].drained);
+  // a state change after a drain means the task was resumed
+  EXPECT_EQ(tasks[2].task_id, "task_4");
+  EXPECT_EQ(tasks[2].status, 3);
+  EXPECT_FALSE(tasks[2].drained);
+
+  // open compacts to one spec and state per task plus its flags
+  EXPECT_EQ(CountLines(path), 8);
+  remove(path.c_str());
+};
+
+TEST(TaskJournal, TestCase_compact) {
+  auto path = std::string(TEST_WORKING_DIR) + "/task_journal_test";
+  remove(path.c_str());
+
+  {
+    TaskJournal journal(path, 4);
+    std::vector<JournalTask> tasks;
+    EXPECT_EQ(journal.Open(tasks), modelbox::STATUS_OK);
+    journal.AppendSpec("task_1", "spec_1");
+    for (int i = 0; i < 10; ++i) {
+      auto task_id = "task_tmp_" + std::to_string(i);
+      journal.AppendSpec(task_id, "spec");
+      journal.AppendState(task_id, 1);
+      journal.AppendRemove(task_id);
+      EXPECT_LE(CountLines(path), 7);
+    }
+    journal.AppendState("task_1", 1);
+    journal.Close();
+    // nothing is written after close
+    journal.AppendRemove("task_1");
+  }
+  EXPECT_EQ(access((path + ".tmp").c_str(), F_OK), -1);
+
+  auto tasks = OpenJournal(path);
+  ASSERT_EQ(tasks.size(), 1);
+  EXPECT_EQ(tasks[0].task_id, "task_1");
+  EXPECT_EQ(tasks[0].spec, "spec_1");
+  EXPECT_EQ(tasks[0].status, 1);
+  EXPECT_EQ(CountLines(path), 2);
+  remove(path.c_str());
+};
@@ -0,0 +1,353 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <vector>
+
+#include "communication.h"
+#include "config.h"
+#include "executor.h"
+#include "gtest/gtest.h"
+#include "task_manager.h"
+#include "task_registry.h"
+
+/* records the messages sent to ModelArts, every send succeeds */
+class RecordCommunication : public modelarts::Communication {
+ public:
+  RecordCommunication()
+      : Communication(nullptr, nullptr),
+        begin_(std::chrono::steady_clock::now()) {}
+  ~RecordCommunication() override = default;
+
+  modelbox::Status Init() override { return modelbox::STATUS_OK; }
+  modelbox::Status Start() override { return modelbox::STATUS_OK; }
+  modelbox::Status Stop() override { return modelbox::STATUS_OK; }
+  modelbox::Status SendMsg(const std::string &msg) override {
+    auto j = nlohmann::json::parse(msg);
+    std::lock_guard<std::mutex> lock(mutex_);
+    msgs_.push_back({j.value("business", ""), NowMs(), j["data"]});
+    return modelbox::STATUS_OK;
+  }
+
+  int64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - begin_)
+        .count();
+  }
+
+  std::vector<int64_t> GetSendMs(const std::string &business) {
+    std::vector<int64_t> send_ms;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &msg : msgs_) {
+      if (msg.business == business) {
+        send_ms.push_back(msg.send_ms);
+      }
+    }
+    return send_ms;
+  }
+
+  /* states of the task messages of task_id, in send order */
+  std::vector<std::string> GetTaskStates(const std::string &task_id) {
+    std::vector<std::string> states;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &msg : msgs_) {
+      if (msg.business == "task" && msg.data["id"] == task_id) {
+        states.push_back(msg.data["state"].get<std::string>());
+      }
+    }
+    return states;
+  }
+
+  bool WaitSendNum(const std::string &business, size_t num,
+                   uint32_t timeout_ms) {
+    uint32_t time_count_ms = 0;
+    while (time_count_ms <= timeout_ms && GetSendMs(business).size() < num) {
+      usleep(10 * 1000);
+      time_count_ms += 10;
+    }
+    return GetSendMs(business).size() >= num;
+  }
+
+ private:
+  struct Msg {
+    std::string business;
+    int64_t send_ms;
+    nlohmann::json data;
+  };
+
+  std::chrono::steady_clock::time_point begin_;
+  std::mutex mutex_;
+  std::vector<Msg> msgs_;
+};
+
+class TaskManagerCase : public testing::Test {
+ protected:
+  void StartTaskManager(const std::map<std::string, int> &props) {
+    setenv("MODELARTS_SVC_CONFIG",
+           R"({"instance_id": "MOCK_INSTANCE_ID", "input_count_max": 10,
+               "overload": {"cpu_percent": 101, "mem_percent": 101}})",
+           true);
+    auto config = std::make_shared<modelarts::Config>();
+    ASSERT_EQ(config->LoadConfig(), modelbox::STATUS_OK);
+    for (auto &prop : props) {
+      config->SetProperty(prop.first, std::to_string(prop.second));
+    }
+
+    executor_ = std::make_shared<modelarts::Executor>(2, 10);
+    ASSERT_EQ(executor_->Start(), modelbox::STATUS_OK);
+    task_executor_ = std::make_shared<modelarts::Executor>(2, 10);
+    ASSERT_EQ(task_executor_->Start(), modelbox::STATUS_OK);
+    communication_ = std::make_shared<RecordCommunication>();
+    task_manager_ = std::make_shared<modelarts::TaskManager>(
+        communication_, config, executor_, task_executor_,
+        std::make_shared<modelarts::TaskRegistry>());
+    ASSERT_EQ(task_manager_->Init(), modelbox::STATUS_OK);
+    ASSERT_EQ(task_manager_->Start(), modelbox::STATUS_OK);
+  }
+
+  void TearDown() override {
+    if (task_manager_ != nullptr) {
+      task_manager_->Stop();
+    }
+    if (task_executor_ != nullptr) {
+      task_executor_->Stop();
+    }
+    if (executor_ != nullptr) {
+      executor_->Stop();
+    }
+  }
+
+  std::string GenTaskMsg(const std::string &task_id) {
+    return R"({"id": ")" + task_id + R"(", "config": {},
+        "input": {"type": "url",
+                  "data": {"url": "/tmp/test.mp4", "url_type": "file"}},
+        "outputs": [{"type": "webhook",
+                     "data": {"url": "http://127.0.0.1:7600", "headers": {}}}]
+        })";
+  }
+
+  modelarts::MAHttpStatusCode CreateTask(const std::string &task_id) {
+    std::string resp;
+    std::shared_ptr<void> ptr;
+    auto msg = GenTaskMsg(task_id);
+    auto code = task_manager_->CreateTaskProcess(msg, resp, ptr);
+    task_manager_->CreateTaskPostProcess(msg, resp, ptr);
+    return code;
+  }
+
+  std::string QueryTaskState(const std::string &task_id) {
+    std::string resp;
+    std::shared_ptr<void> ptr;
+    if (task_manager_->QueryTaskProcess(task_id, resp, ptr) !=
+        modelarts::STATUS_HTTP_OK) {
+      return "NOT_FOUND";
+    }
+    return nlohmann::json::parse(resp)["state"].get<std::string>();
+  }
+
+  void WaitTaskState(const std::string &task_id, const std::string &state,
+                     uint32_t timeout_ms) {
+    uint32_t time_count_ms = 0;
+    while (time_count_ms <= timeout_ms && QueryTaskState(task_id) != state) {
+      usleep(10 * 1000);
+      time_count_ms += 10;
+    }
+  }
+
+  std::shared_ptr<modelarts::Executor> executor_;
+  std::shared_ptr<modelarts::Executor> task_executor_;
+  std::shared_ptr<RecordCommunication> communication_;
+  std::shared_ptr<modelarts::TaskManager> task_manager_;
+};
+
+TEST_F(TaskManagerCase, TestCase_heartbeat_backoff) {
+  StartTaskManager({{modelarts::CONFIG_HEARTBEAT_INTERVAL, 1},
+                    {modelarts::CONFIG_HEARTBEAT_MAX_INTERVAL, 2},
+                    {modelarts::CONFIG_HEARTBEAT_JITTER_PERCENT, 0}});
+
+  // an unchanged instance doubles the wait up to the max
+  EXPECT_TRUE(communication_->WaitSendNum("instance", 4, 8000));
+  auto send_ms = communication_->GetSendMs("instance");
+  ASSERT_GE(send_ms.size(), 4);
+  const std::vector<int64_t> expect_gaps = {1000, 2000, 2000};
+  for (size_t i = 0; i < expect_gaps.size(); ++i) {
+    auto gap = send_ms[i + 1] - send_ms[i];
+    EXPECT_GE(gap, expect_gaps[i] - 50);
+    EXPECT_LE(gap, expect_gaps[i] + 300);
+  }
+};
+
+TEST_F(TaskManagerCase, TestCase_heartbeat_debounce) {
+  StartTaskManager({{modelarts::CONFIG_HEARTBEAT_INTERVAL, 10},
+                    {modelarts::CONFIG_HEARTBEAT_DEBOUNCE_MS, 300},
+                    {modelarts::CONFIG_HEARTBEAT_JITTER_PERCENT, 0}});
+  EXPECT_TRUE(communication_->WaitSendNum("instance", 1, 2000));
+  usleep(200 * 1000);
+
+  // a burst of updates is one send after the debounce window
+  auto nudge_ms = communication_->NowMs();
+  for (int i = 0; i < 5; ++i) {
+    task_manager_->SendInstanceInfoToMA();
+  }
+  EXPECT_TRUE(communication_->WaitSendNum("instance", 2, 2000));
+  usleep(1000 * 1000);
+  auto send_ms = communication_->GetSendMs("instance");
+  ASSERT_EQ(send_ms.size(), 2);
+  EXPECT_GE(send_ms[1] - nudge_ms, 300 - 50);
+  EXPECT_LE(send_ms[1] - nudge_ms, 300 + 300);
+};
+
+TEST_F(TaskManagerCase, TestCase_heartbeat_jitter) {
+  StartTaskManager({{modelarts::CONFIG_HEARTBEAT_INTERVAL, 1},
+                    {modelarts::CONFIG_HEARTBEAT_MAX_INTERVAL, 1},
+                    {modelarts::CONFIG_HEARTBEAT_JITTER_PERCENT, 30}});
+
+  EXPECT_TRUE(communication_->WaitSendNum("instance", 6, 10000));
+  auto send_ms = communication_->GetSendMs("instance");
+  ASSERT_GE(send_ms.size(), 6);
+  bool jittered = false;
+  for (size_t i = 1; i < 6; ++i) {
+    auto gap = send_ms[i] - send_ms[i - 1];
+    EXPECT_GE(gap, 700 - 50);
+    EXPECT_LE(gap, 1300 + 300);
+    if (gap < 1000 - 30 || gap > 1000 + 30) {
+      jittered = true;
+    }
+  }
+  EXPECT_TRUE(jittered);
+};
+
+TEST_F(TaskManagerCase, TestCase_create_pending_to_running) {
+  StartTaskManager({});
+  std::atomic<bool> release{false};
+  task_manager_->SetCreateMsgFunc(
+      [&](const std::shared_ptr<modelarts::TaskInfo> task) {
+        while (!release) {
+          usleep(10 * 1000);
+        }
+        return true;
+      });
+
+  // answered before the pipeline starts
+  EXPECT_EQ(CreateTask("task_1"), modelarts::STATUS_HTTP_CREATED);
+  EXPECT_EQ(CreateTask("task_1"), modelarts::STATUS_HTTP_BAD_REQUEST);
+  usleep(100 * 1000);
+  EXPECT_EQ(QueryTaskState("task_1"), "PENDING");
+
+  release = true;
+  WaitTaskState("task_1", "RUNNING", 2000);
+  EXPECT_EQ(QueryTaskState("task_1"), "RUNNING");
+  EXPECT_EQ(communication_->GetTaskStates("task_1"),
+            std::vector<std::string>({"PENDING", "RUNNING"}));
+};
+
+TEST_F(TaskManagerCase, TestCase_create_failed) {
+  StartTaskManager({});
+  task_manager_->SetCreateMsgFunc(
+      [](const std::shared_ptr<modelarts::TaskInfo> task) { return false; });
+
+  EXPECT_EQ(CreateTask("task_1"), modelarts::STATUS_HTTP_CREATED);
+  WaitTaskState("task_1", "FAILED", 2000);
+  std::string resp;
+  std::shared_ptr<void> ptr;
+  EXPECT_EQ(task_manager_->QueryTaskProcess("task_1", resp, ptr),
+            modelarts::STATUS_HTTP_OK);
+  auto detail = nlohmann::json::parse(resp);
+  EXPECT_EQ(detail["state"], "FAILED");
+  EXPECT_EQ(detail["reason"], "create pipeline failed");
+  auto states = communication_->GetTaskStates("task_1");
+  EXPECT_NE(std::find(states.begin(), states.end(), "FAILED"), states.end());
+};
+
+TEST_F(TaskManagerCase, TestCase_delete_stop_deadline) {
+  StartTaskManager({});
+  std::atomic<int> stop_num{0};
+  task_manager_->SetCreateMsgFunc(
+      [](const std::shared_ptr<modelarts::TaskInfo> task) { return true; });
+  task_manager_->SetDeleteMsgFunc([&](const std::string &task_id) {
+    stop_num++;
+    return true;
+  });
+  EXPECT_EQ(CreateTask("task_1"), modelarts::STATUS_HTTP_CREATED);
+  WaitTaskState("task_1", "RUNNING", 2000);
+
+  // accepted at once, a repeated delete does not stop twice
+  std::string resp;
+  std::shared_ptr<void> ptr;
+  EXPECT_EQ(task_manager_->DeleteTaskProcess("task_1", resp, ptr),
+            modelarts::STATUS_HTTP_ACCEPTED);
+  EXPECT_EQ(task_manager_->DeleteTaskProcess("task_1", resp, ptr),
+            modelarts::STATUS_HTTP_ACCEPTED);
+  usleep(200 * 1000);
+  EXPECT_EQ(stop_num, 1);
+  EXPECT_EQ(QueryTaskState("task_1"), "RUNNING");
+
+  // the pipeline missed the stop deadline and was force stopped
+  EXPECT_EQ(task_manager_->UpdateTaskStatus(
+                "task_1", modelarts::TASK_STATUS_FAILED,
+                "stop timeout, pipeline force stopped"),
+            modelbox::STATUS_OK);
+  EXPECT_NE(task_manager_->UpdateTaskStatus("task_1",
+                                            modelarts::TASK_STATUS_SUCCEEDED),
+            modelbox::STATUS_OK);
+  EXPECT_EQ(task_manager_->QueryTaskProcess("task_1", resp, ptr),
+            modelarts::STATUS_HTTP_OK);
+  auto detail = nlohmann::json::parse(resp);
+  EXPECT_EQ(detail["state"], "FAILED");
+  EXPECT_EQ(detail["reason"], "stop timeout, pipeline force stopped");
+  EXPECT_EQ(task_manager_->DeleteTaskProcess("task_1", resp, ptr),
+            modelarts::STATUS_HTTP_NOT_FOUND);
+};
+
+TEST_F(TaskManagerCase, TestCase_delete_while_starting) {
+  StartTaskManager({});
+  std::atomic<bool> release{false};
+  std::atomic<int> stop_num{0};
+  task_manager_->SetCreateMsgFunc(
+      [&](const std::shared_ptr<modelarts::TaskInfo> task) {
+        while (!release) {
+          usleep(10 * 1000);
+        }
+        return true;
+      });
+  task_manager_->SetDeleteMsgFunc([&](const std::string &task_id) {
+    stop_num++;
+    auto status = task_manager_->UpdateTaskStatus(
+        task_id, modelarts::TASK_STATUS_SUCCEEDED);
+    return status == modelbox::STATUS_OK;
+  });
+  EXPECT_EQ(CreateTask("task_1"), modelarts::STATUS_HTTP_CREATED);
+  usleep(100 * 1000);
+
+  // the start in progress stops the task once it is running
+  std::string resp;
+  std::shared_ptr<void> ptr;
+  EXPECT_EQ(task_manager_->DeleteTaskProcess("task_1", resp, ptr),
+            modelarts::STATUS_HTTP_ACCEPTED);
+  EXPECT_EQ(stop_num, 0);
+  release = true;
+  WaitTaskState("task_1", "SUCCEEDED", 2000);
+  EXPECT_EQ(QueryTaskState("task_1"), "SUCCEEDED");
+  EXPECT_EQ(stop_num, 1);
+};
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "task_manager.h"
+#include "task_registry.h"
+
+using modelarts::TaskGroup;
+using modelarts::TaskRecord;
+using modelarts::TaskRegistry;
+
+static std::shared_ptr<TaskGroup> GenTaskGroup() {
+  return std::make_shared<TaskGroup>(std::make_shared<modelarts::TaskInfo>(),
+                                     "MOCK_INSTANCE_ID");
+}
+
+TEST(TaskRegistry, TestCase_dual_index) {
+  TaskRegistry registry(4);
+  auto task_1 = GenTaskGroup();
+  auto task_2 = GenTaskGroup();
+  EXPECT_TRUE(registry.Insert("task_1", task_1));
+  EXPECT_TRUE(registry.Insert("task_2", task_2));
+  EXPECT_FALSE(registry.Insert("task_1", task_2));
+  EXPECT_EQ(registry.Find("task_1"), task_1);
+  EXPECT_EQ(registry.Size(), 2);
+
+  // a batch task runs several modelbox sessions at once
+  EXPECT_TRUE(registry.AddModelboxTask("task_1", "mb_1"));
+  EXPECT_TRUE(registry.AddModelboxTask("task_1", "mb_2"));
+  EXPECT_TRUE(registry.AddModelboxTask("task_2", "mb_3"));
+  EXPECT_FALSE(registry.AddModelboxTask("task_3", "mb_4"));
+
+  auto context = std::make_shared<int>(1);
+  EXPECT_TRUE(registry.SetContext("task_1", context));
+  EXPECT_FALSE(registry.SetContext("task_3", context));
+
+  TaskRecord record;
+  EXPECT_TRUE(registry.GetByModelboxTaskId("mb_2", record));
+  EXPECT_EQ(record.task_group, task_1);
+  EXPECT_EQ(record.context, context);
+  EXPECT_EQ(record.modelbox_task_ids, std::set<std::string>({"mb_1", "mb_2"}));
+  EXPECT_FALSE(registry.GetByModelboxTaskId("mb_4", record));
+
+  EXPECT_TRUE(registry.RemoveModelboxTask("task_1", "mb_1"));
+  EXPECT_FALSE(registry.RemoveModelboxTask("task_1", "mb_1"));
+  EXPECT_FALSE(registry.GetByModelboxTaskId("mb_1", record));
+  EXPECT_TRUE(registry.GetByModelboxTaskId("mb_2", record));
+
+  // erasing a task drops the index of its sessions only
+  EXPECT_TRUE(registry.Erase("task_1"));
+  EXPECT_FALSE(registry.Erase("task_1"));
+  EXPECT_EQ(registry.Find("task_1"), nullptr);
+  EXPECT_FALSE(registry.GetByModelboxTaskId("mb_2", record));
+  EXPECT_TRUE(registry.GetByModelboxTaskId("mb_3", record));
+  EXPECT_EQ(record.task_group, task_2);
+  EXPECT_EQ(registry.ListTaskIds(), std::vector<std::string>({"task_2"}));
+};
+
+TEST(TaskRegistry, TestCase_rebind_modelbox_task) {
+  TaskRegistry registry;
+  auto task_1 = GenTaskGroup();
+  auto task_2 = GenTaskGroup();
+  registry.Insert("task_1", task_1);
+  registry.Insert("task_2", task_2);
+
+  // a session id bound to a new task is not unbound by the old one
+  EXPECT_TRUE(registry.AddModelboxTask("task_1", "mb_1"));
+  EXPECT_TRUE(registry.AddModelboxTask("task_2", "mb_1"));
+  TaskRecord record;
+  EXPECT_TRUE(registry.GetByModelboxTaskId("mb_1", record));
+  EXPECT_EQ(record.task_group, task_2);
+
+  EXPECT_TRUE(registry.Erase("task_1"));
+  EXPECT_TRUE(registry.GetByModelboxTaskId("mb_1", record));
+  EXPECT_EQ(record.task_group, task_2);
+  EXPECT_TRUE(registry.RemoveModelboxTask("task_2", "mb_1"));
+  EXPECT_FALSE(registry.GetByModelboxTaskId("mb_1", record));
+};
+
+TEST(TaskRegistry, TestCase_concurrent_access) {
+  TaskRegistry registry;
+  const int thread_num = 8;
+  const int task_num = 200;
+  std::atomic<int> found{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < task_num; ++i) {
+        auto task_id = "task_" + std::to_string(t) + "_" + std::to_string(i);
+        auto modelbox_task_id = "mb_" + task_id;
+        registry.Insert(task_id, GenTaskGroup());
+        registry.AddModelboxTask(task_id, modelbox_task_id);
+        TaskRecord record;
+        if (registry.GetByModelboxTaskId(modelbox_task_id, record)) {
+          found++;
+        }
+        registry.ForEach([](const TaskRecord &) {});
+        registry.Erase(task_id);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(found, thread_num * task_num);
+  EXPECT_EQ(registry.Size(), 0);
+};
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2022 The Modelbox Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "worker_channel.h"
+#include "worker_pool.h"
+
+using modelartsplugin::WorkerChannel;
+using modelartsplugin::WorkerPool;
+
+// a task named task_crash kills its worker, task_hang stops it answering
+static int RunWorker(size_t index, int fd) {
+  WorkerChannel channel(fd);
+  nlohmann::json msg;
+  while (channel.Receive(msg) == modelbox::STATUS_OK) {
+    auto type = msg.value("type", "");
+    auto task_id = msg.value("task_id", "");
+    channel.Send({{"type", modelartsplugin::WORKER_MSG_REPLY},
+                  {"seq", msg.value("seq", (uint64_t)0)},
+                  {"ok", true},
+                  {"finished_sessions", 0}});
+    if (type != modelartsplugin::WORKER_MSG_CREATE) {
+      continue;
+    }
+    if (task_id == "task_crash") {
+      _exit(1);
+    }
+    while (task_id == "task_hang") {
+      pause();
+    }
+    channel.Send({{"type", modelartsplugin::WORKER_MSG_STATUS},
+                  {"task_id", task_id},
+                  {"status", (int)modelarts::TASK_STATUS_RUNNING}});
+  }
+  return 0;
+}
+
+class WorkerPoolCase : public testing::Test {
+ protected:
+  void StartWorkerPool(size_t worker_num, int health_interval_ms) {
+    executor_ = std::make_shared<modelarts::Executor>(1, 10);
+    EXPECT_EQ(executor_->Start(), modelbox::STATUS_OK);
+    pool_ = std::make_shared<WorkerPool>(worker_num, RunWorker);
+    EXPECT_EQ(pool_->Start(), modelbox::STATUS_OK);
+    pool_->Watch(
+        executor_, health_interval_ms,
+        [this](const std::string &task_id, modelarts::TaskStatusCode status,
+               const std::string &reason) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          states_[task_id] = status;
+          reasons_[task_id] = reason;
+        },
+        nullptr, nullptr);
+  }
+
+  void TearDown() override {
+    if (pool_ != nullptr) {
+      pool_->Stop();
+    }
+    if (executor_ != nullptr) {
+      executor_->Stop();
+    }
+  };
+
+  bool CreateTask(const std::string &task_id) {
+    auto task_info = std::make_shared<modelarts::TaskInfo>();
+    auto msg = R"({"id": ")" + task_id + R"(", "config": {},
+        "input": {"type": "url",
+                  "data": {"url": "/tmp/test.mp4", "url_type": "file"}}})";
+    EXPECT_EQ(task_info->Parse(msg), modelbox::STATUS_OK);
+    return pool_->CreateTask(task_info);
+  }
+
+  bool WaitFor(const std::function<bool()> &cond, uint32_t timeout_ms) {
+    uint32_t time_count_ms = 0;
+    while (time_count_ms <= timeout_ms && !cond()) {
+      usleep(10 * 1000);
+      time_count_ms += 10;
+    }
+    return cond();
+  }
+
+  bool WaitTaskStatus(const std::string &task_id,
+                      modelarts::TaskStatusCode status) {
+    return WaitFor(
+        [&]() {
+          std::lock_guard<std::mutex> lock(mutex_);
+          auto it = states_.find(task_id);
+          return it != states_.end() && it->second == status;
+        },
+        3000);
+  }
+
+  bool WaitRestarts(size_t index, int restarts) {
+    return WaitFor(
+        [&]() {
+          auto worker = pool_->GetMetrics()[index];
+          return worker["restarts"] == restarts && worker["alive"] == true;
+        },
+        3000);
+  }
+
+  std::string GetReason(const std::string &task_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return reasons_[task_id];
+  }
+
+  std::shared_ptr<modelarts::Executor> executor_;
+  std::shared_ptr<WorkerPool> pool_;
+  std::mutex mutex_;
+  std::map<std::string, modelarts::TaskStatusCode> states_;
+  std::map<std::string, std::string> reasons_;
+};
+
+TEST_F(WorkerPoolCase, TestCase_worker_exit) {
+  StartWorkerPool(1, 60000);
+  auto pid = pool_->GetMetrics()[0]["pid"].get<int>();
+  EXPECT_TRUE(CreateTask("task_1"));
+  EXPECT_TRUE(WaitTaskStatus("task_1", modelarts::TASK_STATUS_RUNNING));
+
+  // every task of the lost worker fails, not only the one that killed it
+  EXPECT_TRUE(CreateTask("task_crash"));
+  EXPECT_TRUE(WaitTaskStatus("task_1", modelarts::TASK_STATUS_FAILED));
+  EXPECT_TRUE(WaitTaskStatus("task_crash", modelarts::TASK_STATUS_FAILED));
+  EXPECT_EQ(GetReason("task_1"), "pipeline worker lost");
+  EXPECT_FALSE(pool_->DeleteTask("task_1"));
+
+  EXPECT_TRUE(WaitRestarts(0, 1));
+  auto worker = pool_->GetMetrics()[0];
+  EXPECT_NE(worker["pid"].get<int>(), pid);
+  EXPECT_EQ(worker["tasks"], 0);
+
+  EXPECT_TRUE(CreateTask("task_2"));
+  EXPECT_TRUE(WaitTaskStatus("task_2", modelarts::TASK_STATUS_RUNNING));
+  EXPECT_TRUE(pool_->DeleteTask("task_2"));
+};
+
+TEST_F(WorkerPoolCase, TestCase_worker_health_miss) {
+  StartWorkerPool(2, 100);
+  EXPECT_TRUE(CreateTask("task_hang"));
+  EXPECT_TRUE(CreateTask("task_1"));
+  EXPECT_TRUE(WaitTaskStatus("task_1", modelarts::TASK_STATUS_RUNNING));
+
+  // the hung worker is killed after missing its health checks
+  EXPECT_TRUE(WaitTaskStatus("task_hang", modelarts::TASK_STATUS_FAILED));
+  EXPECT_EQ(GetReason("task_hang"), "pipeline worker lost");
+  EXPECT_TRUE(WaitRestarts(0, 1));
+  auto metrics = pool_->GetMetrics();
+  EXPECT_EQ(metrics[1]["restarts"], 0);
+  EXPECT_EQ(metrics[1]["tasks"], 1);
+
+  // new tasks go to the restarted worker, which runs the fewest
+  EXPECT_TRUE(CreateTask("task_2"));
+  EXPECT_TRUE(WaitTaskStatus("task_2", modelarts::TASK_STATUS_RUNNING));
+  EXPECT_EQ(pool_->GetMetrics()[0]["tasks"], 1);
+};